@@ -1,5 +1,5 @@
 @echo off
-setlocal
+setlocal enabledelayedexpansion
 
 echo Compiling GLSL shaders to SPIR-V...
 
@@ -10,8 +10,22 @@ if %errorlevel% neq 0 (
     exit /b 1
 )
 
+set spv_files=
 for %%f in (*.glsl) do (
     glslangValidator -V "%%f" -o "%%~nf.spv"
+    if !errorlevel! neq 0 exit /b 1
+    set spv_files=!spv_files! "%%~nf.spv"
 )
 
+echo Embedding SPIR-V into src\generated\shaders.h...
+
+if not exist ..\..\bin\spirv_embed.exe (
+    echo bin\spirv_embed.exe not found, build it with run.bat first.
+    exit /b 1
+)
+
+if not exist ..\..\src\generated mkdir ..\..\src\generated
+..\..\bin\spirv_embed.exe ..\..\src\generated\shaders.h %spv_files%
+if %errorlevel% neq 0 exit /b 1
+
 endlocal
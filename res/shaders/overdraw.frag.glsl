@@ -0,0 +1,10 @@
+#version 450
+
+// Overdraw heatmap, blended additively: red saturates after 8 shaded layers,
+// green after 16 and blue after 32.
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = vec4(1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1.0);
+}
@@ -1,12 +1,17 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Specialized to Vk_Context::texture_capacity.
+layout(constant_id = 0) const uint TEXTURE_COUNT = 1024;
 
 layout(location = 0) in vec2 frag_tex_coord;
+layout(location = 1) flat in uint frag_texture;
 
-// layout(binding = 0, set = 0) uniform sampler2D tex_sampler;
+layout(binding = 0, set = 0) uniform sampler2D textures[TEXTURE_COUNT];
 
 layout(location = 0) out vec4 out_color;
 
 void main() {
-    // out_color = texture(tex_sampler, frag_tex_coord);
-    out_color = vec4(1, 0, 0, 1);
+    // Sprites in one draw may sample different textures.
+    out_color = texture(textures[nonuniformEXT(frag_texture)], frag_tex_coord);
 }
@@ -3,9 +3,24 @@
 layout(location = 0) in vec2 a_position;
 layout(location = 1) in vec2 a_tex_coord;
 
+// Per instance, see Vk_Sprite_Instance.
+layout(location = 2) in vec2 i_offset;
+layout(location = 3) in vec2 i_scale;
+layout(location = 4) in uint i_texture;
+layout(location = 5) in float i_depth;
+
 layout(location = 0) out vec2 frag_tex_coord;
+layout(location = 1) flat out uint frag_texture;
+
+layout(push_constant) uniform Push_Constants {
+    mat4 view_projection;
+    vec2 viewport_size;
+} push;
 
 void main() {
-    gl_Position = vec4(a_position, 0.0, 1.0);
+    vec2 world_position = a_position * i_scale + i_offset;
+    gl_Position = push.view_projection * vec4(world_position, 0.0, 1.0);
+    gl_Position.z = i_depth;
     frag_tex_coord = a_tex_coord;
+    frag_texture = i_texture;
 }
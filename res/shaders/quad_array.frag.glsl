@@ -0,0 +1,18 @@
+#version 450
+
+// Fallback for devices without descriptor indexing. Draws never mix textures,
+// so the index is dynamically uniform.
+
+// Specialized to Vk_Context::texture_capacity.
+layout(constant_id = 0) const uint TEXTURE_COUNT = 1024;
+
+layout(location = 0) in vec2 frag_tex_coord;
+layout(location = 1) flat in uint frag_texture;
+
+layout(binding = 0, set = 0) uniform sampler2D textures[TEXTURE_COUNT];
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = texture(textures[frag_texture], frag_tex_coord);
+}
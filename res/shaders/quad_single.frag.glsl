@@ -0,0 +1,14 @@
+#version 450
+
+// Fallback for devices that can't index sampler arrays dynamically. Each draw
+// binds a set holding only its texture.
+
+layout(location = 0) in vec2 frag_tex_coord;
+
+layout(binding = 0, set = 0) uniform sampler2D texture_sampler;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = texture(texture_sampler, frag_tex_coord);
+}
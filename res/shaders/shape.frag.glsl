@@ -0,0 +1,39 @@
+#version 450
+
+layout(location = 0) in vec2 frag_local;
+layout(location = 1) flat in vec4 frag_color;
+layout(location = 2) flat in vec4 frag_params; // Half size, radius, stroke
+layout(location = 3) flat in uint frag_kind;
+
+layout(location = 0) out vec4 out_color;
+
+// Vk_Shape_Kind
+const uint SHAPE_CIRCLE = 0;
+const uint SHAPE_RECT = 1;
+const uint SHAPE_SEGMENT = 2;
+
+void main() {
+    vec2 p = frag_local;
+    vec2 half_size = frag_params.xy;
+    float radius = frag_params.z;
+    float stroke = frag_params.w;
+
+    // Signed distance to the edge, negative inside.
+    float d;
+    if (frag_kind == SHAPE_CIRCLE) {
+        d = length(p) - radius;
+    } else if (frag_kind == SHAPE_RECT) {
+        float r = min(radius, min(half_size.x, half_size.y));
+        vec2 q = abs(p) - half_size + r;
+        d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+    } else {
+        vec2 q = vec2(max(abs(p.x) - (half_size.x - radius), 0.0), p.y);
+        d = length(q) - radius;
+    }
+    if (stroke > 0.0) d = abs(d) - 0.5 * stroke;
+
+    // One pixel of falloff, however the shape is scaled.
+    float coverage = clamp(0.5 - d / max(fwidth(d), 1e-6), 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+    out_color = vec4(frag_color.rgb, frag_color.a * coverage);
+}
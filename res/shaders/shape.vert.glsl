@@ -0,0 +1,64 @@
+#version 450
+
+// Per instance, see Vk_Shape_Instance. There are no vertex buffers; the quad's
+// corners come from the vertex index.
+layout(location = 0) in vec2 i_p0;
+layout(location = 1) in vec2 i_p1;
+layout(location = 2) in float i_radius;
+layout(location = 3) in float i_stroke;
+layout(location = 4) in uint i_color;
+layout(location = 5) in uint i_kind;
+layout(location = 6) in float i_depth;
+
+layout(location = 0) out vec2 frag_local;
+layout(location = 1) flat out vec4 frag_color;
+layout(location = 2) flat out vec4 frag_params;
+layout(location = 3) flat out uint frag_kind;
+
+layout(push_constant) uniform Push_Constants {
+    mat4 view_projection;
+    vec2 viewport_size;
+} push;
+
+// Vk_Shape_Kind
+const uint SHAPE_CIRCLE = 0;
+const uint SHAPE_RECT = 1;
+const uint SHAPE_SEGMENT = 2;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    // The quad reaches a pixel past the shape so the antialiased edge fits.
+    vec2 half_viewport = 0.5 * push.viewport_size;
+    float pixels_x = length(push.view_projection[0].xy * half_viewport);
+    float pixels_y = length(push.view_projection[1].xy * half_viewport);
+    float margin = 1.0 / min(pixels_x, pixels_y);
+
+    vec2 center = i_p0;
+    vec2 axis = vec2(1.0, 0.0);
+    vec2 half_size;
+    if (i_kind == SHAPE_CIRCLE) {
+        half_size = vec2(i_radius);
+    } else if (i_kind == SHAPE_RECT) {
+        half_size = i_p1;
+    } else {
+        // Segments are expanded here, along their own axis.
+        vec2 delta = i_p1 - i_p0;
+        float len = length(delta);
+        center = 0.5 * (i_p0 + i_p1);
+        if (len > 0.0) axis = delta / len;
+        half_size = vec2(0.5 * len + i_radius, i_radius);
+    }
+
+    vec2 local = CORNERS[gl_VertexIndex] * (half_size + 0.5 * i_stroke + margin);
+    vec2 world_position = center + axis * local.x + vec2(-axis.y, axis.x) * local.y;
+    gl_Position = push.view_projection * vec4(world_position, 0.0, 1.0);
+    gl_Position.z = i_depth;
+
+    frag_local = local;
+    frag_color = unpackUnorm4x8(i_color);
+    frag_params = vec4(half_size, i_radius, i_stroke);
+    frag_kind = i_kind;
+}
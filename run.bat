@@ -1,14 +1,34 @@
 @echo off
-setlocal
+setlocal EnableDelayedExpansion
+
+rem Usage: run.bat [hot] [release]
+rem   hot      load SPIR-V from res\shaders at runtime instead of embedding it
+rem   release  optimized build without asserts, validation layers or object names
+
+set cl_defines=
+set cl_profile=/Od /Zi
+for %%a in (%*) do (
+    if "%%a"=="hot" set cl_defines=!cl_defines! /DSHADER_HOT_RELOAD=1
+    if "%%a"=="release" set cl_profile=/O2 /Zi /DBUILD_DEBUG=0
+)
 
 if not exist .\bin mkdir .\bin
 cd .\bin
 
+call cl ..\tools\spirv_embed.cpp /nologo /MD /I"..\src" /link /INCREMENTAL:NO /OUT:spirv_embed.exe
+if %ERRORLEVEL% neq 0 goto :end
+
+pushd ..\res\shaders
+call compile.bat
+set shader_status=%ERRORLEVEL%
+popd
+if %shader_status% neq 0 goto :end
+
 set cl_include=/I"..\src" /I"%VULKAN_SDK%\Include" /I"..\thirdparty\glfw\include"
 set cl_libpath=/LIBPATH:"%VULKAN_SDK%\Lib" /LIBPATH:"..\thirdparty\glfw\lib"
 set cl_libfile=vulkan-1.lib glfw3.lib user32.lib gdi32.lib shell32.lib
 
-set cl_compile=call cl ..\src\main.cpp /Zi /MD %cl_include%
+set cl_compile=call cl ..\src\main.cpp /MD %cl_profile% %cl_defines% %cl_include%
 set cl_link=/link /INCREMENTAL:NO /OUT:main.exe %cl_libpath% %cl_libfile%
 
 %cl_compile% %cl_link%
@@ -18,4 +38,5 @@ if %ERRORLEVEL% equ 0 (
     call .\bin\main.exe
 )
 
+:end
 endlocal
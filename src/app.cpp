@@ -1,50 +1,631 @@
-internal App *app_init() {
-    ASSERT(glfwInit());
-    
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    GLFWwindow *window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
-    ASSERT(window != NULL);
+internal App *app_init(App_Config *config) {
+    auto app = new App{};
 
-    Vk_Context *vulkan = vk_init(window);
-    ASSERT(vulkan != NULL);
+    STARTUP_TIME(app->jobs = job_system_init(0));
 
-    glfwSetWindowUserPointer(window, vulkan);
+    // Loose files under res/ are used for anything that isn't packed.
+    STARTUP_TIME(app->has_pack = asset_pack_open(&app->pack, ASSET_PACK_PATH));
+    app->streamer = stream_init(app->jobs, app->has_pack ? &app->pack : NULL);
 
-    glfwSetFramebufferSizeCallback(window, app_framebuffer_size_callback);
+    // The instance needs the window system's surface extensions, so GLFW
+    // comes up first.
+    glfwInitHint(GLFW_PLATFORM, config->platform);
+    b32 glfw_initialized;
+    STARTUP_TIME(glfw_initialized = glfwInit());
+    if (!glfw_initialized) LOG_FATAL("Failed to initialize GLFW");
+    if (!glfwVulkanSupported()) LOG_FATAL("No Vulkan loader found");
+    LOG_INFO("Platform: %s", app_platform_name(glfwGetPlatform()));
+
+    config->vulkan.surface_extensions = glfwGetRequiredInstanceExtensions(&config->vulkan.surface_extension_count);
+    if (config->vulkan.surface_extensions == NULL) LOG_FATAL("No Vulkan surface support on this platform");
+
+    // Asset decoding and instance creation run on workers from here on, while
+    // this thread creates the window.
+    app->texture = stream_request_texture(app->streamer, "res/textures/quad.tga", STREAM_PRIORITY_HIGH);
+    Vk_Context *vulkan = vk_init_begin(app->jobs, &config->vulkan);
+
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    GLFWwindow *window;
+    STARTUP_TIME(window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL));
+    if (window == NULL) LOG_FATAL("Failed to create window");
+
+    vk_init_end(vulkan, window);
+    stream_init_uploads(app->streamer, vulkan);
+    app->streamer->wake.store(glfwPostEmptyEvent, std::memory_order_release);
 
-    auto app = new App{};
     app->window = window;
     app->vulkan = vulkan;
+    vulkan->camera_latch = app_latch_camera;
+    vulkan->camera_latch_data = app;
+    vulkan->memory_warning = app_memory_warning;
+    vulkan->memory_warning_data = app;
+    app_create_scene(app);
+
+    if (config->vulkan.fps_cap > 0.0f) {
+        app->frame_interval_ns = (u64)(1000000000.0 / config->vulkan.fps_cap);
+        LOG_INFO("Frame rate capped at %.1f fps", config->vulkan.fps_cap);
+    }
+
+    app->redraw_on_demand = config->redraw_on_demand;
+    app->redraw_requested = true;
+    app->focused = true;
+    // Otherwise on-demand redraw would never go idle; space starts it.
+    app->animating = !app->redraw_on_demand;
+    if (app->redraw_on_demand) LOG_INFO("Redrawing on demand, space toggles the animation");
+
+    app->state.velocity[0] = 0.6f;
+    app->state.velocity[1] = 0.45f;
+    app->previous_state = app->state;
+
+    glfwSetWindowUserPointer(window, app);
+
+    glfwSetFramebufferSizeCallback(window, app_framebuffer_size_callback);
+    glfwSetWindowFocusCallback(window, app_window_focus_callback);
+    glfwSetWindowIconifyCallback(window, app_window_iconify_callback);
+    glfwSetKeyCallback(window, app_key_callback);
+    glfwSetMouseButtonCallback(window, app_mouse_button_callback);
+    glfwSetCursorPosCallback(window, app_cursor_pos_callback);
+    glfwSetScrollCallback(window, app_scroll_callback);
+
     return app;
 }
 
 internal void app_cleanup(App *app) {
+    vk_wait_idle(app->vulkan);
+
+    stream_cleanup(app->streamer, app->vulkan);
+    scene_destroy(app->scene, app->vulkan);
+
+    // vk_cleanup still waits on capture and pipeline jobs.
     vk_cleanup(app->vulkan);
+    job_system_cleanup(app->jobs);
+    if (app->has_pack) asset_pack_close(&app->pack);
 
     glfwDestroyWindow(app->window);
     glfwTerminate();
 }
 
-internal void app_iterate(App *app) {
-    vk_draw_frame(app->vulkan);
+#define APP_QUAD_SCALE 0.25f
+
+// A corner badge drawn as UI, so it stays sharp at any render scale.
+#define APP_BADGE_SCALE 0.05f
+
+// Retained grid sprites and how many of them move per animated frame.
+#define APP_SCENE_SCALE  0.01f
+#define APP_SCENE_MOVERS 64
+
+#define APP_ZOOM_STEP   1.1f // Per scroll notch
+#define APP_MIN_ZOOM    0.1f
+#define APP_MAX_ZOOM    10.0f
+#define APP_ROTATE_STEP (3.14159265f / 12.0f)
+
+// Frame time graph in the bottom right corner, in clip space.
+#define APP_FRAME_GRAPH_WIDTH  0.5f
+#define APP_FRAME_GRAPH_HEIGHT 0.25f
+#define APP_FRAME_GRAPH_MARGIN 0.05f
+#define APP_FRAME_GRAPH_MAX_MS 8.0f
+
+internal void app_simulate(App_Sim_State *state, f32 dt) {
+    // Bounce the quad off the edges of clip space.
+    f32 limit = 1.0f - APP_QUAD_SCALE;
+    for (u32 axis = 0; axis < 2; ++axis) {
+        state->position[axis] += state->velocity[axis] * dt;
+        if (state->position[axis] > limit || state->position[axis] < -limit) {
+            state->position[axis] = CLAMP(-limit, state->position[axis], limit);
+            state->velocity[axis] = -state->velocity[axis];
+        }
+    }
+}
+
+// In view heights from the camera, so what's on screen streams in first.
+internal void app_update_stream_distances(App *app) {
+    Vk_Camera *camera = &app->vulkan->camera;
+    f32 dx = app->state.position[0] - camera->position[0];
+    f32 dy = app->state.position[1] - camera->position[1];
+    stream_set_distance(app->streamer, app->texture, sqrtf(dx * dx + dy * dy) * camera->zoom * 0.5f);
+}
+
+internal void app_iterate(App *app, f32 alpha) {
+    u64 frame_start_ns = time_now_ns();
+
+    app_update_stream_distances(app);
+    stream_update(app->streamer, app->vulkan);
+    if (app->animating) app_update_scene(app);
+
+    Vk_Draw_Item items[2] = {};
+
+    Vk_Draw_Item *item = &items[0];
+    item->mesh = &app->vulkan->quad_mesh;
+    item->texture = stream_texture(app->streamer, app->vulkan, app->texture);
+    if (app->wireframe) item->pipeline = app->wireframe_pipeline;
+    for (u32 axis = 0; axis < 2; ++axis) {
+        f32 previous = app->previous_state.position[axis];
+        item->offset[axis] = previous + (app->state.position[axis] - previous) * alpha;
+        item->scale[axis] = APP_QUAD_SCALE;
+    }
+
+    Vk_Draw_Item *badge = &items[1];
+    badge->mesh = &app->vulkan->quad_mesh;
+    badge->texture = &app->vulkan->placeholder_texture;
+    badge->ui = true;
+    for (u32 axis = 0; axis < 2; ++axis) {
+        badge->offset[axis] = -1.0f + 2.0f * APP_BADGE_SCALE;
+        badge->scale[axis] = APP_BADGE_SCALE;
+    }
+
+    Vk_Shape outline{};
+    outline.kind = VK_SHAPE_RECT;
+    outline.color = 0xff40c0ff;
+    outline.p0[0] = item->offset[0];
+    outline.p0[1] = item->offset[1];
+    outline.p1[0] = item->mesh->extent[0] * APP_QUAD_SCALE;
+    outline.p1[1] = item->mesh->extent[1] * APP_QUAD_SCALE;
+    outline.radius = 0.02f;
+    outline.stroke = 0.01f;
+    outline.layer = 1;
+    vk_push_shape(app->vulkan, &outline);
+
+    app_draw_frame_graph(app);
+
+    vk_draw_frame(app->vulkan, items, ARRAY_COUNT(items));
+
+    app_update_latency(app, frame_start_ns);
+}
+
+internal void app_request_redraw(App *app) {
+    app->redraw_requested = true;
+}
+
+internal b8 app_needs_frame(App *app) {
+    if (app->minimized) return false;
+    if (!app->redraw_on_demand) return true;
+    return app->redraw_requested || app->animating || stream_is_busy(app->streamer);
+}
+
+internal void app_window_focus_callback(GLFWwindow *window, s32 focused) {
+    auto app = (App *)glfwGetWindowUserPointer(window);
+    app->focused = focused == GLFW_TRUE;
+    app_request_redraw(app);
+}
+
+internal void app_window_iconify_callback(GLFWwindow *window, s32 iconified) {
+    auto app = (App *)glfwGetWindowUserPointer(window);
+
+    s32 width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    app->minimized = iconified == GLFW_TRUE || width == 0 || height == 0;
+    app_request_redraw(app);
 }
 
 internal void app_framebuffer_size_callback(GLFWwindow *window, s32 width, s32 height) {
-    auto vulkan = (Vk_Context *)glfwGetWindowUserPointer(window);
-    vk_wait_idle(vulkan);
-    vk_cleanup_framebuffers(vulkan);
-    vk_cleanup_swapchain(vulkan);
-    vk_create_swapchain(vulkan, window);
-    vk_create_framebuffers(vulkan);
+    auto app = (App *)glfwGetWindowUserPointer(window);
+
+    // A zero-sized swapchain isn't allowed, so nothing renders until restored.
+    app->minimized = width == 0 || height == 0;
+    if (app->minimized) return;
+    app_request_redraw(app);
+
+    vk_recreate_swapchain(app->vulkan, window);
+}
+
+// GLFW callbacks carry no timestamps, so input is stamped when glfwPollEvents
+// dispatches it. That is the earliest point the app can observe it.
+internal void app_record_input(GLFWwindow *window) {
+    auto app = (App *)glfwGetWindowUserPointer(window);
+    if (app->pending_input_ns == 0) app->pending_input_ns = time_now_ns();
+    app_request_redraw(app);
+}
+
+internal void app_key_callback(GLFWwindow *window, s32 key, s32 scancode, s32 action, s32 mods) {
+    app_record_input(window);
+
+    auto app = (App *)glfwGetWindowUserPointer(window);
+    Vk_Camera *camera = &app->vulkan->camera;
+
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+        app->animating = !app->animating;
+    }
+
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        app->overdraw_heatmap = !app->overdraw_heatmap;
+        vk_set_overdraw_heatmap(app->vulkan, app->overdraw_heatmap);
+    }
+
+    if (key == GLFW_KEY_W && action == GLFW_PRESS) {
+        if (app->wireframe_pipeline == 0) {
+            Vk_Pipeline_Desc desc{};
+            desc.shader = VK_SHADER_SPRITE;
+            desc.blend = VK_BLEND_OPAQUE;
+            desc.depth = VK_DEPTH_TEST_WRITE;
+            desc.vertex_format = VK_VERTEX_FORMAT_SPRITE;
+            desc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            desc.wireframe = true;
+            app->wireframe_pipeline = vk_request_pipeline(app->vulkan, &desc);
+        }
+        app->wireframe = !app->wireframe;
+    }
+
+    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+        if (key == GLFW_KEY_Q) camera->rotation -= APP_ROTATE_STEP;
+        if (key == GLFW_KEY_E) camera->rotation += APP_ROTATE_STEP;
+        if (key == GLFW_KEY_R) {
+            *camera = {};
+            camera->zoom = 1.0f;
+        }
+    }
+}
+
+internal void app_mouse_button_callback(GLFWwindow *window, s32 button, s32 action, s32 mods) {
+    app_record_input(window);
+
+    if (button != GLFW_MOUSE_BUTTON_LEFT) return;
+
+    auto app = (App *)glfwGetWindowUserPointer(window);
+    if (action == GLFW_PRESS) {
+        glfwGetCursorPos(window, &app->pan_cursor[0], &app->pan_cursor[1]);
+        app->panning = true;
+    } else if (action == GLFW_RELEASE) {
+        // Keep the movement since the last frame.
+        app_latch_camera(&app->vulkan->camera, app);
+        app->panning = false;
+    }
+}
+
+internal void app_cursor_pos_callback(GLFWwindow *window, f64 x, f64 y) {
+    app_record_input(window);
+}
+
+internal void app_scroll_callback(GLFWwindow *window, f64 x, f64 y) {
+    app_record_input(window);
+
+    auto app = (App *)glfwGetWindowUserPointer(window);
+    Vk_Camera *camera = &app->vulkan->camera;
+    camera->zoom = CLAMP(APP_MIN_ZOOM, camera->zoom * powf(APP_ZOOM_STEP, (f32)y), APP_MAX_ZOOM);
+}
+
+// Cursor events only arrive with the next poll, which for a frame that blocked
+// on the GPU is stale by the time it records. The cursor is read directly here
+// instead, right before the frame is recorded and submitted.
+internal void app_latch_camera(Vk_Camera *camera, void *user_data) {
+    auto app = (App *)user_data;
+    if (!app->panning) return;
+
+    f64 x, y;
+    glfwGetCursorPos(app->window, &x, &y);
+
+    s32 width, height;
+    glfwGetWindowSize(app->window, &width, &height);
+    VkExtent2D extent = {(u32)MAX(width, 1), (u32)MAX(height, 1)};
+
+    // Dragging moves the world with the cursor.
+    f32 pixels[2] = {(f32)(x - app->pan_cursor[0]), (f32)(y - app->pan_cursor[1])};
+    f32 world[2];
+    vk_camera_pixels_to_world(camera, extent, pixels, world);
+    camera->position[0] -= world[0];
+    camera->position[1] -= world[1];
+
+    app->pan_cursor[0] = x;
+    app->pan_cursor[1] = y;
+}
+
+internal void app_memory_warning(u32 heap, u64 usage, u64 budget, void *user_data) {
+    auto app = (App *)user_data;
+    LOG_WARNING("Memory heap %u is at %.0f%% of its budget (%.1f of %.1f MB)",
+        heap, 100.0 * usage / budget, usage / (f64)MB(1), budget / (f64)MB(1));
+    vk_log_memory_report(app->vulkan);
+}
+
+internal void app_create_scene(App *app) {
+    Vk_Context *vulkan = app->vulkan;
+    u32 count = APP_SCENE_GRID * APP_SCENE_GRID;
+    app->scene = scene_create(vulkan, count);
+    vulkan->scene = app->scene;
+
+    Scene_Batch_Id batch = scene_create_batch(app->scene, &vulkan->quad_mesh, count, 0, false, 0);
+    f32 scale[2] = {APP_SCENE_SCALE, APP_SCENE_SCALE};
+    for (u32 i = 0; i < count; ++i) {
+        f32 offset[2] = {
+            -1.0f + 2.0f * ((i % APP_SCENE_GRID) + 0.5f) / APP_SCENE_GRID,
+            -1.0f + 2.0f * ((i / APP_SCENE_GRID) + 0.5f) / APP_SCENE_GRID,
+        };
+        // Farthest in the layer, behind the quad.
+        app->scene_sprites[i] = scene_add(app->scene, batch, offset, scale, &vulkan->placeholder_texture, 1.0f);
+    }
+}
+
+internal void app_update_scene(App *app) {
+    // Each mover is nudged around its grid cell, the rest keep last frame's data.
+    u32 count = APP_SCENE_GRID * APP_SCENE_GRID;
+    f32 phase = (f32)(app->scene_frame++ % 360) * (3.14159265f / 180.0f);
+    f32 cell = 2.0f / APP_SCENE_GRID;
+    for (u32 m = 0; m < APP_SCENE_MOVERS; ++m) {
+        u32 i = app->scene_next_mover;
+        app->scene_next_mover = (app->scene_next_mover + 1) % count;
+
+        f32 offset[2] = {
+            -1.0f + cell * ((i % APP_SCENE_GRID) + 0.5f + 0.25f * cosf(phase + i)),
+            -1.0f + cell * ((i / APP_SCENE_GRID) + 0.5f + 0.25f * sinf(phase + i)),
+        };
+        scene_set_offset(app->scene, app->scene_sprites[i], offset);
+    }
+}
+
+internal void app_draw_frame_graph(App *app) {
+    Vk_Shape background{};
+    background.kind = VK_SHAPE_RECT;
+    background.color = 0xa0000000;
+    background.p0[0] = 1.0f - APP_FRAME_GRAPH_WIDTH * 0.5f - APP_FRAME_GRAPH_MARGIN;
+    background.p0[1] = -1.0f + APP_FRAME_GRAPH_HEIGHT * 0.5f + APP_FRAME_GRAPH_MARGIN;
+    background.p1[0] = APP_FRAME_GRAPH_WIDTH * 0.5f;
+    background.p1[1] = APP_FRAME_GRAPH_HEIGHT * 0.5f;
+    background.radius = 0.02f;
+    background.ui = true;
+    vk_push_shape(app->vulkan, &background);
+
+    // Oldest on the left, clamped to APP_FRAME_GRAPH_MAX_MS at the top.
+    f32 points[APP_FRAME_GRAPH_LENGTH][2];
+    f32 left = background.p0[0] - background.p1[0];
+    f32 bottom = background.p0[1] + background.p1[1];
+    for (u32 i = 0; i < APP_FRAME_GRAPH_LENGTH; ++i) {
+        f32 ms = app->frame_graph_ms[(app->frame_graph_next + i) % APP_FRAME_GRAPH_LENGTH];
+        points[i][0] = left + APP_FRAME_GRAPH_WIDTH * i / (APP_FRAME_GRAPH_LENGTH - 1);
+        points[i][1] = bottom - APP_FRAME_GRAPH_HEIGHT * MIN(ms / APP_FRAME_GRAPH_MAX_MS, 1.0f);
+    }
+    vk_push_polyline(app->vulkan, points, APP_FRAME_GRAPH_LENGTH, 0.006f, 0xff60ff60, 1, true);
 }
 
-internal void app_run() {
+internal void app_update_latency(App *app, u64 frame_start_ns) {
+    App_Latency *latency = &app->latency;
+    Vk_Frame_Timing *timing = &app->vulkan->frame_timing;
+
+    u64 cpu_ns = (timing->begin_ns - frame_start_ns) + (timing->present_ns - timing->ready_ns);
+    app->frame_graph_ms[app->frame_graph_next] = (f32)NS_TO_MS(cpu_ns);
+    app->frame_graph_next = (app->frame_graph_next + 1) % APP_FRAME_GRAPH_LENGTH;
+    latency->cpu_total_ns += cpu_ns;
+    latency->cpu_max_ns = MAX(latency->cpu_max_ns, cpu_ns);
+    latency->frame_count++;
+
+    if (app->pending_input_ns != 0) {
+        u64 present_ns = timing->present_ns - app->pending_input_ns;
+        latency->submit_total_ns += timing->submit_ns - app->pending_input_ns;
+        latency->present_total_ns += present_ns;
+        latency->present_max_ns = MAX(latency->present_max_ns, present_ns);
+        latency->sample_count++;
+        app->pending_input_ns = 0;
+    }
+
+    if (latency->window_start_ns == 0) latency->window_start_ns = timing->present_ns;
+    if (timing->present_ns - latency->window_start_ns < LATENCY_REPORT_INTERVAL_S * 1000000000ull) return;
+
+    if (latency->sample_count > 0) {
+        LOG_INFO("Input latency (%s, %u frames with input): to submit %.2f ms, to present %.2f ms avg / %.2f ms max",
+            vk_present_mode_name(app->vulkan->present_mode), latency->sample_count,
+            NS_TO_MS(latency->submit_total_ns / latency->sample_count),
+            NS_TO_MS(latency->present_total_ns / latency->sample_count), NS_TO_MS(latency->present_max_ns));
+    }
+
+    LOG_INFO("CPU frame time (%s build, %u frames): %.3f ms avg / %.3f ms max", BUILD_PROFILE_NAME,
+        latency->frame_count, NS_TO_MS(latency->cpu_total_ns / latency->frame_count), NS_TO_MS(latency->cpu_max_ns));
+
+    Vk_Context *vulkan = app->vulkan;
+    Vk_Frame_Stats stats;
+    vk_get_frame_stats(vulkan, &stats);
+
+    Vk_Submit_Stats *unsorted = &stats.unsorted;
+    Vk_Submit_Stats *merged = &stats.submit;
+    LOG_INFO("Draw submission (frame %llu, %u items, %u visible, %u culled, sorted in %.3f ms): "
+        "pipeline/descriptor/mesh binds and draws %u/%u/%u %u unsorted, %u/%u/%u %u merged",
+        (unsigned long long)stats.frame_index, stats.item_count, stats.visible_count, stats.culled_count,
+        NS_TO_MS(stats.sort_ns),
+        unsorted->pipeline_binds, unsorted->descriptor_binds, unsorted->mesh_binds, unsorted->draw_calls,
+        merged->pipeline_binds, merged->descriptor_binds, merged->mesh_binds, merged->draw_calls);
+    LOG_INFO("Uploads (frame %llu): %u instances, %u shapes, %.1f KB instance data, %.1f KB streamed",
+        (unsigned long long)stats.frame_index, stats.instance_count, stats.shape_count,
+        stats.instance_bytes / (f64)KB(1), stats.upload_bytes / (f64)KB(1));
+    LOG_INFO("Retained scene (frame %llu): %u sprites, %.1f KB uploaded in %u copy regions",
+        (unsigned long long)stats.frame_index, stats.scene_count,
+        stats.scene_upload_bytes / (f64)KB(1), stats.scene_copy_regions);
+
+    // Run with --depth off to compare against painter's order.
+    const char *depth_mode = vulkan->depth_format != VK_FORMAT_UNDEFINED ? "on" : "off";
+    if (vulkan->has_pipeline_statistics) {
+        LOG_INFO("Overdraw (depth buffer %s): %.2fx covered, %.2fx shaded (%llu vertex, %llu fragment invocations)",
+            depth_mode, stats.overdraw_covered, stats.gpu.overdraw_shaded,
+            (unsigned long long)stats.gpu.vertex_invocations, (unsigned long long)stats.gpu.fragment_invocations);
+    } else {
+        LOG_INFO("Overdraw (depth buffer %s): %.2fx covered", depth_mode, stats.overdraw_covered);
+    }
+
+    Vk_Resolution *resolution = &vulkan->resolution;
+    if (resolution->enabled) {
+        VkExtent2D scene_extent = vk_scene_extent(vulkan);
+        LOG_INFO("Render scale %.2f (%ux%u of %ux%u), GPU %.2f ms smoothed / %.2f ms last, target %.2f ms",
+            resolution->scale, scene_extent.width, scene_extent.height,
+            vulkan->swapchain_extent.width, vulkan->swapchain_extent.height,
+            resolution->gpu_ms, stats.gpu.frame_ms, vulkan->config.gpu_target_ms);
+    }
+
+    if (timing->present_ns - app->memory_report_ns >= MEMORY_REPORT_INTERVAL_S * 1000000000ull) {
+        vk_log_memory_report(vulkan);
+        app->memory_report_ns = timing->present_ns;
+    }
+
+    *latency = {};
+    latency->window_start_ns = timing->present_ns;
+}
+
+internal const char *app_platform_name(s32 platform) {
+    switch (platform) {
+        case GLFW_PLATFORM_WIN32:   return "win32";
+        case GLFW_PLATFORM_COCOA:   return "cocoa";
+        case GLFW_PLATFORM_X11:     return "x11";
+        case GLFW_PLATFORM_WAYLAND: return "wayland";
+        case GLFW_PLATFORM_NULL:    return "null";
+        default:                    return "auto";
+    }
+}
+
+internal void app_parse_args(s32 argc, char **argv, App_Config *config) {
+    Vk_Config *vulkan = &config->vulkan;
+    env_get(DEVICE_SELECTOR_ENV, vulkan->device_selector, sizeof(vulkan->device_selector));
+    vulkan->present_policy = DEFAULT_PRESENT_POLICY;
+    vulkan->fps_cap = -1.0f; // Not given
+    config->redraw_on_demand = DEFAULT_REDRAW_ON_DEMAND;
+    vulkan->dynamic_resolution = DEFAULT_DYNAMIC_RESOLUTION;
+    vulkan->min_render_scale = DEFAULT_MIN_RENDER_SCALE;
+    vulkan->max_render_scale = DEFAULT_MAX_RENDER_SCALE;
+    vulkan->gpu_target_ms = DEFAULT_GPU_TARGET_MS;
+    vulkan->depth_buffer = DEFAULT_DEPTH_BUFFER;
+    vulkan->async_pipelines = DEFAULT_ASYNC_PIPELINES;
+    config->platform = DEFAULT_PLATFORM;
+
+    // Every option takes a value.
+    local_persist const char *options[] = {
+        "--device", "--present", "--fps-cap", "--rendering", "--dynamic-resolution", "--render-scale-min",
+        "--render-scale-max", "--gpu-target-ms", "--depth", "--pipelines", "--platform", "--redraw",
+    };
+
+    for (s32 i = 1; i < argc; ++i) {
+        // Both "--name value" and "--name=value" are accepted.
+        char name[64];
+        const char *value = NULL;
+        const char *equals = strchr(argv[i], '=');
+        if (equals) {
+            snprintf(name, sizeof(name), "%.*s", (s32)(equals - argv[i]), argv[i]);
+            value = equals + 1;
+        } else {
+            snprintf(name, sizeof(name), "%s", argv[i]);
+        }
+
+        b8 known = false;
+        for (u32 o = 0; o < ARRAY_COUNT(options); ++o) {
+            if (strcmp(name, options[o]) == 0) known = true;
+        }
+        if (!known) {
+            // Not consuming the next argument, so a typo can't swallow it.
+            LOG_WARNING("Unknown argument: %s", name);
+            continue;
+        }
+        if (!equals && i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) value = argv[++i];
+
+        if (value == NULL) {
+            LOG_WARNING("Missing value for %s", name);
+        } else if (strcmp(name, "--device") == 0) {
+            snprintf(vulkan->device_selector, sizeof(vulkan->device_selector), "%s", value);
+        } else if (strcmp(name, "--present") == 0) {
+            if (strcmp(value, "low-latency") == 0) vulkan->present_policy = VK_PRESENT_POLICY_LOW_LATENCY;
+            else if (strcmp(value, "power-saving") == 0) vulkan->present_policy = VK_PRESENT_POLICY_POWER_SAVING;
+            else if (strcmp(value, "adaptive") == 0) vulkan->present_policy = VK_PRESENT_POLICY_ADAPTIVE;
+            else if (strcmp(value, "capped") == 0) vulkan->present_policy = VK_PRESENT_POLICY_CAPPED;
+            else LOG_WARNING("Unknown present policy: %s", value);
+        } else if (strcmp(name, "--fps-cap") == 0) {
+            vulkan->fps_cap = (f32)atof(value);
+        } else if (strcmp(name, "--rendering") == 0) {
+            if (strcmp(value, "dynamic") == 0) vulkan->force_render_pass = false;
+            else if (strcmp(value, "render-pass") == 0) vulkan->force_render_pass = true;
+            else LOG_WARNING("Unknown rendering path: %s", value);
+        } else if (strcmp(name, "--dynamic-resolution") == 0) {
+            if (strcmp(value, "on") == 0) vulkan->dynamic_resolution = true;
+            else if (strcmp(value, "off") == 0) vulkan->dynamic_resolution = false;
+            else LOG_WARNING("Unknown dynamic resolution mode: %s", value);
+        } else if (strcmp(name, "--render-scale-min") == 0) {
+            vulkan->min_render_scale = (f32)atof(value);
+        } else if (strcmp(name, "--render-scale-max") == 0) {
+            vulkan->max_render_scale = (f32)atof(value);
+        } else if (strcmp(name, "--gpu-target-ms") == 0) {
+            vulkan->gpu_target_ms = (f32)atof(value);
+        } else if (strcmp(name, "--depth") == 0) {
+            if (strcmp(value, "on") == 0) vulkan->depth_buffer = true;
+            else if (strcmp(value, "off") == 0) vulkan->depth_buffer = false;
+            else LOG_WARNING("Unknown depth mode: %s", value);
+        } else if (strcmp(name, "--pipelines") == 0) {
+            if (strcmp(value, "async") == 0) vulkan->async_pipelines = true;
+            else if (strcmp(value, "sync") == 0) vulkan->async_pipelines = false;
+            else LOG_WARNING("Unknown pipeline build mode: %s", value);
+        } else if (strcmp(name, "--platform") == 0) {
+            if (strcmp(value, "auto") == 0) config->platform = GLFW_ANY_PLATFORM;
+            else if (strcmp(value, "win32") == 0) config->platform = GLFW_PLATFORM_WIN32;
+            else if (strcmp(value, "x11") == 0) config->platform = GLFW_PLATFORM_X11;
+            else if (strcmp(value, "wayland") == 0) config->platform = GLFW_PLATFORM_WAYLAND;
+            else if (strcmp(value, "null") == 0) config->platform = GLFW_PLATFORM_NULL;
+            else LOG_WARNING("Unknown platform: %s", value);
+        } else if (strcmp(name, "--redraw") == 0) {
+            if (strcmp(value, "continuous") == 0) config->redraw_on_demand = false;
+            else if (strcmp(value, "on-demand") == 0) config->redraw_on_demand = true;
+            else LOG_WARNING("Unknown redraw mode: %s", value);
+        }
+    }
+
+    if (vulkan->fps_cap < 0.0f) {
+        vulkan->fps_cap = vulkan->present_policy == VK_PRESENT_POLICY_CAPPED ? DEFAULT_FPS_CAP : 0.0f;
+    }
+}
+
+internal void app_run(s32 argc, char **argv) {
     LOG_INFO("App started");
 
-    App *app = app_init();
+    startup_begin();
+
+    App_Config config{};
+    app_parse_args(argc, argv, &config);
+
+    App *app = app_init(&config);
+
+    const u64 step_ns = 1000000000ull / SIM_TICK_RATE;
+    const f32 step_dt = 1.0f / SIM_TICK_RATE;
+
+    const u64 unfocused_interval_ns = (u64)(1000000000.0 / UNFOCUSED_FPS_CAP);
+
+    u64 next_frame_ns = time_now_ns();
+    u64 previous_ns = time_now_ns();
+    u64 accumulator_ns = 0;
     while (!glfwWindowShouldClose(app->window)) {
-        glfwPollEvents();
-        app_iterate(app);
+        if (vk_failed()) {
+            LOG_ERROR("Stopping after a Vulkan error");
+            break;
+        }
+
+        u64 frame_interval_ns = app->frame_interval_ns;
+        if (!app->focused) frame_interval_ns = MAX(frame_interval_ns, unfocused_interval_ns);
+
+        if (frame_interval_ns) {
+            // Wait before polling, so the frame is built from the freshest input.
+            time_sleep_until_ns(next_frame_ns);
+            next_frame_ns = MAX(next_frame_ns + frame_interval_ns, time_now_ns());
+        }
+
+        if (app_needs_frame(app)) {
+            glfwPollEvents();
+        } else {
+            // Idle or minimized: sleep until input, a resize, or a worker
+            // posting an empty event because an asset finished decoding.
+            glfwWaitEvents();
+            previous_ns = time_now_ns();
+            next_frame_ns = previous_ns;
+            if (!app_needs_frame(app)) continue;
+        }
+
+        u64 now_ns = time_now_ns();
+        if (app->animating) accumulator_ns += now_ns - previous_ns;
+        previous_ns = now_ns;
+
+        u32 step_count = 0;
+        while (accumulator_ns >= step_ns && step_count < MAX_SIM_STEPS_PER_FRAME) {
+            app->previous_state = app->state;
+            app_simulate(&app->state, step_dt);
+            accumulator_ns -= step_ns;
+            step_count++;
+        }
+        if (accumulator_ns >= step_ns) {
+            // Spiral of death: running every missed step would make this frame
+            // even slower, so the simulation falls behind wall time instead.
+            LOG_WARNING("Simulation fell %.1f ms behind, skipping", NS_TO_MS(accumulator_ns - accumulator_ns % step_ns));
+            accumulator_ns %= step_ns;
+        }
+
+        app->redraw_requested = false;
+        app_iterate(app, (f32)accumulator_ns / step_ns);
+        startup_report();
     }
     app_cleanup(app);
 
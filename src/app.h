@@ -1,14 +1,127 @@
 #pragma once
 
+// Time from the first input event handled in a frame until that frame was
+// submitted and presented, accumulated over LATENCY_REPORT_INTERVAL_S.
+//
+// CPU frame time is the frame's own work (streaming, recording, submit and
+// present) without the time spent blocked on the GPU or the display, so debug
+// and release builds can be compared on the same machine.
+struct App_Latency {
+    u64 window_start_ns;
+    u32 sample_count;
+    u64 submit_total_ns;
+    u64 present_total_ns;
+    u64 present_max_ns;
+
+    u32 frame_count;
+    u64 cpu_total_ns;
+    u64 cpu_max_ns;
+};
+
+struct App_Sim_State {
+    f32 position[2];
+    f32 velocity[2];
+};
+
+#define APP_FRAME_GRAPH_LENGTH 120
+#define APP_SCENE_GRID 64
+
+struct App_Config {
+    Vk_Config vulkan;
+    b8 redraw_on_demand;
+    s32 platform; // GLFW_PLATFORM_*, or GLFW_ANY_PLATFORM to let GLFW pick
+};
+
 struct App {
     GLFWwindow *window;
     Vk_Context *vulkan;
+
+    Job_System *jobs;
+    Asset_Pack pack;
+    b8 has_pack;
+    Streamer *streamer;
+
+    Stream_Handle texture;
+
+    // A static grid of retained sprites behind the quad. While animating, a
+    // few of them move every frame, so only those are uploaded.
+    Scene *scene;
+    Scene_Handle scene_sprites[APP_SCENE_GRID * APP_SCENE_GRID];
+    u32 scene_next_mover;
+    u64 scene_frame;
+
+    App_Sim_State previous_state;
+    App_Sim_State state;
+
+    // Camera controls: drag with the left button to pan, scroll to zoom,
+    // Q and E to rotate, R to reset.
+    b8 panning;
+    f64 pan_cursor[2]; // Cursor position the camera was last panned to
+
+    b8 animating; // Toggled with space
+    b8 overdraw_heatmap; // Toggled with H
+    b8 wireframe;        // Toggled with W
+    Vk_Pipeline_Id wireframe_pipeline; // Requested on the first toggle
+    b8 redraw_on_demand;
+    b8 redraw_requested;
+    b8 focused;
+    b8 minimized;
+
+    // CPU frame times of the last frames, drawn as a graph with shapes.
+    f32 frame_graph_ms[APP_FRAME_GRAPH_LENGTH];
+    u32 frame_graph_next;
+
+    u64 frame_interval_ns; // 0 when frames aren't paced by the app
+    u64 pending_input_ns;  // Timestamp of the oldest unhandled input, 0 if none
+    App_Latency latency;
+    u64 memory_report_ns; // When vk_log_memory_report last ran
 };
 
-internal App *app_init();
+internal App *app_init(App_Config *config);
 internal void app_cleanup(App *app);
-internal void app_iterate(App *app);
+internal void app_simulate(App_Sim_State *state, f32 dt);
+
+internal void app_update_stream_distances(App *app);
+
+// alpha is how far the current time is between the previous and current
+// simulation steps, in [0, 1).
+internal void app_iterate(App *app, f32 alpha);
+
+// Makes the next loop iteration render even in redraw-on-demand mode.
+internal void app_request_redraw(App *app);
+internal b8 app_needs_frame(App *app);
 
 internal void app_framebuffer_size_callback(GLFWwindow *window, s32 width, s32 height);
+internal void app_window_focus_callback(GLFWwindow *window, s32 focused);
+internal void app_window_iconify_callback(GLFWwindow *window, s32 iconified);
+
+internal void app_record_input(GLFWwindow *window);
+internal void app_key_callback(GLFWwindow *window, s32 key, s32 scancode, s32 action, s32 mods);
+internal void app_mouse_button_callback(GLFWwindow *window, s32 button, s32 action, s32 mods);
+internal void app_cursor_pos_callback(GLFWwindow *window, f64 x, f64 y);
+internal void app_scroll_callback(GLFWwindow *window, f64 x, f64 y);
+
+internal void app_latch_camera(Vk_Camera *camera, void *user_data);
+internal void app_memory_warning(u32 heap, u64 usage, u64 budget, void *user_data);
+internal const char *app_platform_name(s32 platform);
+
+internal void app_draw_frame_graph(App *app);
+internal void app_create_scene(App *app);
+internal void app_update_scene(App *app);
+internal void app_update_latency(App *app, u64 frame_start_ns);
+
+// Options:
+//   --device <index|uuid|name>
+//   --present <low-latency|power-saving|adaptive|capped>
+//   --fps-cap <fps>  (0 for no limit)
+//   --redraw <continuous|on-demand>
+//   --rendering <dynamic|render-pass>  (dynamic falls back when unsupported)
+//   --dynamic-resolution <on|off>
+//   --render-scale-min <scale>, --render-scale-max <scale>  (in (0, 1])
+//   --gpu-target-ms <ms>
+//   --depth <on|off>
+//   --pipelines <async|sync>  (how variants requested after startup are built)
+//   --platform <auto|win32|x11|wayland|null>
+internal void app_parse_args(s32 argc, char **argv, App_Config *config);
 
-internal void app_run();
+internal void app_run(s32 argc, char **argv);
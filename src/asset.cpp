@@ -0,0 +1,261 @@
+// LZ4
+// -----------------------------------------------------------------------------
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5  // The last 5 bytes of a block are always literals
+#define LZ4_MF_LIMIT      12 // The last match must start at least 12 bytes before the end
+#define LZ4_MAX_OFFSET    65535
+#define LZ4_HASH_BITS     16
+
+internal u32 lz4_read_u32(const u8 *p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+internal u8 *lz4_write_length(u8 *op, u64 length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (u8)length;
+    return op;
+}
+
+internal u64 lz4_compress_bound(u64 size) {
+    return size + size / 255 + 16;
+}
+
+internal u64 lz4_compress(const u8 *src, u64 src_size, u8 *dst, u64 dst_capacity) {
+    const u8 *ip = src;
+    const u8 *anchor = src;
+    const u8 *src_end = src + src_size;
+    u8 *op = dst;
+    u8 *op_end = dst + dst_capacity;
+
+    if (src_size > LZ4_MF_LIMIT) {
+        auto table = new u32[1 << LZ4_HASH_BITS]{};
+        const u8 *match_limit = src_end - LZ4_LAST_LITERALS;
+        const u8 *mf_limit = src_end - LZ4_MF_LIMIT;
+
+        while (ip <= mf_limit) {
+            u32 sequence = lz4_read_u32(ip);
+            u32 hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+            const u8 *ref = src + table[hash];
+            table[hash] = (u32)(ip - src);
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || lz4_read_u32(ref) != sequence) {
+                ++ip;
+                continue;
+            }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+
+            const u8 *match_end = ip + LZ4_MIN_MATCH;
+            const u8 *ref_end = ref + LZ4_MIN_MATCH;
+            while (match_end < match_limit && *match_end == *ref_end) {
+                ++match_end;
+                ++ref_end;
+            }
+
+            u64 literal_length = ip - anchor;
+            u64 match_length = (match_end - ip) - LZ4_MIN_MATCH;
+            u64 worst_case = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+            if ((u64)(op_end - op) < worst_case) {
+                delete[] table;
+                return 0;
+            }
+
+            u8 *token = op++;
+            *token = (u8)(MIN(literal_length, 15) << 4);
+            if (literal_length >= 15) op = lz4_write_length(op, literal_length - 15);
+            memcpy(op, anchor, literal_length);
+            op += literal_length;
+
+            u16 offset = (u16)(ip - ref);
+            *op++ = (u8)(offset & 0xff);
+            *op++ = (u8)(offset >> 8);
+
+            *token |= (u8)MIN(match_length, 15);
+            if (match_length >= 15) op = lz4_write_length(op, match_length - 15);
+
+            ip = match_end;
+            anchor = ip;
+        }
+
+        delete[] table;
+    }
+
+    u64 literal_length = src_end - anchor;
+    if ((u64)(op_end - op) < 1 + literal_length / 255 + 1 + literal_length) return 0;
+
+    u8 *token = op++;
+    *token = (u8)(MIN(literal_length, 15) << 4);
+    if (literal_length >= 15) op = lz4_write_length(op, literal_length - 15);
+    memcpy(op, anchor, literal_length);
+    op += literal_length;
+
+    return op - dst;
+}
+
+internal b8 lz4_decompress(const u8 *src, u64 src_size, u8 *dst, u64 dst_size) {
+    const u8 *ip = src;
+    const u8 *ip_end = src + src_size;
+    u8 *op = dst;
+    u8 *op_end = dst + dst_size;
+
+    while (ip < ip_end) {
+        u8 token = *ip++;
+
+        u64 literal_length = token >> 4;
+        if (literal_length == 15) {
+            u8 b;
+            do {
+                if (ip >= ip_end) return false;
+                b = *ip++;
+                literal_length += b;
+            } while (b == 255);
+        }
+        if (literal_length > (u64)(ip_end - ip) || literal_length > (u64)(op_end - op)) return false;
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == ip_end) break; // The last sequence has no match
+
+        if (ip_end - ip < 2) return false;
+        u64 offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (u64)(op - dst)) return false;
+
+        u64 match_length = token & 15;
+        if (match_length == 15) {
+            u8 b;
+            do {
+                if (ip >= ip_end) return false;
+                b = *ip++;
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += LZ4_MIN_MATCH;
+        if (match_length > (u64)(op_end - op)) return false;
+
+        const u8 *match = op - offset;
+        if (offset >= match_length) {
+            memcpy(op, match, match_length);
+        } else {
+            for (u64 i = 0; i < match_length; ++i) op[i] = match[i]; // Overlapping, repeats the pattern
+        }
+        op += match_length;
+    }
+
+    return op == op_end;
+}
+
+// Asset Pack
+// -----------------------------------------------------------------------------
+
+internal u64 asset_hash_name(const char *name) {
+    u64 hash = 0xcbf29ce484222325ull;
+    for (const char *c = name; *c; ++c) {
+        u8 b = (*c == '\\') ? '/' : (u8)*c;
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+internal b8 asset_pack_open(Asset_Pack *pack, const char *path) {
+    *pack = {};
+
+    if (!file_map(path, &pack->file)) {
+        LOG_ERROR("Failed to open asset pack: %s", path);
+        return false;
+    }
+
+    if (pack->file.size < sizeof(Asset_Pack_Header)) {
+        LOG_ERROR("Asset pack is truncated: %s", path);
+        file_unmap(&pack->file);
+        return false;
+    }
+
+    // The offset is checked before anything is added to it, so nothing wraps.
+    auto header = (const Asset_Pack_Header *)pack->file.data;
+    u64 toc_size = (u64)header->entry_count * sizeof(Asset_Pack_Entry);
+    if (header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION ||
+        header->toc_offset > pack->file.size || toc_size > pack->file.size - header->toc_offset) {
+        LOG_ERROR("Not a valid asset pack: %s", path);
+        file_unmap(&pack->file);
+        return false;
+    }
+
+    pack->header = header;
+    pack->entries = (const Asset_Pack_Entry *)(pack->file.data + header->toc_offset);
+
+    // Checked once here, so reads can trust the table. Uncompressed entries
+    // are read with size, so it has to match what is stored.
+    for (u32 i = 0; i < header->entry_count; ++i) {
+        const Asset_Pack_Entry *entry = &pack->entries[i];
+        const char *problem = NULL;
+        if (entry->offset > pack->file.size || entry->stored_size > pack->file.size - entry->offset) {
+            problem = "is out of bounds";
+        } else if (entry->compression != ASSET_COMPRESSION_NONE && entry->compression != ASSET_COMPRESSION_LZ4) {
+            problem = "has an unknown compression";
+        } else if (entry->compression == ASSET_COMPRESSION_NONE && entry->size != entry->stored_size) {
+            problem = "is uncompressed with a size other than its stored size";
+        }
+        if (problem) {
+            LOG_ERROR("Asset pack entry %u %s: %s", i, problem, path);
+            file_unmap(&pack->file);
+            return false;
+        }
+    }
+    return true;
+}
+
+internal void asset_pack_close(Asset_Pack *pack) {
+    file_unmap(&pack->file);
+    *pack = {};
+}
+
+internal const Asset_Pack_Entry *asset_pack_find(Asset_Pack *pack, const char *name) {
+    return asset_pack_find_hash(pack, asset_hash_name(name));
+}
+
+internal const Asset_Pack_Entry *asset_pack_find_hash(Asset_Pack *pack, u64 name_hash) {
+    u32 lo = 0;
+    u32 hi = pack->header->entry_count;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        u64 mid_hash = pack->entries[mid].name_hash;
+        if (mid_hash == name_hash) return &pack->entries[mid];
+        if (mid_hash < name_hash) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+internal const u8 *asset_pack_data(Asset_Pack *pack, const Asset_Pack_Entry *entry) {
+    ASSERT(entry->offset + entry->stored_size <= pack->file.size);
+    return pack->file.data + entry->offset;
+}
+
+internal b8 asset_pack_read(Asset_Pack *pack, const Asset_Pack_Entry *entry, void *dst) {
+    const u8 *data = asset_pack_data(pack, entry);
+
+    switch (entry->compression) {
+        case ASSET_COMPRESSION_NONE:
+            memcpy(dst, data, entry->size);
+            return true;
+
+        case ASSET_COMPRESSION_LZ4:
+            return lz4_decompress(data, entry->stored_size, (u8 *)dst, entry->size);
+
+        default:
+            LOG_ERROR("Unknown asset compression: %u", entry->compression);
+            return false;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// LZ4
+// -----------------------------------------------------------------------------
+
+// Raw LZ4 block format (no frame header), compatible with LZ4_compress_default
+// and LZ4_decompress_safe.
+
+internal u64 lz4_compress_bound(u64 size);
+
+// Returns the compressed size, or 0 if dst is too small.
+internal u64 lz4_compress(const u8 *src, u64 src_size, u8 *dst, u64 dst_capacity);
+
+// Fails on malformed input or if the output isn't exactly dst_size bytes.
+internal b8 lz4_decompress(const u8 *src, u64 src_size, u8 *dst, u64 dst_size);
+
+// Asset Pack
+// -----------------------------------------------------------------------------
+
+// File layout:
+//   Asset_Pack_Header
+//   Asset_Pack_Entry[entry_count], sorted by name_hash
+//   blobs, each starting at an ASSET_PACK_ALIGNMENT aligned offset
+
+#define ASSET_PACK_MAGIC     0x4B503256 // "V2PK"
+#define ASSET_PACK_VERSION   1
+#define ASSET_PACK_ALIGNMENT 16
+
+enum Asset_Compression : u32 {
+    ASSET_COMPRESSION_NONE,
+    ASSET_COMPRESSION_LZ4,
+};
+
+struct Asset_Pack_Header {
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    u32 reserved;
+    u64 toc_offset;
+    u64 data_offset;
+};
+
+struct Asset_Pack_Entry {
+    u64 name_hash;
+    u64 offset;
+    u64 stored_size;
+    u64 size;
+    u32 compression;
+    u32 reserved;
+};
+
+struct Asset_Pack {
+    File_Mapping file;
+    const Asset_Pack_Header *header;
+    const Asset_Pack_Entry *entries;
+};
+
+// Names are hashed with '\' folded to '/', so "textures\a.bin" == "textures/a.bin".
+internal u64 asset_hash_name(const char *name);
+
+internal b8 asset_pack_open(Asset_Pack *pack, const char *path);
+internal void asset_pack_close(Asset_Pack *pack);
+
+internal const Asset_Pack_Entry *asset_pack_find(Asset_Pack *pack, const char *name);
+internal const Asset_Pack_Entry *asset_pack_find_hash(Asset_Pack *pack, u64 name_hash);
+
+// Points into the mapping; only directly usable for uncompressed entries.
+internal const u8 *asset_pack_data(Asset_Pack *pack, const Asset_Pack_Entry *entry);
+
+// Copies (or decompresses) the entry into dst, which must hold entry->size
+// bytes. dst is typically persistently mapped staging memory.
+internal b8 asset_pack_read(Asset_Pack *pack, const Asset_Pack_Entry *entry, void *dst);
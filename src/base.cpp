@@ -30,3 +30,372 @@ internal void log_printf(Log_Level level, const char *fmt, ...) {
 
     fprintf(stderr, "\n");
 }
+
+// Utils
+// -----------------------------------------------------------------------------
+
+internal u32 bit_scan_forward_64(u64 x) {
+    ASSERT(x != 0);
+#if _WIN32
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Hash
+// -----------------------------------------------------------------------------
+
+internal u64 hash_fnv1a_64(const void *data, u64 size) {
+    const u8 *bytes = (const u8 *)data;
+    u64 hash = 0xcbf29ce484222325ull;
+    for (u64 i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Time
+// -----------------------------------------------------------------------------
+
+internal u64 time_now_ns() {
+#if _WIN32
+    // Called from worker threads too, so rely on thread-safe static init.
+    local_persist const u64 frequency = [] {
+        LARGE_INTEGER value;
+        QueryPerformanceFrequency(&value);
+        return (u64)value.QuadPart;
+    }();
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    u64 seconds = counter.QuadPart / frequency;
+    u64 remainder = counter.QuadPart % frequency;
+    return seconds * 1000000000ull + remainder * 1000000000ull / frequency;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+}
+
+internal u64 time_now_cycles() {
+#if defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return time_now_ns();
+#endif
+}
+
+internal void time_sleep_until_ns(u64 deadline_ns) {
+    const u64 spin_ns = 1000000; // Wake this early and spin the rest
+
+    u64 now_ns = time_now_ns();
+    if (deadline_ns > now_ns + spin_ns) {
+#if _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+        // High resolution timers need Windows 10 1803, older versions get
+        // the regular (~1-15 ms) one.
+        local_persist HANDLE timer = [] {
+            HANDLE t = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            if (t == NULL) t = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+            return t;
+        }();
+
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)((deadline_ns - spin_ns - now_ns) / 100); // Relative, in 100 ns units
+        if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject(timer, INFINITE);
+        }
+#else
+        u64 wake_ns = deadline_ns - spin_ns;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wake_ns / 1000000000ull);
+        ts.tv_nsec = (long)(wake_ns % 1000000000ull);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#endif
+    }
+
+    while (time_now_ns() < deadline_ns) std::this_thread::yield();
+}
+
+// Startup Profile
+// -----------------------------------------------------------------------------
+
+internal void startup_begin() {
+    startup_profile.begin_ns = time_now_ns();
+    startup_profile.main_thread = std::this_thread::get_id();
+    startup_profile.phase_count.store(0);
+    startup_profile.reported.store(false);
+}
+
+internal void startup_record(const char *name, u64 start_ns) {
+    u64 end_ns = time_now_ns();
+    if (startup_profile.reported.load(std::memory_order_relaxed)) return;
+
+    u32 index = startup_profile.phase_count.fetch_add(1);
+    if (index >= MAX_STARTUP_PHASES) return;
+
+    Startup_Phase *phase = &startup_profile.phases[index];
+    phase->name = name;
+    phase->start_ns = start_ns;
+    phase->end_ns = end_ns;
+    phase->on_worker = std::this_thread::get_id() != startup_profile.main_thread;
+}
+
+internal void startup_report() {
+    if (startup_profile.reported.exchange(true)) return;
+
+    u64 first_frame_ns = time_now_ns() - startup_profile.begin_ns;
+    u32 phase_count = MIN(startup_profile.phase_count.load(), MAX_STARTUP_PHASES);
+
+    Startup_Phase phases[MAX_STARTUP_PHASES];
+    memcpy(phases, startup_profile.phases, phase_count * sizeof(Startup_Phase));
+    for (u32 i = 1; i < phase_count; ++i) {
+        for (u32 j = i; j > 0 && phases[j - 1].start_ns > phases[j].start_ns; --j) {
+            Startup_Phase tmp = phases[j];
+            phases[j] = phases[j - 1];
+            phases[j - 1] = tmp;
+        }
+    }
+
+    LOG_INFO("Startup: first frame after %.2f ms", NS_TO_MS(first_frame_ns));
+
+    u64 main_ns = 0;
+    u64 worker_ns = 0;
+    for (u32 i = 0; i < phase_count; ++i) {
+        Startup_Phase *phase = &phases[i];
+        u64 duration_ns = phase->end_ns - phase->start_ns;
+        if (phase->on_worker) worker_ns += duration_ns;
+        else main_ns += duration_ns;
+
+        LOG_INFO("  %8.2f ms +%8.2f ms  %-6s  %s",
+            NS_TO_MS(phase->start_ns - startup_profile.begin_ns), NS_TO_MS(duration_ns),
+            phase->on_worker ? "worker" : "main", phase->name);
+    }
+
+    LOG_INFO("Startup: %.2f ms of phases on the main thread, %.2f ms on workers",
+        NS_TO_MS(main_ns), NS_TO_MS(worker_ns));
+}
+
+// Microbenchmarks
+// -----------------------------------------------------------------------------
+
+internal b8 benchmark_register(const char *name, Benchmark_Proc *proc) {
+    ASSERT(benchmark_count < MAX_BENCHMARKS);
+    benchmarks[benchmark_count++] = {name, proc};
+    return true;
+}
+
+internal void benchmark_reset_timer(Benchmark_State *state) {
+    state->start_ns = time_now_ns();
+    state->start_cycles = time_now_cycles();
+}
+
+internal u32 benchmark_run(const char *filter, Benchmark_Result *results) {
+    u32 result_count = 0;
+    for (u32 i = 0; i < benchmark_count; ++i) {
+        Benchmark *benchmark = &benchmarks[i];
+        if (filter && filter[0] && !strstr(benchmark->name, filter)) continue;
+
+        Benchmark_Result *result = &results[result_count++];
+        benchmark_run_one(benchmark, result);
+
+        char throughput[64] = "";
+        if (result->items_per_s > 0.0) {
+            snprintf(throughput, sizeof(throughput), "%10.2f M items/s", result->items_per_s / 1e6);
+        } else if (result->bytes_per_s > 0.0) {
+            snprintf(throughput, sizeof(throughput), "%10.2f MB/s", result->bytes_per_s / (f64)MB(1));
+        }
+        LOG_INFO("%-32s %12.1f ns +- %5.1f%% %12.0f cycles %s", result->name, result->ns,
+            100.0 * result->mad_ns / MAX(result->ns, 1e-9), result->cycles, throughput);
+    }
+    return result_count;
+}
+
+internal void benchmark_run_one(Benchmark *benchmark, Benchmark_Result *result) {
+    *result = {};
+    result->name = benchmark->name;
+
+    // Calibrate: grow the count until a sample is long enough to time, by at
+    // most 100x a step since very short samples are mostly noise.
+    Benchmark_State state{};
+    state.iterations = 1;
+    u64 ns, cycles;
+    for (;;) {
+        benchmark_sample(benchmark, &state, &ns, &cycles);
+        if (ns >= BENCHMARK_MIN_SAMPLE_NS || state.iterations >= BENCHMARK_MAX_ITERATIONS) break;
+
+        f64 scale = CLAMP(2.0, 1.5 * BENCHMARK_MIN_SAMPLE_NS / MAX(ns, 1), 100.0);
+        state.iterations = MIN((u64)(state.iterations * scale), BENCHMARK_MAX_ITERATIONS);
+    }
+    result->iterations = state.iterations;
+
+    f64 sample_ns[BENCHMARK_SAMPLES];
+    f64 sample_cycles[BENCHMARK_SAMPLES];
+    for (u32 s = 0; s < BENCHMARK_SAMPLES; ++s) {
+        benchmark_sample(benchmark, &state, &ns, &cycles);
+        sample_ns[s] = (f64)ns / state.iterations;
+        sample_cycles[s] = (f64)cycles / state.iterations;
+    }
+
+    result->ns = benchmark_median(sample_ns, BENCHMARK_SAMPLES);
+    result->cycles = benchmark_median(sample_cycles, BENCHMARK_SAMPLES);
+    for (u32 s = 0; s < BENCHMARK_SAMPLES; ++s) {
+        sample_ns[s] = fabs(sample_ns[s] - result->ns);
+    }
+    result->mad_ns = benchmark_median(sample_ns, BENCHMARK_SAMPLES);
+
+    f64 per_s = 1e9 / MAX(result->ns, 1e-9);
+    result->items_per_s = state.items * per_s;
+    result->bytes_per_s = state.bytes * per_s;
+}
+
+internal void benchmark_sample(Benchmark *benchmark, Benchmark_State *state, u64 *ns, u64 *cycles) {
+    state->items = 0;
+    state->bytes = 0;
+    benchmark_reset_timer(state);
+    benchmark->proc(state);
+    *ns = time_now_ns() - state->start_ns;
+    *cycles = time_now_cycles() - state->start_cycles;
+}
+
+internal s32 benchmark_compare_f64(const void *a, const void *b) {
+    f64 x = *(const f64 *)a;
+    f64 y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+internal f64 benchmark_median(f64 *values, u32 count) {
+    qsort(values, count, sizeof(f64), benchmark_compare_f64);
+    if (count % 2) return values[count / 2];
+    return (values[count / 2 - 1] + values[count / 2]) * 0.5;
+}
+
+internal void benchmark_write_json(FILE *file, Benchmark_Result *results, u32 count) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"build\": \"%s\",\n", BUILD_PROFILE_NAME);
+    fprintf(file, "  \"samples\": %u,\n", BENCHMARK_SAMPLES);
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (u32 i = 0; i < count; ++i) {
+        Benchmark_Result *result = &results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns\": %.3f, \"mad_ns\": %.3f, "
+            "\"cycles\": %.1f, \"items_per_s\": %.1f, \"bytes_per_s\": %.1f}%s\n",
+            result->name, (unsigned long long)result->iterations, result->ns, result->mad_ns,
+            result->cycles, result->items_per_s, result->bytes_per_s, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+// Files
+// -----------------------------------------------------------------------------
+
+internal FILE *file_open(const char *path, const char *mode) {
+#if _WIN32
+    FILE *file = NULL;
+    if (fopen_s(&file, path, mode) != 0) return NULL;
+    return file;
+#else
+    return fopen(path, mode);
+#endif
+}
+
+internal b8 file_map(const char *path, File_Mapping *mapping) {
+    *mapping = {};
+
+#if _WIN32
+    mapping->file = CreateFileA(
+        path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mapping->file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(mapping->file, &size);
+    mapping->size = size.QuadPart;
+
+    if (mapping->size > 0) {
+        mapping->mapping = CreateFileMappingA(mapping->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping->mapping == NULL) {
+            CloseHandle(mapping->file);
+            return false;
+        }
+        mapping->data = (u8 *)MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (mapping->data == NULL) {
+            CloseHandle(mapping->mapping);
+            CloseHandle(mapping->file);
+            return false;
+        }
+    }
+#else
+    mapping->fd = open(path, O_RDONLY);
+    if (mapping->fd < 0) return false;
+
+    struct stat st;
+    fstat(mapping->fd, &st);
+    mapping->size = st.st_size;
+
+    if (mapping->size > 0) {
+        void *data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, mapping->fd, 0);
+        if (data == MAP_FAILED) {
+            close(mapping->fd);
+            return false;
+        }
+        mapping->data = (u8 *)data;
+    }
+#endif
+
+    return true;
+}
+
+internal void file_unmap(File_Mapping *mapping) {
+#if _WIN32
+    if (mapping->data) UnmapViewOfFile(mapping->data);
+    if (mapping->mapping) CloseHandle(mapping->mapping);
+    CloseHandle(mapping->file);
+#else
+    if (mapping->data) munmap(mapping->data, mapping->size);
+    close(mapping->fd);
+#endif
+    *mapping = {};
+}
+
+internal void file_evict_cache(const char *path) {
+#if _WIN32
+    // Opening a file unbuffered makes the cache manager purge its cached pages.
+    HANDLE file = CreateFileA(
+        path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    s32 fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#endif
+}
+
+// Environment
+// -----------------------------------------------------------------------------
+
+internal b8 env_get(const char *name, char *buffer, u64 buffer_size) {
+#if _WIN32
+    DWORD length = GetEnvironmentVariableA(name, buffer, (DWORD)buffer_size);
+    return length > 0 && length < buffer_size;
+#else
+    const char *value = getenv(name);
+    if (value == NULL) return false;
+
+    u64 length = strlen(value);
+    if (length >= buffer_size) return false;
+    memcpy(buffer, value, length + 1);
+    return true;
+#endif
+}
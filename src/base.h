@@ -8,6 +8,28 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
 // Codebase Keywords
 // -----------------------------------------------------------------------------
@@ -37,15 +59,46 @@ typedef s64      b64;
 typedef float    f32;
 typedef double   f64;
 
+// Build Configuration
+// -----------------------------------------------------------------------------
+
+// Debug builds keep asserts, validation layers and object names. Release
+// builds (BUILD_DEBUG=0) compile all of that out.
+#ifndef BUILD_DEBUG
+#define BUILD_DEBUG 1
+#endif
+
+#if BUILD_DEBUG
+#define BUILD_PROFILE_NAME "debug"
+#else
+#define BUILD_PROFILE_NAME "release"
+#endif
+
 // Assert
 // -----------------------------------------------------------------------------
 
+// SIGTRAP rather than __builtin_trap, so a debugger can step past it.
+#if _WIN32
+#define DEBUG_BREAK() __debugbreak()
+#else
+#define DEBUG_BREAK() raise(SIGTRAP)
+#endif
+
+// The expression is not evaluated in release builds, so it must not have side
+// effects.
+#if BUILD_DEBUG
 #define ASSERT(expr)        \
     do {                    \
         if (!(expr)) {      \
-            __debugbreak(); \
+            DEBUG_BREAK();  \
         }                   \
     } while (0)
+#else
+#define ASSERT(expr)         \
+    do {                     \
+        (void)sizeof(expr);  \
+    } while (0)
+#endif
 
 // Utils
 // -----------------------------------------------------------------------------
@@ -55,6 +108,211 @@ typedef double   f64;
 #define MIN(a,b)     (((a) < (b)) ? (a) : (b))
 #define MAX(a,b)     (((a) > (b)) ? (a) : (b))
 #define CLAMP(a,x,b) (((x) < (a)) ? (a) : ((x) > (b)) ? (b) : (x))
+
+#define KB(n) (((u64)(n)) << 10)
+#define MB(n) (((u64)(n)) << 20)
+#define GB(n) (((u64)(n)) << 30)
+
+#define ALIGN_UP(x, a) (((x) + ((a) - 1)) & ~((u64)(a) - 1))
+
+// Index of the lowest set bit. x must not be 0.
+internal u32 bit_scan_forward_64(u64 x);
+
+// Hash
+// -----------------------------------------------------------------------------
+
+internal u64 hash_fnv1a_64(const void *data, u64 size);
+
+// Time
+// -----------------------------------------------------------------------------
+
+// Monotonic clock in nanoseconds, only meaningful as a difference.
+internal u64 time_now_ns();
+
+// Sleeps most of the way, then spins, so frame pacing isn't at the mercy of
+// the scheduler's timer resolution.
+internal void time_sleep_until_ns(u64 deadline_ns);
+
+// The CPU's timestamp counter (rdtsc) on x86, time_now_ns elsewhere. Cheap to
+// read, but it ticks at a fixed reference rate rather than the core clock.
+internal u64 time_now_cycles();
+
+#define NS_TO_MS(ns) ((f64)(ns) / 1000000.0)
+#define NS_TO_S(ns)  ((f64)(ns) / 1000000000.0)
+
+// Startup Profile
+// -----------------------------------------------------------------------------
+
+// Records how long each init phase took, and on which thread, until the first
+// frame is presented. Phases may run concurrently but should not nest.
+
+#define MAX_STARTUP_PHASES 64
+
+struct Startup_Phase {
+    const char *name;
+    u64 start_ns;
+    u64 end_ns;
+    b8 on_worker;
+};
+
+struct Startup_Profile {
+    u64 begin_ns;
+    std::thread::id main_thread;
+    std::atomic<u32> phase_count;
+    std::atomic<b8> reported;
+    Startup_Phase phases[MAX_STARTUP_PHASES];
+};
+
+global Startup_Profile startup_profile;
+
+internal void startup_begin();
+
+// Records a phase that started at start_ns and ends now. Thread safe, and a
+// no-op once the report has been printed.
+internal void startup_record(const char *name, u64 start_ns);
+
+// Logs the breakdown. Call once the first frame has been presented.
+internal void startup_report();
+
+#define STARTUP_TIME(call)                             \
+    do {                                               \
+        u64 startup_start_ns_ = time_now_ns();         \
+        call;                                          \
+        startup_record(#call, startup_start_ns_);      \
+    } while (0)
+
+// Microbenchmarks
+// -----------------------------------------------------------------------------
+
+// CPU kernels are timed in isolation by registering them at file scope:
+//
+//     BENCHMARK(hash_fnv1a_4k) {
+//         u8 data[KB(4)] = {};
+//         state->bytes = sizeof(data);
+//         benchmark_reset_timer(state); // Setup above isn't timed
+//         for (u64 i = 0; i < state->iterations; ++i) {
+//             benchmark_do_not_optimize(hash_fnv1a_64(data, sizeof(data)));
+//         }
+//     }
+//
+// The iteration count is raised until one sample takes BENCHMARK_MIN_SAMPLE_NS,
+// then BENCHMARK_SAMPLES samples are taken and reported as the median time per
+// iteration and its median absolute deviation, which outliers from preemption
+// or frequency changes barely move.
+
+#define MAX_BENCHMARKS           128
+#define BENCHMARK_SAMPLES        15
+#define BENCHMARK_MIN_SAMPLE_NS  10000000 // 10 ms
+#define BENCHMARK_MAX_ITERATIONS (1ull << 40)
+
+struct Benchmark_State {
+    u64 iterations; // To run, set by the harness
+    u64 start_ns;
+    u64 start_cycles;
+
+    // Processed per iteration, for throughput. 0 leaves the unit out.
+    u64 items;
+    u64 bytes;
+};
+
+typedef void Benchmark_Proc(Benchmark_State *state);
+
+struct Benchmark {
+    const char *name;
+    Benchmark_Proc *proc;
+};
+
+struct Benchmark_Result {
+    const char *name;
+    u64 iterations; // Per sample
+    f64 ns;         // Per iteration, median of the samples
+    f64 mad_ns;     // Median absolute deviation of ns
+    f64 cycles;     // Per iteration, median, in time_now_cycles ticks
+    f64 items_per_s;
+    f64 bytes_per_s;
+};
+
+global Benchmark benchmarks[MAX_BENCHMARKS];
+global u32 benchmark_count;
+
+// Called by BENCHMARK during static initialization.
+internal b8 benchmark_register(const char *name, Benchmark_Proc *proc);
+
+#define BENCHMARK(name)                                                                      \
+    internal void benchmark_##name(Benchmark_State *state);                                  \
+    global b8 benchmark_registered_##name = benchmark_register(#name, benchmark_##name);   \
+    internal void benchmark_##name(Benchmark_State *state)
+
+// Restarts the sample's clock, so setup before the loop isn't measured.
+internal void benchmark_reset_timer(Benchmark_State *state);
+
+// Runs every benchmark whose name contains filter (all for NULL or ""),
+// logging each result. Returns how many ran; results needs MAX_BENCHMARKS.
+internal u32 benchmark_run(const char *filter, Benchmark_Result *results);
+internal void benchmark_run_one(Benchmark *benchmark, Benchmark_Result *result);
+internal void benchmark_sample(Benchmark *benchmark, Benchmark_State *state, u64 *ns, u64 *cycles);
+internal f64 benchmark_median(f64 *values, u32 count); // Sorts values
+
+internal void benchmark_write_json(FILE *file, Benchmark_Result *results, u32 count);
+
+// Makes the compiler treat value as used, so the work producing it can't be
+// optimized away.
+global const volatile void *volatile benchmark_sink;
+
+template <typename T>
+internal inline void benchmark_do_not_optimize(const T &value) {
+#if _MSC_VER
+    // No inline assembly on x64; publishing the address forces the value into
+    // memory, and the barrier keeps the store where it is.
+    benchmark_sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Makes the compiler assume all memory was read and written, so stores the
+// benchmark doesn't read back aren't dropped.
+internal inline void benchmark_clobber_memory() {
+#if _MSC_VER
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : : "memory");
+#endif
+}
+
+// Files
+// -----------------------------------------------------------------------------
+
+// fopen, except through fopen_s where the CRT deprecates the former. Returns
+// NULL on failure.
+internal FILE *file_open(const char *path, const char *mode);
+
+struct File_Mapping {
+    u8 *data;
+    u64 size;
+#if _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    s32 fd;
+#endif
+};
+
+// Maps a whole file read-only. Returns false if the file can't be opened.
+internal b8 file_map(const char *path, File_Mapping *mapping);
+internal void file_unmap(File_Mapping *mapping);
+
+// Best effort: drops the file's pages from the OS page cache so the next read
+// is a cold one. Used by benchmarks.
+internal void file_evict_cache(const char *path);
+
+// Environment
+// -----------------------------------------------------------------------------
+
+// Returns false if the variable isn't set or doesn't fit in buffer.
+internal b8 env_get(const char *name, char *buffer, u64 buffer_size);
+
 // Log
 // -----------------------------------------------------------------------------
 
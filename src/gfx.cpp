@@ -1,83 +1,125 @@
 // -----------------------------------------------------------------------------
 
-internal Vk_Context *vk_init(GLFWwindow *window) {
-    if (!vk_check_validation_layer_support()) {
-        LOG_FATAL("Validation layers requested, but not available");
-    }
-
+internal Vk_Context *vk_init_begin(Job_System *jobs, Vk_Config *config) {
     auto context = new Vk_Context{};
+    context->jobs = jobs;
+    context->config = *config;
+    context->present_mode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+    context->camera.zoom = 1.0f;
 
-    vk_create_instance(context);
-    vk_create_debug_messenger(context);
-    vk_create_surface(context, window);
-    vk_pick_physical_device(context);
-    vk_create_device(context);
-    vk_create_command_buffer(context);
-
-    vk_create_swapchain(context, window);
-    vk_create_render_pass(context);
-    vk_create_graphics_pipeline(context);
-
-    vk_create_framebuffers(context);
-    vk_create_sync_objects(context);
-
-    {
-        context->vertex_count = ARRAY_COUNT(vk_quad_vertices);
+    vk_init_host_allocator(&context->host_allocator);
+    context->allocator = &context->host_allocator.callbacks;
+    context->capture.recorded_slot = VK_CAPTURE_NONE;
 
-        VkDeviceSize vert_size = sizeof(vk_quad_vertices);
+    // Loading the Vulkan loader and layers is slow, so it overlaps with the
+    // caller creating the window.
+    job_submit(jobs, vk_create_instance_job, context, &context->init_jobs);
 
-        vk_create_buffer(
-            context, vert_size,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &context->vertex_buffer,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &context->vertex_buffer_memory);
+    return context;
+}
 
-        {
-            void *data;
-            VK_CHECK(vkMapMemory(context->device, context->vertex_buffer_memory, 0, vert_size, 0, &data));
-            memcpy(data, vk_quad_vertices, (u64)vert_size);
-            vkUnmapMemory(context->device, context->vertex_buffer_memory);
+internal void vk_init_end(Vk_Context *context, GLFWwindow *window) {
+    STARTUP_TIME(job_wait(context->jobs, &context->init_jobs));
+
+    ASSERT(context->config.headless == (window == NULL));
+    context->window = window;
+    if (!context->config.headless) STARTUP_TIME(vk_create_surface(context, window));
+    STARTUP_TIME(vk_pick_physical_device(context));
+    STARTUP_TIME(vk_create_device(context));
+    STARTUP_TIME(vk_init_statistics(context));
+
+    // The render pass only needs the surface format, so the pipeline can be
+    // built on a worker while the swapchain and the rest are created here.
+    context->swapchain_image_format = context->config.headless ?
+        VK_HEADLESS_FORMAT : vk_choose_surface_format(&context->swapchain_support).format;
+    STARTUP_TIME(vk_init_resolution(context));
+    context->depth_format = vk_choose_depth_format(context);
+    STARTUP_TIME(vk_create_render_pass(context));
+    STARTUP_TIME(vk_create_texture_resources(context));
+    job_submit(context->jobs, vk_create_graphics_pipeline_job, context, &context->init_jobs);
+
+    STARTUP_TIME(vk_create_command_buffer(context));
+    STARTUP_TIME(vk_create_swapchain(context, window));
+    STARTUP_TIME(vk_create_sync_objects(context));
+    STARTUP_TIME(vk_create_frame_graph(context));
+    STARTUP_TIME(vk_create_framebuffers(context)); // Needs the graph's scene target
+
+    STARTUP_TIME(vk_create_staging_buffer(context, STAGING_BUFFER_SIZE, &context->staging));
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, context->staging.buffer, "staging");
+    STARTUP_TIME(vk_create_instance_buffer(context));
+
+    { // Quad mesh and placeholder texture
+        u64 start_ns = time_now_ns();
+
+        vk_create_mesh(context, ARRAY_COUNT(vk_quad_vertices), ARRAY_COUNT(vk_quad_indices), &context->quad_mesh);
+        vk_compute_mesh_extent(vk_quad_vertices, ARRAY_COUNT(vk_quad_vertices), context->quad_mesh.extent);
+        VK_NAME(context, VK_OBJECT_TYPE_BUFFER, context->quad_mesh.vertex_buffer, "quad vertices");
+        VK_NAME(context, VK_OBJECT_TYPE_BUFFER, context->quad_mesh.index_buffer, "quad indices");
+
+        VkDeviceSize vertex_offset;
+        u8 *vertex_data = vk_staging_push(&context->staging, sizeof(vk_quad_vertices), 16, &vertex_offset);
+        if (vertex_data == NULL) LOG_FATAL("Staging buffer too small for the quad mesh");
+        memcpy(vertex_data, vk_quad_vertices, sizeof(vk_quad_vertices));
+
+        VkDeviceSize index_offset;
+        u8 *index_data = vk_staging_push(&context->staging, sizeof(vk_quad_indices), 16, &index_offset);
+        if (index_data == NULL) LOG_FATAL("Staging buffer too small for the quad mesh");
+        memcpy(index_data, vk_quad_indices, sizeof(vk_quad_indices));
+
+        u32 size = PLACEHOLDER_TEXTURE_SIZE;
+        vk_create_texture(context, size, size, &context->placeholder_texture);
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE, context->placeholder_texture.image, "placeholder texture");
+        ASSERT(context->placeholder_texture.index == 0);
+
+        // Without partially bound descriptors every slot has to be valid.
+        for (u32 i = 1; i < context->texture_capacity; ++i) {
+            vk_write_texture_slot(context, i, context->placeholder_texture.view);
         }
 
-        context->index_count = ARRAY_COUNT(vk_quad_indices);
+        VkDeviceSize pixel_offset;
+        u32 *pixels = (u32 *)vk_staging_push(&context->staging, size * size * 4, 16, &pixel_offset);
+        if (pixels == NULL) LOG_FATAL("Staging buffer too small for the placeholder texture");
+        for (u32 y = 0; y < size; ++y) {
+            for (u32 x = 0; x < size; ++x) {
+                b8 odd = ((x / (size / 4)) + (y / (size / 4))) & 1;
+                pixels[y * size + x] = odd ? 0xffff00ff : 0xff202020; // ABGR: magenta / dark grey
+            }
+        }
 
-        VkDeviceSize copy_size = sizeof(vk_quad_indices);
+        VkCommandBuffer command_buffer = vk_begin_one_time_commands(context);
+        vk_cmd_upload_mesh(command_buffer, context->staging.buffer, vertex_offset, index_offset, &context->quad_mesh);
+        vk_cmd_upload_texture(command_buffer, context->staging.buffer, pixel_offset, &context->placeholder_texture);
+        vk_end_one_time_commands(context, command_buffer);
 
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        vk_create_buffer(
-            context, copy_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &staging_buffer,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_buffer_memory);
+        vk_staging_reset(&context->staging);
 
-        {
-            void *data;
-            vkMapMemory(context->device, staging_buffer_memory, 0, copy_size, 0, &data);
-            memcpy(data, vk_quad_indices, (u64)copy_size);
-            vkUnmapMemory(context->device, staging_buffer_memory);
-        }
+        startup_record("quad mesh and placeholder texture upload", start_ns);
+    }
 
-        vk_create_buffer(
-            context, copy_size,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &context->index_buffer,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &context->index_buffer_memory);
+    STARTUP_TIME(job_wait(context->jobs, &context->init_jobs));
+}
 
-        vk_copy_buffer(context, staging_buffer, context->index_buffer, copy_size);
+internal void vk_create_instance_job(void *data) {
+    auto context = (Vk_Context *)data;
 
-        vkDestroyBuffer(context->device, staging_buffer, context->allocator);
-        vkFreeMemory(context->device, staging_buffer_memory, context->allocator);
-    }
+    STARTUP_TIME(vk_create_instance(context));
+#if BUILD_DEBUG
+    STARTUP_TIME(vk_create_debug_messenger(context));
+#endif
+}
 
-    return context;
+internal void vk_create_graphics_pipeline_job(void *data) {
+    auto context = (Vk_Context *)data;
+    STARTUP_TIME(vk_create_graphics_pipeline(context));
 }
 
 internal void vk_cleanup(Vk_Context *context) {
-    {
-        vkDestroyBuffer(context->device, context->vertex_buffer, context->allocator);
-        vkFreeMemory(context->device, context->vertex_buffer_memory, context->allocator);
+    vk_cleanup_texture(context, &context->placeholder_texture);
+    vk_cleanup_mesh(context, &context->quad_mesh);
 
-        vkDestroyBuffer(context->device, context->index_buffer, context->allocator);
-        vkFreeMemory(context->device, context->index_buffer_memory, context->allocator);
-    }
+    vk_cleanup_staging_buffer(context, &context->staging);
+    vk_cleanup_instance_buffer(context);
+    vk_cleanup_capture(context);
 
     vkDestroySemaphore(context->device, context->image_available_semaphore, context->allocator);
     vkDestroySemaphore(context->device, context->render_finished_semaphore, context->allocator);
@@ -85,18 +127,24 @@ internal void vk_cleanup(Vk_Context *context) {
 
     vkDestroyCommandPool(context->device, context->command_pool, context->allocator);
 
+    graph_destroy(context->graph, context);
     vk_cleanup_framebuffers(context);
 
-    vkDestroyPipeline(context->device, context->graphics_pipeline, context->allocator);
-    vkDestroyPipelineLayout(context->device, context->pipeline_layout, context->allocator);
+    vk_cleanup_pipelines(context);
+
+    vk_cleanup_texture_resources(context);
 
     vkDestroyRenderPass(context->device, context->render_pass, context->allocator);
+    vkDestroyRenderPass(context->device, context->overlay_render_pass, context->allocator);
+    vk_cleanup_resolution(context);
+    vk_cleanup_statistics(context);
 
     vk_cleanup_swapchain(context);
 
     vk_cleanup_swapchain_support(&context->swapchain_support);
     vkDestroyDevice(context->device, context->allocator);
 
+#if BUILD_DEBUG
     {
         PFN_vkDestroyDebugUtilsMessengerEXT callback =
             (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
@@ -104,24 +152,60 @@ internal void vk_cleanup(Vk_Context *context) {
 
         callback(context->instance, context->debug_messenger, context->allocator);
     }
+#endif
 
-    vkDestroySurfaceKHR(context->instance, context->surface, context->allocator);
+    if (context->surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(context->instance, context->surface, context->allocator);
+    }
     vkDestroyInstance(context->instance, context->allocator);
+    vk_cleanup_host_allocator(&context->host_allocator);
 
     delete context;
     context = NULL;
 }
 
-internal void vk_draw_frame(Vk_Context *context) {
-    vkWaitForFences(context->device, 1, &context->in_flight_fence, VK_TRUE, UINT64_MAX);
+internal void vk_draw_frame(Vk_Context *context, Vk_Draw_Item *items, u32 item_count) {
+    vk_error.recoverable.store(true, std::memory_order_relaxed);
+    if (vk_failed()) return;
+
+    context->frame_timing.begin_ns = time_now_ns();
+
+    VK_CHECK(vkWaitForFences(context->device, 1, &context->in_flight_fence, VK_TRUE, UINT64_MAX));
+    if (vk_failed()) return;
+
+    vk_update_resolution(context);
+    vk_update_statistics(context);
+    vk_update_memory_budget(context);
+    vk_collect_capture(context);
+
+    // The last frame is done with the texture set, and nothing else reads it.
+    vk_flush_texture_slots(context);
+
+    u32 image_index = 0;
+    b8 headless = context->config.headless;
+    if (!headless) {
+        // Suboptimal still acquires an image, so that frame is presented first.
+        VkResult result = vkAcquireNextImageKHR(
+            context->device, context->swapchain, UINT64_MAX, context->image_available_semaphore, VK_NULL_HANDLE,
+            &image_index);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            vk_refresh_swapchain(context);
+            return;
+        }
+        VK_CHECK(result);
+        if (vk_failed()) return;
+    }
+    context->frame_timing.ready_ns = time_now_ns();
+
+    // Only once the frame is sure to submit, so an early return leaves the
+    // fence signaled for the next wait.
     vkResetFences(context->device, 1, &context->in_flight_fence);
 
-    u32 image_index;
-    VK_CHECK(vkAcquireNextImageKHR(
-        context->device, context->swapchain, UINT64_MAX, context->image_available_semaphore, VK_NULL_HANDLE, &image_index));
+    if (context->camera_latch) context->camera_latch(&context->camera, context->camera_latch_data);
 
     VK_CHECK(vkResetCommandBuffer(context->command_buffer, 0));
-    vk_record_command_buffer(context, image_index);
+    vk_record_command_buffer(context, image_index, items, item_count);
+    if (vk_failed()) return;
 
     VkSemaphore wait_semaphores[] = {context->image_available_semaphore};
     VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -129,15 +213,22 @@ internal void vk_draw_frame(Vk_Context *context) {
 
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.waitSemaphoreCount = 1;
+    submit_info.waitSemaphoreCount = headless ? 0 : 1;
     submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.pWaitDstStageMask = wait_stages;
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &context->command_buffer;
-    submit_info.signalSemaphoreCount = 1;
+    submit_info.signalSemaphoreCount = headless ? 0 : 1;
     submit_info.pSignalSemaphores = signal_semaphores;
+    context->frame_timing.submit_ns = time_now_ns();
     VK_CHECK(vkQueueSubmit(context->graphics_queue, 1, &submit_info, context->in_flight_fence));
 
+    if (headless) {
+        // Nothing to present; the frame is done once submitted.
+        context->frame_timing.present_ns = time_now_ns();
+        return;
+    }
+
     VkSwapchainKHR swap_chains[] = {context->swapchain};
 
     VkPresentInfoKHR present_info{};
@@ -148,15 +239,165 @@ internal void vk_draw_frame(Vk_Context *context) {
     present_info.pSwapchains = swap_chains;
     present_info.pImageIndices = &image_index;
     present_info.pResults = NULL; // optional
-    VK_CHECK(vkQueuePresentKHR(context->present_queue, &present_info));
+    VkResult result = vkQueuePresentKHR(context->present_queue, &present_info);
+    context->frame_timing.present_ns = time_now_ns();
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        vk_refresh_swapchain(context);
+    } else {
+        VK_CHECK(result);
+    }
 }
 
 internal void vk_wait_idle(Vk_Context *context) {
     vkDeviceWaitIdle(context->device);
 }
 
+internal void vk_recreate_swapchain(Vk_Context *context, GLFWwindow *window) {
+    vk_wait_idle(context);
+
+    u64 start_ns = time_now_ns();
+    vk_cleanup_framebuffers(context);
+    vk_cleanup_swapchain(context);
+    vk_create_swapchain(context, window);
+
+    // Transients are sized relative to the swapchain.
+    graph_compile(context->graph, context);
+    vk_create_framebuffers(context);
+
+    LOG_DEBUG("Swapchain recreated at %ux%u in %.3f ms (%s)", context->swapchain_extent.width,
+        context->swapchain_extent.height, NS_TO_MS(time_now_ns() - start_ns), vk_rendering_path_name(context->rendering_path));
+}
+
+internal void vk_refresh_swapchain(Vk_Context *context) {
+    s32 width, height;
+    glfwGetFramebufferSize(context->window, &width, &height);
+    if (width == 0 || height == 0) return;
+    vk_recreate_swapchain(context, context->window);
+}
+
+internal void vk_get_frame_stats(Vk_Context *context, Vk_Frame_Stats *stats) {
+    *stats = context->stats;
+}
+
+internal void vk_count_upload(Vk_Context *context, u64 bytes) {
+    context->pending_upload_bytes += bytes;
+}
+
+internal void vk_set_overdraw_heatmap(Vk_Context *context, b8 enabled) {
+    context->overdraw_heatmap = enabled;
+}
+
+internal VkExtent2D vk_scene_extent(Vk_Context *context) {
+    VkExtent2D extent = context->swapchain_extent;
+    if (!context->resolution.enabled) return extent;
+
+    f32 scale = context->resolution.scale;
+    extent.width = MAX((u32)(extent.width * scale + 0.5f), 1);
+    extent.height = MAX((u32)(extent.height * scale + 0.5f), 1);
+    return extent;
+}
+
+internal void vk_camera_view_projection(Vk_Camera *camera, VkExtent2D extent, f32 view_projection[16]) {
+    f32 aspect = (f32)extent.width / (f32)MAX(extent.height, 1);
+    f32 scale_x = camera->zoom / aspect;
+    f32 scale_y = camera->zoom;
+    f32 c = cosf(camera->rotation);
+    f32 s = sinf(camera->rotation);
+
+    // Translate by -position, rotate by -rotation, then scale to clip space.
+    f32 *m = view_projection;
+    memset(m, 0, 16 * sizeof(f32));
+    m[0] = scale_x * c;
+    m[1] = -scale_y * s;
+    m[4] = scale_x * s;
+    m[5] = scale_y * c;
+    m[10] = 1.0f;
+    m[12] = -(m[0] * camera->position[0] + m[4] * camera->position[1]);
+    m[13] = -(m[1] * camera->position[0] + m[5] * camera->position[1]);
+    m[15] = 1.0f;
+}
+
+internal Vk_Bounds vk_camera_bounds(Vk_Camera *camera, VkExtent2D extent) {
+    f32 aspect = (f32)extent.width / (f32)MAX(extent.height, 1);
+    f32 half_width = aspect / camera->zoom;
+    f32 half_height = 1.0f / camera->zoom;
+    f32 c = fabsf(cosf(camera->rotation));
+    f32 s = fabsf(sinf(camera->rotation));
+
+    f32 extent_x = c * half_width + s * half_height;
+    f32 extent_y = s * half_width + c * half_height;
+
+    Vk_Bounds bounds;
+    bounds.min[0] = camera->position[0] - extent_x;
+    bounds.min[1] = camera->position[1] - extent_y;
+    bounds.max[0] = camera->position[0] + extent_x;
+    bounds.max[1] = camera->position[1] + extent_y;
+    return bounds;
+}
+
+internal void vk_camera_pixels_to_world(Vk_Camera *camera, VkExtent2D extent, f32 pixels[2], f32 world[2]) {
+    // The view is 2 / zoom world units tall.
+    f32 units_per_pixel = 2.0f / ((f32)MAX(extent.height, 1) * camera->zoom);
+    f32 x = pixels[0] * units_per_pixel;
+    f32 y = pixels[1] * units_per_pixel;
+    f32 c = cosf(camera->rotation);
+    f32 s = sinf(camera->rotation);
+
+    world[0] = c * x - s * y;
+    world[1] = s * x + c * y;
+}
+
 // -----------------------------------------------------------------------------
 
+internal const char *vk_result_name(VkResult result) {
+    switch (result) {
+        case VK_SUCCESS:                        return "VK_SUCCESS";
+        case VK_NOT_READY:                      return "VK_NOT_READY";
+        case VK_TIMEOUT:                        return "VK_TIMEOUT";
+        case VK_INCOMPLETE:                     return "VK_INCOMPLETE";
+        case VK_SUBOPTIMAL_KHR:                 return "VK_SUBOPTIMAL_KHR";
+        case VK_ERROR_OUT_OF_HOST_MEMORY:       return "VK_ERROR_OUT_OF_HOST_MEMORY";
+        case VK_ERROR_OUT_OF_DEVICE_MEMORY:     return "VK_ERROR_OUT_OF_DEVICE_MEMORY";
+        case VK_ERROR_INITIALIZATION_FAILED:    return "VK_ERROR_INITIALIZATION_FAILED";
+        case VK_ERROR_DEVICE_LOST:              return "VK_ERROR_DEVICE_LOST";
+        case VK_ERROR_MEMORY_MAP_FAILED:        return "VK_ERROR_MEMORY_MAP_FAILED";
+        case VK_ERROR_LAYER_NOT_PRESENT:        return "VK_ERROR_LAYER_NOT_PRESENT";
+        case VK_ERROR_EXTENSION_NOT_PRESENT:    return "VK_ERROR_EXTENSION_NOT_PRESENT";
+        case VK_ERROR_FEATURE_NOT_PRESENT:      return "VK_ERROR_FEATURE_NOT_PRESENT";
+        case VK_ERROR_INCOMPATIBLE_DRIVER:      return "VK_ERROR_INCOMPATIBLE_DRIVER";
+        case VK_ERROR_TOO_MANY_OBJECTS:         return "VK_ERROR_TOO_MANY_OBJECTS";
+        case VK_ERROR_FORMAT_NOT_SUPPORTED:     return "VK_ERROR_FORMAT_NOT_SUPPORTED";
+        case VK_ERROR_OUT_OF_POOL_MEMORY:       return "VK_ERROR_OUT_OF_POOL_MEMORY";
+        case VK_ERROR_SURFACE_LOST_KHR:         return "VK_ERROR_SURFACE_LOST_KHR";
+        case VK_ERROR_NATIVE_WINDOW_IN_USE_KHR: return "VK_ERROR_NATIVE_WINDOW_IN_USE_KHR";
+        case VK_ERROR_OUT_OF_DATE_KHR:          return "VK_ERROR_OUT_OF_DATE_KHR";
+        default:                                return "unknown VkResult";
+    }
+}
+
+// Kept out of line so the VK_CHECK fast path is a single compare and branch.
+internal void vk_check_failed(VkResult result, const char *call, const char *file, s32 line) {
+    LOG_ERROR("%s returned %s (%d) at %s:%d", call, vk_result_name(result), result, file, line);
+    if (result >= 0) return;
+
+    if (!vk_error.recoverable.load(std::memory_order_relaxed)) {
+        ASSERT(false);
+        LOG_FATAL("Vulkan initialization failed");
+    }
+
+    s32 expected = VK_SUCCESS;
+    if (vk_error.result.compare_exchange_strong(expected, result)) {
+        vk_error.call = call;
+        vk_error.file = file;
+        vk_error.line = line;
+    }
+}
+
+internal b8 vk_failed() {
+    return vk_error.result.load(std::memory_order_relaxed) < 0;
+}
+
+#if BUILD_DEBUG
 internal b8 vk_check_validation_layer_support() {
     u32 available_layer_count = 0;
     VK_CHECK(vkEnumerateInstanceLayerProperties(&available_layer_count, NULL));
@@ -175,13 +416,17 @@ internal b8 vk_check_validation_layer_support() {
                 break;
             }
         }
-        if (!found) return false;
+        if (!found) {
+            delete[] available_layers;
+            return false;
+        }
     }
 
     delete[] available_layers;
 
     return true;
 }
+#endif
 
 internal void vk_create_instance(Vk_Context *context) {
     VkApplicationInfo app_info{};
@@ -190,23 +435,53 @@ internal void vk_create_instance(Vk_Context *context) {
     app_info.applicationVersion = VK_MAKE_VERSION(APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_VERSION_PATCH);
     app_info.pEngineName = APP_NAME;
     app_info.engineVersion = VK_MAKE_VERSION(APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_VERSION_PATCH);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    // 1.3 where the loader has it, so dynamic rendering can be used as core.
+    VK_CHECK(vkEnumerateInstanceVersion(&context->instance_version));
+    context->instance_version = CLAMP(VK_API_VERSION_1_1, context->instance_version, VK_API_VERSION_1_3);
+    app_info.apiVersion = context->instance_version;
 
     VkInstanceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     create_info.pApplicationInfo = &app_info;
-    create_info.enabledExtensionCount = ARRAY_COUNT(vk_required_extension_names);
-    create_info.ppEnabledExtensionNames = vk_required_extension_names;
+    auto extension_names = new const char *[context->config.surface_extension_count + 1];
+    u32 extension_count = 0;
+    if (!context->config.headless) {
+        for (u32 i = 0; i < context->config.surface_extension_count; ++i) {
+            extension_names[extension_count++] = context->config.surface_extensions[i];
+        }
+    }
+#if BUILD_DEBUG
+    extension_names[extension_count++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+#endif
+    create_info.enabledExtensionCount = extension_count;
+    create_info.ppEnabledExtensionNames = extension_names;
+
+#if BUILD_DEBUG
+    // Missing layers shouldn't stop a debug build from running on a machine
+    // without the SDK installed.
+    if (vk_check_validation_layer_support()) {
+        create_info.enabledLayerCount = ARRAY_COUNT(vk_validation_layer_names);
+        create_info.ppEnabledLayerNames = vk_validation_layer_names;
+    } else {
+        LOG_WARNING("Validation layers not available, running without them");
+    }
+#endif
 
     VK_CHECK(vkCreateInstance(&create_info, context->allocator, &context->instance));
+
+    delete[] extension_names;
 }
 
+#if BUILD_DEBUG
 internal void vk_create_debug_messenger(Vk_Context *context) {
     VkDebugUtilsMessengerCreateInfoEXT create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
     create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
-        | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
-        | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+        | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+#if VALIDATION_VERBOSE
+    create_info.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
+        | VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+#endif
     create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
         | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT
         | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
@@ -215,8 +490,23 @@ internal void vk_create_debug_messenger(Vk_Context *context) {
     PFN_vkCreateDebugUtilsMessengerEXT callback =
         (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(context->instance, "vkCreateDebugUtilsMessengerEXT");
     VK_CHECK(callback(context->instance, &create_info, context->allocator, &context->debug_messenger));
+
+    context->set_object_name = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetInstanceProcAddr(
+        context->instance, "vkSetDebugUtilsObjectNameEXT");
 }
 
+internal void vk_set_object_name(Vk_Context *context, VkObjectType type, u64 handle, const char *name) {
+    if (context->set_object_name == NULL || handle == 0) return;
+
+    VkDebugUtilsObjectNameInfoEXT name_info{};
+    name_info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+    name_info.objectType = type;
+    name_info.objectHandle = handle;
+    name_info.pObjectName = name;
+    context->set_object_name(context->device, &name_info);
+}
+#endif
+
 internal void vk_create_surface(Vk_Context *context, GLFWwindow *window) {
     VK_CHECK(glfwCreateWindowSurface(context->instance, window, context->allocator, &context->surface));
 }
@@ -244,8 +534,12 @@ internal void vk_get_queue_family_support(
             ++current_transfer_scontext;
         }
 
-        VkBool32 present_support = VK_FALSE;
-        VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support));
+        // Without a surface nothing is presented, so the graphics queue
+        // stands in for the present one.
+        VkBool32 present_support = (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        if (surface != VK_NULL_HANDLE) {
+            VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support));
+        }
         if (present_support) {
             supported->present_family = i;
         }
@@ -287,6 +581,7 @@ internal b8 vk_check_device_extension_support(VkPhysicalDevice device) {
             }
             if (!found) {
                 LOG_WARNING("Required extension not found: %s", vk_device_extension_names[i]);
+                delete[] available_extensions;
                 return false;
             }
         }
@@ -297,6 +592,22 @@ internal b8 vk_check_device_extension_support(VkPhysicalDevice device) {
     return true;
 }
 
+internal b8 vk_has_device_extension(VkPhysicalDevice device, const char *name) {
+    u32 extension_count;
+    VK_CHECK(vkEnumerateDeviceExtensionProperties(device, NULL, &extension_count, NULL));
+
+    auto extensions = new VkExtensionProperties[extension_count];
+    VK_CHECK(vkEnumerateDeviceExtensionProperties(device, NULL, &extension_count, extensions));
+
+    b8 found = false;
+    for (u32 i = 0; i < extension_count && !found; ++i) {
+        found = strcmp(extensions[i].extensionName, name) == 0;
+    }
+
+    delete[] extensions;
+    return found;
+}
+
 internal void vk_get_swapchain_support(VkPhysicalDevice device, VkSurfaceKHR surface, Vk_Swapchain_Support_Info *info) {
     VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &info->capabilities));
 
@@ -332,33 +643,16 @@ internal void vk_cleanup_swapchain_support(Vk_Swapchain_Support_Info *info) {
 }
 
 internal u32 vk_rate_device_suitability(VkPhysicalDevice device, VkSurfaceKHR surface) {
-    u32 scontext = 0;
-    
-    VkPhysicalDeviceProperties properties;
-    vkGetPhysicalDeviceProperties(device, &properties);
-    if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) scontext += 1000;
-    scontext += properties.limits.maxImageDimension2D; // Maximum possible size of textures affects graphics quality
-
-    VkPhysicalDeviceFeatures features;
-    vkGetPhysicalDeviceFeatures(device, &features);
-    if (!features.geometryShader) return 0; // Application can't function without geometry shaders
-
-    { // Check queue family support
-        Vk_Queue_Family_Indices queue_family_support;
-        vk_get_queue_family_support(device, surface, &queue_family_support);
-
-        b8 queue_family_support_adequate =
-            queue_family_support.graphics_family != -1 &&
-            queue_family_support.present_family != -1 &&
-            queue_family_support.compute_family != -1 &&
-            queue_family_support.transfer_family != -1;
-
-        if (!queue_family_support_adequate) return 0;
-    }
+    // Hard requirements only: anything the renderer actually uses. Headless,
+    // that's no surface or swapchain support.
+    b8 headless = surface == VK_NULL_HANDLE;
+    if (!headless && !vk_check_device_extension_support(device)) return 0;
 
-    if (!vk_check_device_extension_support(device)) return 0;
+    Vk_Queue_Family_Indices queue_family_support;
+    vk_get_queue_family_support(device, surface, &queue_family_support);
+    if (queue_family_support.graphics_family == -1 || queue_family_support.present_family == -1) return 0;
 
-    { // Check swapchain support
+    if (!headless) { // Check swapchain support
         Vk_Swapchain_Support_Info swapchain_support{};
         vk_get_swapchain_support(device, surface, &swapchain_support);
 
@@ -371,34 +665,333 @@ internal u32 vk_rate_device_suitability(VkPhysicalDevice device, VkSurfaceKHR su
         if (!swapchain_support_adequate) return 0;
     }
 
-    return scontext;
+    // Every usable device gets at least 1, so software rasterizers such as
+    // lavapipe are still picked when nothing else is available.
+    u32 score = 1;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    switch (properties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   score += 10000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 5000;  break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    score += 2000;  break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:            score += 0;     break;
+        default:                                     score += 500;   break;
+    }
+
+    // Tie-breaker between devices of the same type. Integrated GPUs report
+    // shared system memory here, so this is capped below the type weights.
+    u64 device_local_size = vk_get_device_local_size(device);
+    score += (u32)MIN(device_local_size / MB(16), 2048);
+
+    // Families that don't share the graphics queue let uploads and compute
+    // overlap rendering.
+    if (queue_family_support.transfer_family != -1 &&
+        queue_family_support.transfer_family != queue_family_support.graphics_family) {
+        score += 500;
+    }
+    if (queue_family_support.compute_family != -1 &&
+        queue_family_support.compute_family != queue_family_support.graphics_family) {
+        score += 250;
+    }
+
+    // Optional paths the renderer takes when they're there. These only decide
+    // between devices of the same type, like the heap size. The instance
+    // version and feature bits are checked once the device is picked.
+    if (properties.apiVersion >= VK_API_VERSION_1_3 ||
+        vk_has_device_extension(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        score += 300;
+    }
+    if (properties.apiVersion >= VK_API_VERSION_1_2 ||
+        vk_has_device_extension(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        score += 300;
+    }
+    if (vk_has_device_extension(device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) score += 200;
+
+    return score;
+}
+
+internal u64 vk_get_device_local_size(VkPhysicalDevice device) {
+    VkPhysicalDeviceMemoryProperties mem_properties;
+    vkGetPhysicalDeviceMemoryProperties(device, &mem_properties);
+
+    u64 size = 0;
+    for (u32 i = 0; i < mem_properties.memoryHeapCount; ++i) {
+        if (mem_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            size += mem_properties.memoryHeaps[i].size;
+        }
+    }
+    return size;
+}
+
+internal void vk_get_device_uuid(VkPhysicalDevice device, u8 uuid[VK_UUID_SIZE]) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    if (properties.apiVersion >= VK_API_VERSION_1_1) {
+        VkPhysicalDeviceIDProperties id_properties{};
+        id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &id_properties;
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+
+        memcpy(uuid, id_properties.deviceUUID, VK_UUID_SIZE);
+    } else {
+        memset(uuid, 0, VK_UUID_SIZE);
+    }
+}
+
+internal b8 vk_device_matches_selector(VkPhysicalDevice device, u32 index, const char *selector) {
+    // UUID: 32 hex digits, dashes ignored. Checked before the index, since a
+    // UUID can be all decimal digits.
+    u8 uuid[VK_UUID_SIZE];
+    u32 digit_count = 0;
+    for (const char *c = selector; *c && digit_count <= 2 * VK_UUID_SIZE; ++c) {
+        if (*c == '-') continue;
+
+        s32 value = -1;
+        if (*c >= '0' && *c <= '9') value = *c - '0';
+        if (*c >= 'a' && *c <= 'f') value = *c - 'a' + 10;
+        if (*c >= 'A' && *c <= 'F') value = *c - 'A' + 10;
+        if (value < 0) {
+            digit_count = 0;
+            break;
+        }
+
+        if (digit_count < 2 * VK_UUID_SIZE) {
+            if (digit_count % 2 == 0) uuid[digit_count / 2] = (u8)(value << 4);
+            else uuid[digit_count / 2] |= (u8)value;
+        }
+        digit_count++;
+    }
+    if (digit_count == 2 * VK_UUID_SIZE) {
+        u8 device_uuid[VK_UUID_SIZE];
+        vk_get_device_uuid(device, device_uuid);
+        return memcmp(uuid, device_uuid, VK_UUID_SIZE) == 0;
+    }
+
+    // Index: all digits
+    b8 is_index = selector[0] != 0;
+    for (const char *c = selector; *c; ++c) {
+        if (*c < '0' || *c > '9') is_index = false;
+    }
+    if (is_index) return (u32)atoi(selector) == index;
+
+    // Name: case-insensitive substring, e.g. "nvidia" or "llvmpipe"
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    for (const char *start = properties.deviceName; *start; ++start) {
+        const char *a = start;
+        const char *b = selector;
+        while (*a && *b && tolower((u8)*a) == tolower((u8)*b)) {
+            ++a;
+            ++b;
+        }
+        if (*b == 0) return true;
+    }
+    return false;
+}
+
+internal void vk_log_device(VkPhysicalDevice device, u32 index, u32 score) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    const char *type_name = "other";
+    switch (properties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   type_name = "discrete";   break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: type_name = "integrated"; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    type_name = "virtual";    break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:            type_name = "cpu";        break;
+        default: break;
+    }
+
+    u8 uuid[VK_UUID_SIZE];
+    vk_get_device_uuid(device, uuid);
+    char uuid_text[2 * VK_UUID_SIZE + 1];
+    for (u32 i = 0; i < VK_UUID_SIZE; ++i) snprintf(&uuid_text[i * 2], 3, "%02x", uuid[i]);
+
+    LOG_INFO("GPU %u: %s (%s, Vulkan %u.%u.%u, %04x:%04x) uuid %s, %llu MB device local, score %u%s",
+        index, properties.deviceName, type_name,
+        VK_VERSION_MAJOR(properties.apiVersion), VK_VERSION_MINOR(properties.apiVersion),
+        VK_VERSION_PATCH(properties.apiVersion), properties.vendorID, properties.deviceID, uuid_text,
+        (unsigned long long)(vk_get_device_local_size(device) / MB(1)), score, score == 0 ? " (unsuitable)" : "");
+}
+
+internal void vk_log_device_capabilities(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    LOG_INFO("  max image dimension 2D %u, max push constants %u bytes, max bound descriptor sets %u",
+        properties.limits.maxImageDimension2D, properties.limits.maxPushConstantsSize,
+        properties.limits.maxBoundDescriptorSets);
+
+    VkPhysicalDeviceMemoryProperties mem_properties;
+    vkGetPhysicalDeviceMemoryProperties(device, &mem_properties);
+    for (u32 i = 0; i < mem_properties.memoryHeapCount; ++i) {
+        LOG_INFO("  heap %u: %llu MB%s", i, (unsigned long long)(mem_properties.memoryHeaps[i].size / MB(1)),
+            (mem_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " device local" : "");
+    }
+
+    u32 queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, NULL);
+    auto queue_families = new VkQueueFamilyProperties[queue_family_count]{};
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families);
+    for (u32 i = 0; i < queue_family_count; ++i) {
+        VkQueueFlags flags = queue_families[i].queueFlags;
+        LOG_INFO("  queue family %u: %u queue(s)%s%s%s", i, queue_families[i].queueCount,
+            (flags & VK_QUEUE_GRAPHICS_BIT) ? " graphics" : "",
+            (flags & VK_QUEUE_COMPUTE_BIT) ? " compute" : "",
+            (flags & VK_QUEUE_TRANSFER_BIT) ? " transfer" : "");
+    }
+    delete[] queue_families;
 }
 
 internal void vk_pick_physical_device(Vk_Context *context) {
     u32 physical_device_count;
     VK_CHECK(vkEnumeratePhysicalDevices(context->instance, &physical_device_count, NULL));
-    ASSERT(physical_device_count > 0);
+    if (physical_device_count == 0) LOG_FATAL("No Vulkan devices found");
 
     auto physical_devices = new VkPhysicalDevice[physical_device_count]{};
     VK_CHECK(vkEnumeratePhysicalDevices(context->instance, &physical_device_count, physical_devices));
 
+    const char *selector = context->config.device_selector;
+
     u32 best_picked_index = -1;
-    u32 best_picked_scontext = 0;
+    u32 best_picked_score = 0;
+    u32 selected_index = -1;
     for (u32 i = 0; i < physical_device_count; ++i) {
-        u32 scontext = vk_rate_device_suitability(physical_devices[i], context->surface);
-        if (scontext > best_picked_scontext) {
+        u32 score = vk_rate_device_suitability(physical_devices[i], context->surface);
+        vk_log_device(physical_devices[i], i, score);
+
+        if (score > best_picked_score) {
             best_picked_index = i;
-            best_picked_scontext = scontext;
+            best_picked_score = score;
+        }
+
+        if (selector[0] && selected_index == -1 && vk_device_matches_selector(physical_devices[i], i, selector)) {
+            if (score > 0) selected_index = i;
+            else LOG_WARNING("GPU %u matches \"%s\" but can't run the renderer", i, selector);
         }
     }
-    ASSERT(best_picked_scontext > 0);
+    if (best_picked_score == 0) LOG_FATAL("No GPU can run the renderer");
+
+    if (selected_index != -1) {
+        best_picked_index = selected_index;
+    } else if (selector[0]) {
+        LOG_WARNING("No usable GPU matches \"%s\", picking automatically", selector);
+    }
 
     context->physical_device = physical_devices[best_picked_index];
 
     delete[] physical_devices;
 
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+        LOG_INFO("Using GPU %u: %s", best_picked_index, properties.deviceName);
+        vk_log_device_capabilities(context->physical_device);
+    }
+
     vk_get_queue_family_support(context->physical_device, context->surface, &context->queue_family_support);
-    vk_get_swapchain_support(context->physical_device, context->surface, &context->swapchain_support);
+    if (!context->config.headless) {
+        vk_get_swapchain_support(context->physical_device, context->surface, &context->swapchain_support);
+    }
+}
+
+internal Vk_Rendering_Path vk_choose_rendering_path(Vk_Context *context) {
+    if (context->config.force_render_pass) return VK_RENDERING_PATH_RENDER_PASS;
+
+    VkPhysicalDevice device = context->physical_device;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    Vk_Rendering_Path path = VK_RENDERING_PATH_RENDER_PASS;
+    if (properties.apiVersion >= VK_API_VERSION_1_3 && context->instance_version >= VK_API_VERSION_1_3) {
+        path = VK_RENDERING_PATH_DYNAMIC_CORE;
+    } else if (vk_has_device_extension(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        // Before 1.2 the extension also depends on these two.
+        b8 dependencies = properties.apiVersion >= VK_API_VERSION_1_2 ||
+            (vk_has_device_extension(device, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) &&
+             vk_has_device_extension(device, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME));
+        if (dependencies) path = VK_RENDERING_PATH_DYNAMIC_KHR;
+    }
+    if (path == VK_RENDERING_PATH_RENDER_PASS) return path;
+
+    // Being exposed doesn't mean the feature is enabled by the driver.
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering{};
+    dynamic_rendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamic_rendering;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return dynamic_rendering.dynamicRendering ? path : VK_RENDERING_PATH_RENDER_PASS;
+}
+
+internal const char *vk_rendering_path_name(Vk_Rendering_Path path) {
+    switch (path) {
+        case VK_RENDERING_PATH_RENDER_PASS:  return "render pass";
+        case VK_RENDERING_PATH_DYNAMIC_KHR:  return "dynamic rendering (VK_KHR_dynamic_rendering)";
+        case VK_RENDERING_PATH_DYNAMIC_CORE: return "dynamic rendering (Vulkan 1.3)";
+        default:                             return "unknown";
+    }
+}
+
+internal Vk_Texture_Binding vk_choose_texture_binding(Vk_Context *context) {
+    VkPhysicalDevice device = context->physical_device;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    Vk_Texture_Binding binding = VK_TEXTURE_BINDING_ARRAY;
+    if (properties.apiVersion >= VK_API_VERSION_1_2 && context->instance_version >= VK_API_VERSION_1_2) {
+        binding = VK_TEXTURE_BINDING_BINDLESS_CORE;
+    } else if (vk_has_device_extension(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        // Maintenance3 is core from 1.1 on.
+        b8 dependencies = properties.apiVersion >= VK_API_VERSION_1_1 ||
+            vk_has_device_extension(device, VK_KHR_MAINTENANCE_3_EXTENSION_NAME);
+        if (dependencies) binding = VK_TEXTURE_BINDING_BINDLESS_EXT;
+    }
+
+    if (binding != VK_TEXTURE_BINDING_ARRAY) {
+        // Descriptor indexing is a bag of optional features; these are the
+        // ones a partially bound, update-after-bind sampler array needs.
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing{};
+        indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexing;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        b8 supported = indexing.shaderSampledImageArrayNonUniformIndexing &&
+            indexing.descriptorBindingPartiallyBound &&
+            indexing.descriptorBindingSampledImageUpdateAfterBind &&
+            indexing.descriptorBindingUpdateUnusedWhilePending;
+        if (supported) return binding;
+    }
+
+    // Even dynamically uniform indices into the array need this feature.
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device, &features);
+    return features.shaderSampledImageArrayDynamicIndexing ? VK_TEXTURE_BINDING_ARRAY : VK_TEXTURE_BINDING_PER_DRAW;
+}
+
+internal const char *vk_texture_binding_name(Vk_Texture_Binding binding) {
+    switch (binding) {
+        case VK_TEXTURE_BINDING_ARRAY:         return "texture array";
+        case VK_TEXTURE_BINDING_PER_DRAW:      return "per-draw sets";
+        case VK_TEXTURE_BINDING_BINDLESS_EXT:  return "bindless (VK_EXT_descriptor_indexing)";
+        case VK_TEXTURE_BINDING_BINDLESS_CORE: return "bindless (Vulkan 1.2)";
+        default:                               return "unknown";
+    }
+}
+
+internal b8 vk_has_bindless_textures(Vk_Context *context) {
+    return context->texture_binding == VK_TEXTURE_BINDING_BINDLESS_EXT ||
+        context->texture_binding == VK_TEXTURE_BINDING_BINDLESS_CORE;
 }
 
 internal void vk_create_device(Vk_Context *context) {
@@ -421,12 +1014,12 @@ internal void vk_create_device(Vk_Context *context) {
     if (!shared_transfer_queue)
         indices[index++] = context->queue_family_support.transfer_family;
 
+    f32 queue_priority = 1.0f;
     auto queue_create_infos = new VkDeviceQueueCreateInfo[index_count]{};
     for (u32 i = 0; i < index_count; ++i) {
         queue_create_infos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queue_create_infos[i].queueFamilyIndex = indices[i];
         queue_create_infos[i].queueCount = 1;
-        f32 queue_priority = 1.0f;
         queue_create_infos[i].pQueuePriorities = &queue_priority;
         queue_create_infos[i].flags = 0;
         queue_create_infos[i].pNext = 0;
@@ -434,16 +1027,84 @@ internal void vk_create_device(Vk_Context *context) {
 
     delete[] indices;
 
-    // Not used yet?
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(context->physical_device, &supported_features);
+
+    // The texture array fallback indexes with dynamically uniform values.
     VkPhysicalDeviceFeatures device_features{};
+    device_features.shaderSampledImageArrayDynamicIndexing = supported_features.shaderSampledImageArrayDynamicIndexing;
+    device_features.pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery; // Overdraw metrics
+    context->has_pipeline_statistics = supported_features.pipelineStatisticsQuery;
+    device_features.fillModeNonSolid = supported_features.fillModeNonSolid; // Wireframe variants
+    context->has_wireframe = supported_features.fillModeNonSolid;
+
+    const char *extension_names[ARRAY_COUNT(vk_device_extension_names) + 6];
+    u32 extension_count = 0;
+    for (u32 i = 0; i < ARRAY_COUNT(vk_device_extension_names) && !context->config.headless; ++i) {
+        extension_names[extension_count++] = vk_device_extension_names[i];
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+
+    context->rendering_path = vk_choose_rendering_path(context);
+    context->texture_binding = vk_choose_texture_binding(context);
+
+    // Structs are pushed onto the front of the device create info's chain.
+    void *features_chain = NULL;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering{};
+    dynamic_rendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamic_rendering.dynamicRendering = VK_TRUE;
+
+    if (context->rendering_path == VK_RENDERING_PATH_DYNAMIC_KHR) {
+        extension_names[extension_count++] = VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            extension_names[extension_count++] = VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME;
+            extension_names[extension_count++] = VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME;
+        }
+    }
+    if (context->rendering_path != VK_RENDERING_PATH_RENDER_PASS) {
+        dynamic_rendering.pNext = features_chain;
+        features_chain = &dynamic_rendering;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing{};
+    descriptor_indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    descriptor_indexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    descriptor_indexing.descriptorBindingPartiallyBound = VK_TRUE;
+    descriptor_indexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    descriptor_indexing.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+    if (context->texture_binding == VK_TEXTURE_BINDING_BINDLESS_EXT) {
+        extension_names[extension_count++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+
+        if (properties.apiVersion < VK_API_VERSION_1_1) {
+            extension_names[extension_count++] = VK_KHR_MAINTENANCE_3_EXTENSION_NAME;
+        }
+    }
+    if (vk_has_bindless_textures(context)) {
+        descriptor_indexing.pNext = features_chain;
+        features_chain = &descriptor_indexing;
+    }
+
+    // Reports what the whole process uses of each heap, and how much the
+    // driver thinks can be allocated before things start getting evicted.
+    context->has_memory_budget = properties.apiVersion >= VK_API_VERSION_1_1 &&
+        vk_has_device_extension(context->physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (context->has_memory_budget) {
+        extension_names[extension_count++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
 
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = features_chain;
     device_create_info.queueCreateInfoCount = index_count;
     device_create_info.pQueueCreateInfos = queue_create_infos;
     device_create_info.pEnabledFeatures = &device_features;
-    device_create_info.enabledExtensionCount = ARRAY_COUNT(vk_device_extension_names);
-    device_create_info.ppEnabledExtensionNames = vk_device_extension_names;
+    device_create_info.enabledExtensionCount = extension_count;
+    device_create_info.ppEnabledExtensionNames = extension_names;
 
     // Deprecated and ignored
     device_create_info.enabledLayerCount = 0;
@@ -460,49 +1121,124 @@ internal void vk_create_device(Vk_Context *context) {
         context->device, context->queue_family_support.present_family, 0, &context->present_queue);
     vkGetDeviceQueue(
         context->device, context->queue_family_support.transfer_family, 0, &context->transfer_queue);
-}
 
-internal void vk_create_swapchain(Vk_Context *context, GLFWwindow *window) {
-    vk_get_swapchain_support(context->physical_device, context->surface, &context->swapchain_support);
+    if (context->rendering_path == VK_RENDERING_PATH_DYNAMIC_CORE) {
+        context->cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(context->device, "vkCmdBeginRendering");
+        context->cmd_end_rendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(context->device, "vkCmdEndRendering");
+    } else if (context->rendering_path == VK_RENDERING_PATH_DYNAMIC_KHR) {
+        context->cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(context->device, "vkCmdBeginRenderingKHR");
+        context->cmd_end_rendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(context->device, "vkCmdEndRenderingKHR");
+    }
+    LOG_INFO("Rendering path: %s", vk_rendering_path_name(context->rendering_path));
 
-    VkSurfaceFormatKHR surface_format;
-    b8 found = false;
-    for (u32 i = 0; i < context->swapchain_support.format_count; ++i) {
-        VkSurfaceFormatKHR available_format = context->swapchain_support.formats[i];
+    context->texture_capacity = vk_get_texture_capacity(context);
+    LOG_INFO("Texture binding: %s, %u slots",
+        vk_texture_binding_name(context->texture_binding), context->texture_capacity);
+
+    vk_init_memory_tracking(context);
+}
+
+internal VkSurfaceFormatKHR vk_choose_surface_format(Vk_Swapchain_Support_Info *support) {
+    for (u32 i = 0; i < support->format_count; ++i) {
+        VkSurfaceFormatKHR available_format = support->formats[i];
         if (available_format.format == VK_FORMAT_B8G8R8A8_SRGB &&
             available_format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            surface_format = available_format;
-            found = true;
-            break;
+            return available_format;
         }
     }
-    if (!found) surface_format = context->swapchain_support.formats[0];
+    return support->formats[0];
+}
 
-    VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
-    for (u32 i = 0; i < context->swapchain_support.present_mode_count; ++i) {
-        VkPresentModeKHR available_present_mode = context->swapchain_support.present_modes[i];
-        if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            present_mode = available_present_mode;
-            break;
-        }
+internal VkPresentModeKHR vk_choose_present_mode(Vk_Swapchain_Support_Info *support, Vk_Present_Policy policy) {
+    // In order of preference. FIFO is always supported, so it ends every list.
+    local_persist const VkPresentModeKHR low_latency[] = {
+        VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR,
+    };
+    local_persist const VkPresentModeKHR power_saving[] = {
+        VK_PRESENT_MODE_FIFO_KHR,
+    };
+    local_persist const VkPresentModeKHR adaptive[] = {
+        VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR,
+    };
+    // The app paces frames itself. Mailbox doesn't block or tear; without it
+    // fifo caps at the refresh rate on top of the app's limit.
+    local_persist const VkPresentModeKHR capped[] = {
+        VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR,
+    };
+
+    const VkPresentModeKHR *preferred = low_latency;
+    u32 preferred_count = ARRAY_COUNT(low_latency);
+    switch (policy) {
+        case VK_PRESENT_POLICY_LOW_LATENCY:  preferred = low_latency;  preferred_count = ARRAY_COUNT(low_latency);  break;
+        case VK_PRESENT_POLICY_POWER_SAVING: preferred = power_saving; preferred_count = ARRAY_COUNT(power_saving); break;
+        case VK_PRESENT_POLICY_ADAPTIVE:     preferred = adaptive;     preferred_count = ARRAY_COUNT(adaptive);     break;
+        case VK_PRESENT_POLICY_CAPPED:       preferred = capped;       preferred_count = ARRAY_COUNT(capped);       break;
     }
 
-    s32 width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-    VkExtent2D extent{(u32)width, (u32)height};
-    if (context->swapchain_support.capabilities.currentExtent.width != UINT32_MAX) {
-        extent = context->swapchain_support.capabilities.currentExtent;
-    } else {
-        VkExtent2D min_extent = context->swapchain_support.capabilities.minImageExtent;
-        VkExtent2D max_extent = context->swapchain_support.capabilities.maxImageExtent;
-        extent.width = CLAMP(extent.width, min_extent.width, max_extent.width);
-        extent.height = CLAMP(extent.height, min_extent.height, max_extent.height);
+    for (u32 i = 0; i < preferred_count; ++i) {
+        for (u32 j = 0; j < support->present_mode_count; ++j) {
+            if (support->present_modes[j] == preferred[i]) return preferred[i];
+        }
     }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
 
-    u32 image_count = context->swapchain_support.capabilities.minImageCount + 1;
-    if (context->swapchain_support.capabilities.maxImageCount > 0 &&
-        image_count > context->swapchain_support.capabilities.maxImageCount) {
-        image_count = context->swapchain_support.capabilities.maxImageCount;
+internal const char *vk_present_mode_name(VkPresentModeKHR present_mode) {
+    switch (present_mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:      return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:         return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+        default:                               return "unknown";
+    }
+}
+
+internal void vk_create_swapchain(Vk_Context *context, GLFWwindow *window) {
+    if (context->config.headless) {
+        vk_create_headless_backbuffer(context);
+        return;
+    }
+
+    vk_get_swapchain_support(context->physical_device, context->surface, &context->swapchain_support);
+
+    // The render pass and every pipeline variant, dynamic rendering's included,
+    // were built for swapchain_image_format, so it stays while offered.
+    VkSurfaceFormatKHR surface_format = vk_choose_surface_format(&context->swapchain_support);
+    if (surface_format.format != context->swapchain_image_format) {
+        b8 found = false;
+        for (u32 i = 0; i < context->swapchain_support.format_count && !found; ++i) {
+            if (context->swapchain_support.formats[i].format == context->swapchain_image_format) {
+                surface_format = context->swapchain_support.formats[i];
+                found = true;
+            }
+        }
+        if (!found) {
+            LOG_FATAL("Surface no longer offers the format the pipelines were built for (%d, now %d)",
+                context->swapchain_image_format, surface_format.format);
+        }
+    }
+
+    VkPresentModeKHR present_mode = vk_choose_present_mode(&context->swapchain_support, context->config.present_policy);
+    if (present_mode != context->present_mode) {
+        LOG_INFO("Present mode: %s", vk_present_mode_name(present_mode));
+    }
+
+    s32 width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    VkExtent2D extent{(u32)width, (u32)height};
+    if (context->swapchain_support.capabilities.currentExtent.width != UINT32_MAX) {
+        extent = context->swapchain_support.capabilities.currentExtent;
+    } else {
+        VkExtent2D min_extent = context->swapchain_support.capabilities.minImageExtent;
+        VkExtent2D max_extent = context->swapchain_support.capabilities.maxImageExtent;
+        extent.width = CLAMP(min_extent.width, extent.width, max_extent.width);
+        extent.height = CLAMP(min_extent.height, extent.height, max_extent.height);
+    }
+
+    u32 image_count = context->swapchain_support.capabilities.minImageCount + 1;
+    if (context->swapchain_support.capabilities.maxImageCount > 0 &&
+        image_count > context->swapchain_support.capabilities.maxImageCount) {
+        image_count = context->swapchain_support.capabilities.maxImageCount;
     }
 
     VkSwapchainCreateInfoKHR create_info{};
@@ -514,6 +1250,15 @@ internal void vk_create_swapchain(Vk_Context *context, GLFWwindow *window) {
     create_info.imageExtent = extent;
     create_info.imageArrayLayers = 1;
     create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (context->resolution.enabled) create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; // Upscale blit
+    if (context->config.capture) {
+        if (context->swapchain_support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+            create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        } else {
+            LOG_WARNING("Swapchain images can't be copied from, frame capture disabled");
+            context->config.capture = false;
+        }
+    }
     
     if (context->queue_family_support.graphics_family !=
         context->queue_family_support.present_family) {
@@ -533,6 +1278,7 @@ internal void vk_create_swapchain(Vk_Context *context, GLFWwindow *window) {
     create_info.preTransform = context->swapchain_support.capabilities.currentTransform;
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     create_info.presentMode = present_mode;
+    context->present_mode = present_mode;
     create_info.clipped = VK_TRUE;
     create_info.oldSwapchain = VK_NULL_HANDLE;
 
@@ -588,9 +1334,81 @@ internal void vk_cleanup_swapchain(Vk_Context *context) {
         vkDestroySwapchainKHR(context->device, context->swapchain, context->allocator);
         context->swapchain = VK_NULL_HANDLE;
     }
+
+    if (context->headless_memory != VK_NULL_HANDLE) {
+        vkDestroyImage(context->device, context->swapchain_images[0], context->allocator);
+        vk_free_memory(context, context->headless_memory);
+        context->headless_memory = VK_NULL_HANDLE;
+    }
+}
+
+internal void vk_create_headless_backbuffer(Vk_Context *context) {
+    VkExtent2D extent = context->config.headless_extent;
+    extent.width = MAX(extent.width, 1);
+    extent.height = MAX(extent.height, 1);
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = context->swapchain_image_format;
+    image_info.extent.width = extent.width;
+    image_info.extent.height = extent.height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // Transfer source so the frame can be read back.
+    image_info.usage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (context->swapchain_images == NULL) {
+        context->swapchain_images = new VkImage[1]{};
+    }
+    context->swapchain_image_count = 1;
+    VK_CHECK(vkCreateImage(context->device, &image_info, context->allocator, &context->swapchain_images[0]));
+    VK_NAME(context, VK_OBJECT_TYPE_IMAGE, context->swapchain_images[0], "headless backbuffer");
+
+    VkMemoryRequirements mem_requirements;
+    vkGetImageMemoryRequirements(context->device, context->swapchain_images[0], &mem_requirements);
+
+    VkPhysicalDeviceMemoryProperties mem_properties;
+    vkGetPhysicalDeviceMemoryProperties(context->physical_device, &mem_properties);
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = mem_requirements.size;
+    alloc_info.memoryTypeIndex = vk_find_memory_type(
+        mem_properties, mem_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VK_CHECK(vk_allocate_memory(context, &alloc_info, &context->headless_memory));
+    VK_CHECK(vkBindImageMemory(context->device, context->swapchain_images[0], context->headless_memory, 0));
+
+    context->swapchain_extent = extent;
+
+    if (context->swapchain_image_views == NULL) {
+        context->swapchain_image_views = new VkImageView[1];
+    }
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = context->swapchain_images[0];
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = context->swapchain_image_format;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    VK_CHECK(vkCreateImageView(context->device, &view_info, context->allocator, &context->swapchain_image_views[0]));
 }
 
 internal void vk_create_render_pass(Vk_Context *context) {
+    if (context->rendering_path != VK_RENDERING_PATH_RENDER_PASS) return;
+
     VkAttachmentDescription color_attachment{};
     color_attachment.format = context->swapchain_image_format;
     color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -598,88 +1416,649 @@ internal void vk_create_render_pass(Vk_Context *context) {
     color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Transitions in and out of the attachment layout are the frame graph's.
+    color_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     color_attachment.flags = 0;
 
     VkAttachmentReference color_attachment_ref{};
     color_attachment_ref.attachment = 0;
     color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentDescription depth_attachment{};
+    depth_attachment.format = context->depth_format;
+    depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depth_attachment_ref{};
+    depth_attachment_ref.attachment = 1;
+    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    b8 has_depth = context->depth_format != VK_FORMAT_UNDEFINED;
+    VkAttachmentDescription attachments[] = {color_attachment, depth_attachment};
+
     VkSubpassDescription subpass_desc{};
     subpass_desc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass_desc.colorAttachmentCount = 1;
     subpass_desc.pColorAttachments = &color_attachment_ref;
-
-    VkSubpassDependency subpass_dependency{};
-    subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    subpass_dependency.dstSubpass = 0;
-    subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpass_dependency.srcAccessMask = 0;
-    subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpass_desc.pDepthStencilAttachment = has_depth ? &depth_attachment_ref : NULL;
 
     VkRenderPassCreateInfo render_pass_create_info{};
     render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_create_info.attachmentCount = 1;
-    render_pass_create_info.pAttachments = &color_attachment;
+    render_pass_create_info.attachmentCount = has_depth ? 2 : 1;
+    render_pass_create_info.pAttachments = attachments;
     render_pass_create_info.subpassCount = 1;
     render_pass_create_info.pSubpasses = &subpass_desc;
-    render_pass_create_info.dependencyCount = 1;
-    render_pass_create_info.pDependencies = &subpass_dependency;
 
     VK_CHECK(vkCreateRenderPass(
         context->device, &render_pass_create_info, context->allocator, &context->render_pass));
+    VK_NAME(context, VK_OBJECT_TYPE_RENDER_PASS, context->render_pass, "main pass");
+
+    if (context->resolution.enabled) {
+        // The UI goes on top of the upscaled scene. Compatible with the main
+        // pass, so the same pipelines and framebuffers work in both.
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+        VK_CHECK(vkCreateRenderPass(
+            context->device, &render_pass_create_info, context->allocator, &context->overlay_render_pass));
+        VK_NAME(context, VK_OBJECT_TYPE_RENDER_PASS, context->overlay_render_pass, "overlay pass");
+    }
+}
+
+internal void vk_init_resolution(Vk_Context *context) {
+    Vk_Resolution *resolution = &context->resolution;
+    Vk_Config *config = &context->config;
+
+    resolution->scale = 1.0f;
+
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(context->physical_device, context->swapchain_image_format, &format_properties);
+    VkFormatFeatureFlags blit_features =
+        VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+        VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    b8 can_blit = (format_properties.optimalTilingFeatures & blit_features) == blit_features &&
+        (config->headless || (context->swapchain_support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+
+    u32 queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(context->physical_device, &queue_family_count, NULL);
+    auto queue_families = new VkQueueFamilyProperties[queue_family_count];
+    vkGetPhysicalDeviceQueueFamilyProperties(context->physical_device, &queue_family_count, queue_families);
+    u32 valid_bits = queue_families[context->queue_family_support.graphics_family].timestampValidBits;
+    delete[] queue_families;
+
+    resolution->has_timestamps = valid_bits > 0 && properties.limits.timestampPeriod > 0.0f;
+    if (resolution->has_timestamps) {
+        resolution->timestamp_period = properties.limits.timestampPeriod;
+        resolution->timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+        VkQueryPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        pool_info.queryCount = 2;
+        VK_CHECK(vkCreateQueryPool(context->device, &pool_info, context->allocator, &resolution->timestamp_pool));
+    }
+
+    if (!config->dynamic_resolution) return;
+    if (!can_blit || !resolution->has_timestamps) {
+        LOG_WARNING("Dynamic resolution disabled: %s unsupported", can_blit ? "GPU timestamps" : "blits to the swapchain");
+        return;
+    }
+
+    f32 min_scale = CLAMP(0.1f, config->min_render_scale, 1.0f);
+    f32 max_scale = CLAMP(min_scale, config->max_render_scale, 1.0f);
+    config->min_render_scale = min_scale;
+    config->max_render_scale = max_scale;
+    resolution->scale = max_scale;
+    if (min_scale == 1.0f) {
+        LOG_INFO("Dynamic resolution disabled: the render scale can't go below 1");
+        return;
+    }
+
+    resolution->enabled = true;
+    LOG_INFO("Dynamic resolution: scale %.2f to %.2f, GPU target %.2f ms", min_scale, max_scale, config->gpu_target_ms);
+}
+
+internal void vk_cleanup_resolution(Vk_Context *context) {
+    vkDestroyQueryPool(context->device, context->resolution.timestamp_pool, context->allocator);
+}
+
+internal void vk_cmd_begin_timestamps(Vk_Context *context, VkCommandBuffer command_buffer) {
+    Vk_Resolution *resolution = &context->resolution;
+    if (!resolution->has_timestamps) return;
+
+    vkCmdResetQueryPool(command_buffer, resolution->timestamp_pool, 0, 2);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, resolution->timestamp_pool, 0);
+}
+
+internal void vk_cmd_end_timestamps(Vk_Context *context, VkCommandBuffer command_buffer) {
+    Vk_Resolution *resolution = &context->resolution;
+    if (!resolution->has_timestamps) return;
+
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, resolution->timestamp_pool, 1);
+    resolution->timestamps_pending = true;
+}
+
+internal void vk_update_resolution(Vk_Context *context) {
+    Vk_Resolution *resolution = &context->resolution;
+    if (!resolution->timestamps_pending) return;
+    resolution->timestamps_pending = false;
+
+    u64 timestamps[2];
+    VkResult result = vkGetQueryPoolResults(
+        context->device, resolution->timestamp_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(u64),
+        VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) return;
+
+    u64 ticks = (timestamps[1] - timestamps[0]) & resolution->timestamp_mask;
+    f32 gpu_ms = (f32)(ticks * (f64)resolution->timestamp_period / 1e6);
+    context->stats.gpu.frame_ms = gpu_ms;
+    if (!resolution->enabled) return;
+
+    if (resolution->gpu_ms == 0.0f) resolution->gpu_ms = gpu_ms;
+    resolution->gpu_ms += (gpu_ms - resolution->gpu_ms) * VK_RESOLUTION_SMOOTHING;
+
+    // Fill cost goes with the pixel count, the square of the scale.
+    Vk_Config *config = &context->config;
+    f32 target_ms = config->gpu_target_ms * VK_RESOLUTION_HEADROOM;
+    f32 desired = resolution->scale * sqrtf(target_ms / MAX(resolution->gpu_ms, 0.001f));
+    desired = CLAMP(config->min_render_scale, desired, config->max_render_scale);
+
+    // Half steps, so a scale change shows up in the smoothed time before the
+    // next one and the scale doesn't oscillate.
+    if (fabsf(desired - resolution->scale) > VK_RESOLUTION_DEAD_ZONE) {
+        resolution->scale += (desired - resolution->scale) * 0.5f;
+    }
+}
+
+#if !SHADER_HOT_RELOAD
+#include "generated/shaders.h"
+
+internal const Vk_Embedded_Shader *vk_find_embedded_shader(const char *name) {
+    for (u32 i = 0; i < ARRAY_COUNT(vk_embedded_shaders); ++i) {
+        if (strcmp(vk_embedded_shaders[i].name, name) == 0) {
+            return &vk_embedded_shaders[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
+internal VkShaderModule vk_create_shader_module(Vk_Context *context, const char *name) {
+    VkShaderModuleCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+#if SHADER_HOT_RELOAD
+    char path[256];
+    snprintf(path, sizeof(path), "res/shaders/%s.spv", name);
+
+    // Mappings are page aligned, so the words can be read in place.
+    File_Mapping code;
+    if (!file_map(path, &code)) LOG_FATAL("Failed to open %s", path);
+    create_info.codeSize = code.size;
+    create_info.pCode = (u32 *)code.data;
+#else
+    const Vk_Embedded_Shader *shader = vk_find_embedded_shader(name);
+    if (shader == NULL) {
+        LOG_FATAL("Shader not embedded: %s", name);
+    }
+    create_info.codeSize = shader->size;
+    create_info.pCode = shader->code;
+#endif
+
+    VkShaderModule shader_module;
+    VK_CHECK(vkCreateShaderModule(context->device, &create_info, context->allocator, &shader_module));
+
+#if SHADER_HOT_RELOAD
+    file_unmap(&code);
+#endif
+
+    return shader_module;
+}
+
+internal u32 vk_get_texture_capacity(Vk_Context *context) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+
+    u32 capacity = MAX_TEXTURE_COUNT;
+    if (context->texture_binding == VK_TEXTURE_BINDING_ARRAY) {
+        VkPhysicalDeviceLimits *limits = &properties.limits;
+        capacity = MIN(capacity, limits->maxPerStageDescriptorSamplers);
+        capacity = MIN(capacity, limits->maxPerStageDescriptorSampledImages);
+        capacity = MIN(capacity, limits->maxDescriptorSetSamplers);
+        capacity = MIN(capacity, limits->maxDescriptorSetSampledImages);
+    } else if (vk_has_bindless_textures(context)) {
+        // Update-after-bind descriptors have limits of their own.
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing{};
+        indexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &indexing;
+        vkGetPhysicalDeviceProperties2(context->physical_device, &properties2);
+
+        capacity = MIN(capacity, indexing.maxPerStageDescriptorUpdateAfterBindSamplers);
+        capacity = MIN(capacity, indexing.maxPerStageDescriptorUpdateAfterBindSampledImages);
+        capacity = MIN(capacity, indexing.maxDescriptorSetUpdateAfterBindSamplers);
+        capacity = MIN(capacity, indexing.maxDescriptorSetUpdateAfterBindSampledImages);
+    }
+
+    ASSERT(capacity > 0);
+    return capacity;
+}
+
+internal void vk_create_texture_resources(Vk_Context *context) {
+    b8 bindless = vk_has_bindless_textures(context);
+    b8 per_draw = context->texture_binding == VK_TEXTURE_BINDING_PER_DRAW;
+
+    { // Descriptor set layout
+        VkDescriptorSetLayoutBinding sampler_binding{};
+        sampler_binding.binding = 0;
+        sampler_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sampler_binding.descriptorCount = per_draw ? 1 : context->texture_capacity;
+        sampler_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        sampler_binding.pImmutableSamplers = NULL;
+
+        // Slots may be empty, and are written while the set is bound.
+        VkDescriptorBindingFlagsEXT binding_flags =
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info{};
+        binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        binding_flags_info.bindingCount = 1;
+        binding_flags_info.pBindingFlags = &binding_flags;
+
+        VkDescriptorSetLayoutCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        create_info.bindingCount = 1;
+        create_info.pBindings = &sampler_binding;
+        if (bindless) {
+            create_info.pNext = &binding_flags_info;
+            create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        }
+
+        VK_CHECK(vkCreateDescriptorSetLayout(
+            context->device, &create_info, context->allocator, &context->texture_set_layout));
+    }
+
+    { // Descriptor pool
+        VkDescriptorPoolSize pool_size{};
+        pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        pool_size.descriptorCount = context->texture_capacity;
+
+        VkDescriptorPoolCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        create_info.flags = bindless ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0;
+        create_info.maxSets = per_draw ? context->texture_capacity : 1;
+        create_info.poolSizeCount = 1;
+        create_info.pPoolSizes = &pool_size;
+
+        VK_CHECK(vkCreateDescriptorPool(
+            context->device, &create_info, context->allocator, &context->descriptor_pool));
+    }
+
+    if (per_draw) { // Descriptor sets, one per slot
+        u32 count = context->texture_capacity;
+        auto layouts = new VkDescriptorSetLayout[count];
+        for (u32 i = 0; i < count; ++i) layouts[i] = context->texture_set_layout;
+
+        VkDescriptorSetAllocateInfo set_info{};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = context->descriptor_pool;
+        set_info.descriptorSetCount = count;
+        set_info.pSetLayouts = layouts;
+
+        context->texture_sets = new VkDescriptorSet[count];
+        VK_CHECK(vkAllocateDescriptorSets(context->device, &set_info, context->texture_sets));
+        delete[] layouts;
+    } else { // Descriptor set
+        VkDescriptorSetAllocateInfo set_info{};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = context->descriptor_pool;
+        set_info.descriptorSetCount = 1;
+        set_info.pSetLayouts = &context->texture_set_layout;
+
+        VK_CHECK(vkAllocateDescriptorSets(context->device, &set_info, &context->texture_set));
+        VK_NAME(context, VK_OBJECT_TYPE_DESCRIPTOR_SET, context->texture_set, "textures");
+    }
+
+    { // Sampler
+        VkSamplerCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        create_info.magFilter = VK_FILTER_NEAREST;
+        create_info.minFilter = VK_FILTER_NEAREST;
+        create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        create_info.anisotropyEnable = VK_FALSE;
+        create_info.maxAnisotropy = 1.0f;
+        create_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        create_info.unnormalizedCoordinates = VK_FALSE;
+        create_info.compareEnable = VK_FALSE;
+        create_info.minLod = 0.0f;
+        create_info.maxLod = 0.0f;
+
+        VK_CHECK(vkCreateSampler(context->device, &create_info, context->allocator, &context->sampler));
+    }
+}
+
+internal void vk_cleanup_texture_resources(Vk_Context *context) {
+    vkDestroySampler(context->device, context->sampler, context->allocator);
+    vkDestroyDescriptorPool(context->device, context->descriptor_pool, context->allocator);
+    vkDestroyDescriptorSetLayout(context->device, context->texture_set_layout, context->allocator);
+    delete[] context->texture_sets;
+    context->texture_sets = NULL;
+}
+
+internal u32 vk_allocate_texture_slot(Vk_Context *context) {
+    if (context->free_texture_slot_count > 0) {
+        return context->free_texture_slots[--context->free_texture_slot_count];
+    }
+    if (context->texture_slot_count < context->texture_capacity) {
+        return context->texture_slot_count++;
+    }
+
+    LOG_WARNING("All %u texture slots are in use, sampling the placeholder instead", context->texture_capacity);
+    return 0;
+}
+
+internal void vk_free_texture_slot(Vk_Context *context, u32 slot) {
+    // Slot 0 is shared by the placeholder and every texture that didn't fit.
+    if (slot == 0) return;
+
+    vk_write_texture_slot(context, slot, context->placeholder_texture.view);
+    context->free_texture_slots[context->free_texture_slot_count++] = slot;
 }
 
-internal char *vk_read_code(const char *filename, u64 *size) {
-    FILE *file = NULL;
-    fopen_s(&file, filename, "rb");
-    ASSERT(file != NULL);
+internal void vk_write_texture_slot(Vk_Context *context, u32 slot, VkImageView view) {
+    ASSERT(slot < context->texture_capacity);
 
-    fseek(file, 0, SEEK_END);
-    *size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    context->texture_views[slot] = view;
+    if (!context->texture_slot_dirty[slot]) {
+        context->texture_slot_dirty[slot] = true;
+        context->dirty_texture_slots[context->dirty_texture_slot_count++] = slot;
+    }
+}
+
+internal void vk_flush_texture_slots(Vk_Context *context) {
+    u32 count = context->dirty_texture_slot_count;
+    if (count == 0) return;
+
+    b8 per_draw = context->texture_binding == VK_TEXTURE_BINDING_PER_DRAW;
+    auto image_infos = new VkDescriptorImageInfo[count];
+    auto writes = new VkWriteDescriptorSet[count]{};
+    for (u32 i = 0; i < count; ++i) {
+        u32 slot = context->dirty_texture_slots[i];
+        context->texture_slot_dirty[slot] = false;
+
+        image_infos[i].sampler = context->sampler;
+        image_infos[i].imageView = context->texture_views[slot];
+        image_infos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = per_draw ? context->texture_sets[slot] : context->texture_set;
+        writes[i].dstBinding = 0;
+        writes[i].dstArrayElement = per_draw ? 0 : slot;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[i].pImageInfo = &image_infos[i];
+    }
 
-    auto buffer = new char[*size];
-    fread(buffer, 1, *size, file);
-    fclose(file);
+    vkUpdateDescriptorSets(context->device, count, writes, 0, NULL);
+    context->dirty_texture_slot_count = 0;
+
+    delete[] writes;
+    delete[] image_infos;
+}
+
+internal void vk_create_instance_buffer(Vk_Context *context) {
+    VkDeviceSize sprite_size = MAX_SPRITE_INSTANCES * sizeof(Vk_Sprite_Instance);
+    VkDeviceSize size = sprite_size + MAX_SHAPE_INSTANCES * sizeof(Vk_Shape_Instance);
+    vk_create_buffer(
+        context, size,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &context->instance_buffer,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &context->instance_memory);
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, context->instance_buffer, "instances");
+
+    void *mapped;
+    VK_CHECK(vkMapMemory(context->device, context->instance_memory, 0, size, 0, &mapped));
+    context->instances = (Vk_Sprite_Instance *)mapped;
+    context->shape_instances = (Vk_Shape_Instance *)((u8 *)mapped + sprite_size);
+    context->shapes = new Vk_Shape[MAX_SHAPE_INSTANCES];
+
+    context->sort_entries = new Sort_Entry[MAX_SPRITE_INSTANCES + MAX_SCENE_BATCHES];
+    context->sort_scratch = new Sort_Entry[MAX_SPRITE_INSTANCES + MAX_SCENE_BATCHES];
+}
 
-    return buffer;
+internal void vk_cleanup_instance_buffer(Vk_Context *context) {
+    vkUnmapMemory(context->device, context->instance_memory);
+    vkDestroyBuffer(context->device, context->instance_buffer, context->allocator);
+    vk_free_memory(context, context->instance_memory);
+    context->instances = NULL;
+    context->shape_instances = NULL;
+
+    delete[] context->shapes;
+    context->shapes = NULL;
+    delete[] context->sort_entries;
+    delete[] context->sort_scratch;
+    context->sort_entries = NULL;
+    context->sort_scratch = NULL;
 }
 
 internal void vk_create_graphics_pipeline(Vk_Context *context) {
-    u64 vert_shader_size;
-    char *vert_shader_code = vk_read_code("res/shaders/quad.vert.spv", &vert_shader_size);
-    VkShaderModuleCreateInfo vert_shader_module_info{};
-    vert_shader_module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vert_shader_module_info.codeSize = vert_shader_size;
-    vert_shader_module_info.pCode = (u32 *)vert_shader_code;
-    VkShaderModule vert_shader_module;
-    VK_CHECK(vkCreateShaderModule(
-        context->device, &vert_shader_module_info, context->allocator, &vert_shader_module));
-
-    u64 frag_shader_size;
-    char *frag_shader_code = vk_read_code("res/shaders/quad.frag.spv", &frag_shader_size);
-    VkShaderModuleCreateInfo frag_shader_module_info{};
-    frag_shader_module_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    frag_shader_module_info.codeSize = frag_shader_size;
-    frag_shader_module_info.pCode = (u32 *)frag_shader_code;
-    VkShaderModule frag_shader_module;
-    VK_CHECK(vkCreateShaderModule(
-        context->device, &frag_shader_module_info, context->allocator, &frag_shader_module));
+    // The fallbacks can't use nonuniformEXT, so they have their own shaders.
+    const char *frag_shader_name = "quad.frag";
+    if (context->texture_binding == VK_TEXTURE_BINDING_ARRAY) frag_shader_name = "quad_array.frag";
+    if (context->texture_binding == VK_TEXTURE_BINDING_PER_DRAW) frag_shader_name = "quad_single.frag";
+
+    // Kept for variants built later on.
+    context->vert_shader_modules[VK_VERTEX_FORMAT_SPRITE] = vk_create_shader_module(context, "quad.vert");
+    context->vert_shader_modules[VK_VERTEX_FORMAT_SHAPE] = vk_create_shader_module(context, "shape.vert");
+    context->frag_shader_modules[VK_SHADER_SPRITE] = vk_create_shader_module(context, frag_shader_name);
+    context->frag_shader_modules[VK_SHADER_HEATMAP] = vk_create_shader_module(context, "overdraw.frag");
+    context->frag_shader_modules[VK_SHADER_SHAPE] = vk_create_shader_module(context, "shape.frag");
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &context->texture_set_layout;
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(Vk_Push_Constants);
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+    VK_CHECK(vkCreatePipelineLayout(
+        context->device, &pipeline_layout_info, context->allocator, &context->pipeline_layout));
+    VK_NAME(context, VK_OBJECT_TYPE_PIPELINE_LAYOUT, context->pipeline_layout, "quad");
+
+    // The driver ignores data from another device or driver version.
+    File_Mapping cache_file;
+    b8 has_cache_file = file_map(PIPELINE_CACHE_PATH, &cache_file);
+
+    VkPipelineCacheCreateInfo cache_info{};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (has_cache_file) {
+        cache_info.initialDataSize = cache_file.size;
+        cache_info.pInitialData = cache_file.data;
+    }
+    VK_CHECK(vkCreatePipelineCache(context->device, &cache_info, context->allocator, &context->pipeline_cache));
+    if (has_cache_file) {
+        LOG_INFO("Loaded %llu bytes of pipeline cache", (unsigned long long)cache_file.size);
+        file_unmap(&cache_file);
+    }
+
+    // Nothing to fall back to yet, so these are built right here. Opaque
+    // comes first as the base the others derive from.
+    Vk_Pipeline_Desc default_descs[VK_PIPELINE_COUNT] = {};
+    default_descs[VK_PIPELINE_OPAQUE].blend = VK_BLEND_OPAQUE;
+    default_descs[VK_PIPELINE_OPAQUE].depth = VK_DEPTH_TEST_WRITE;
+    default_descs[VK_PIPELINE_TRANSLUCENT].blend = VK_BLEND_ALPHA;
+    default_descs[VK_PIPELINE_TRANSLUCENT].depth = VK_DEPTH_TEST;
+
+    // Same depth state as what they stand in for, so they show what is
+    // actually shaded.
+    for (u32 i = VK_PIPELINE_HEATMAP_OPAQUE; i <= VK_PIPELINE_HEATMAP_TRANSLUCENT; ++i) {
+        default_descs[i] = default_descs[i - VK_PIPELINE_HEATMAP_OPAQUE];
+        default_descs[i].shader = VK_SHADER_HEATMAP;
+        default_descs[i].blend = VK_BLEND_ADDITIVE;
+    }
+
+    for (u32 i = 0; i < VK_PIPELINE_COUNT; ++i) {
+        default_descs[i].vertex_format = VK_VERTEX_FORMAT_SPRITE;
+        default_descs[i].topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        default_descs[i].cull_back = true;
+        context->default_pipelines[i] = vk_request_pipeline(context, &default_descs[i]);
+    }
+
+    // Shapes have antialiased edges, so they blend and leave depth alone.
+    Vk_Pipeline_Desc shape_desc{};
+    shape_desc.shader = VK_SHADER_SHAPE;
+    shape_desc.blend = VK_BLEND_ALPHA;
+    shape_desc.depth = VK_DEPTH_TEST;
+    shape_desc.vertex_format = VK_VERTEX_FORMAT_SHAPE;
+    shape_desc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    context->shape_pipelines[0] = vk_request_pipeline(context, &shape_desc);
+
+    shape_desc.shader = VK_SHADER_HEATMAP;
+    shape_desc.blend = VK_BLEND_ADDITIVE;
+    context->shape_pipelines[1] = vk_request_pipeline(context, &shape_desc);
+}
+
+internal void vk_cleanup_pipelines(Vk_Context *context) {
+    job_wait(context->jobs, &context->pipeline_jobs);
+
+    u64 size = 0;
+    VK_CHECK(vkGetPipelineCacheData(context->device, context->pipeline_cache, &size, NULL));
+    auto data = new u8[size];
+    VK_CHECK(vkGetPipelineCacheData(context->device, context->pipeline_cache, &size, data));
+
+    FILE *file = file_open(PIPELINE_CACHE_PATH, "wb");
+    if (file != NULL) {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    } else {
+        LOG_WARNING("Failed to save the pipeline cache to %s", PIPELINE_CACHE_PATH);
+    }
+    delete[] data;
+
+    for (u32 i = 0; i < context->pipeline_variant_count; ++i) {
+        vkDestroyPipeline(context->device, context->pipeline_variants[i].pipeline, context->allocator);
+    }
+    context->pipeline_variant_count = 0;
+    memset(context->pipeline_slots, 0, sizeof(context->pipeline_slots));
+
+    vkDestroyPipelineCache(context->device, context->pipeline_cache, context->allocator);
+    vkDestroyPipelineLayout(context->device, context->pipeline_layout, context->allocator);
+    for (u32 i = 0; i < VK_SHADER_COUNT; ++i) {
+        vkDestroyShaderModule(context->device, context->frag_shader_modules[i], context->allocator);
+    }
+    for (u32 i = 0; i < VK_VERTEX_FORMAT_COUNT; ++i) {
+        vkDestroyShaderModule(context->device, context->vert_shader_modules[i], context->allocator);
+    }
+}
+
+internal u64 vk_pipeline_key(Vk_Pipeline_Desc *desc) {
+    static_assert(sizeof(Vk_Pipeline_Desc) == sizeof(u64), "Vk_Pipeline_Desc must pack into a key");
+    u64 key;
+    memcpy(&key, desc, sizeof(key));
+    return key;
+}
+
+internal Vk_Pipeline_Id vk_request_pipeline(Vk_Context *context, Vk_Pipeline_Desc *desc) {
+    // Equal states have to make equal keys.
+    Vk_Pipeline_Desc normalized = *desc;
+    normalized.unused = 0;
+    if (!context->has_wireframe) normalized.wireframe = false;
+    u64 key = vk_pipeline_key(&normalized);
+
+    u32 slot_mask = ARRAY_COUNT(context->pipeline_slots) - 1;
+    u32 slot = (u32)((key * 0x9e3779b97f4a7c15ull) >> 32) & slot_mask;
+    for (;; slot = (slot + 1) & slot_mask) {
+        Vk_Pipeline_Id id = context->pipeline_slots[slot];
+        if (id == 0) break;
+        if (context->pipeline_variants[id - 1].key == key) return id;
+    }
+
+    // The defaults only take sprite vertices; other formats have nothing to
+    // fall back to.
+    Vk_Pipeline_Id fallback = 0;
+    if (normalized.vertex_format == VK_VERTEX_FORMAT_SPRITE) {
+        u32 kind = normalized.blend == VK_BLEND_OPAQUE ? VK_PIPELINE_OPAQUE : VK_PIPELINE_TRANSLUCENT;
+        if (normalized.shader == VK_SHADER_HEATMAP) kind += VK_PIPELINE_HEATMAP_OPAQUE;
+        fallback = context->default_pipelines[kind];
+    }
+
+    if (context->pipeline_variant_count == MAX_PIPELINE_VARIANTS) {
+        if (fallback == 0) LOG_FATAL("Out of pipeline variants");
+        LOG_WARNING("Out of pipeline variants, drawing with a default");
+        return fallback;
+    }
+
+    Vk_Pipeline_Id id = ++context->pipeline_variant_count;
+    context->pipeline_slots[slot] = id;
+
+    Vk_Pipeline_Variant *variant = &context->pipeline_variants[id - 1];
+    variant->context = context;
+    variant->desc = normalized;
+    variant->key = key;
+    variant->fallback = fallback;
+    variant->state.store(VK_PIPELINE_STATE_PENDING);
+    variant->pipeline = VK_NULL_HANDLE;
+
+    if (context->config.async_pipelines && variant->fallback != 0) {
+        job_submit(context->jobs, vk_build_pipeline_job, variant, &context->pipeline_jobs);
+    } else {
+        vk_build_pipeline(context, variant);
+    }
+    return id;
+}
+
+internal void vk_build_pipeline_job(void *data) {
+    auto variant = (Vk_Pipeline_Variant *)data;
+    vk_build_pipeline(variant->context, variant);
+}
+
+internal void vk_build_pipeline(Vk_Context *context, Vk_Pipeline_Variant *variant) {
+    u64 start_ns = time_now_ns();
+    Vk_Pipeline_Desc *desc = &variant->desc;
+
+    // TEXTURE_COUNT in the fragment shaders.
+    VkSpecializationMapEntry texture_count_entry{};
+    texture_count_entry.constantID = 0;
+    texture_count_entry.offset = 0;
+    texture_count_entry.size = sizeof(u32);
+
+    VkSpecializationInfo frag_specialization{};
+    frag_specialization.mapEntryCount = 1;
+    frag_specialization.pMapEntries = &texture_count_entry;
+    frag_specialization.dataSize = sizeof(u32);
+    frag_specialization.pData = &context->texture_capacity;
 
     VkPipelineShaderStageCreateInfo vert_shader_stage_info{};
     vert_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vert_shader_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vert_shader_stage_info.module = vert_shader_module;
+    vert_shader_stage_info.module = context->vert_shader_modules[desc->vertex_format];
     vert_shader_stage_info.pName = "main";
 
     VkPipelineShaderStageCreateInfo frag_shader_stage_info{};
     frag_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     frag_shader_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    frag_shader_stage_info.module = frag_shader_module;
+    frag_shader_stage_info.module = context->frag_shader_modules[desc->shader];
     frag_shader_stage_info.pName = "main";
+    if (desc->shader == VK_SHADER_SPRITE) frag_shader_stage_info.pSpecializationInfo = &frag_specialization;
 
     VkPipelineShaderStageCreateInfo shader_stages[] = {
         vert_shader_stage_info,
@@ -691,6 +2070,16 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     binding_desc.stride = sizeof(Vk_Vertex);
     binding_desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
+    VkVertexInputBindingDescription instance_binding_desc{};
+    instance_binding_desc.binding = 1;
+    instance_binding_desc.stride = sizeof(Vk_Sprite_Instance);
+    instance_binding_desc.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputBindingDescription binding_descs[] = {
+        binding_desc,
+        instance_binding_desc,
+    };
+
     VkVertexInputAttributeDescription a_position_desc{};
     a_position_desc.binding = 0;
     a_position_desc.location = 0;
@@ -703,21 +2092,78 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     a_tex_coord_desc.format = VK_FORMAT_R32G32_SFLOAT;
     a_tex_coord_desc.offset = offsetof(Vk_Vertex, tex_coord);
 
+    VkVertexInputAttributeDescription i_offset_desc{};
+    i_offset_desc.binding = 1;
+    i_offset_desc.location = 2;
+    i_offset_desc.format = VK_FORMAT_R32G32_SFLOAT;
+    i_offset_desc.offset = offsetof(Vk_Sprite_Instance, offset);
+
+    VkVertexInputAttributeDescription i_scale_desc{};
+    i_scale_desc.binding = 1;
+    i_scale_desc.location = 3;
+    i_scale_desc.format = VK_FORMAT_R32G32_SFLOAT;
+    i_scale_desc.offset = offsetof(Vk_Sprite_Instance, scale);
+
+    VkVertexInputAttributeDescription i_texture_desc{};
+    i_texture_desc.binding = 1;
+    i_texture_desc.location = 4;
+    i_texture_desc.format = VK_FORMAT_R32_UINT;
+    i_texture_desc.offset = offsetof(Vk_Sprite_Instance, texture_index);
+
+    VkVertexInputAttributeDescription i_depth_desc{};
+    i_depth_desc.binding = 1;
+    i_depth_desc.location = 5;
+    i_depth_desc.format = VK_FORMAT_R32_SFLOAT;
+    i_depth_desc.offset = offsetof(Vk_Sprite_Instance, depth);
+
     VkVertexInputAttributeDescription attribute_desc[] = {
         a_position_desc,
         a_tex_coord_desc,
+        i_offset_desc,
+        i_scale_desc,
+        i_texture_desc,
+        i_depth_desc,
+    };
+
+    // Shapes use the instance binding alone, bound at the shape instances.
+    VkVertexInputBindingDescription shape_binding_desc = instance_binding_desc;
+    shape_binding_desc.stride = sizeof(Vk_Shape_Instance);
+
+    VkVertexInputAttributeDescription shape_attribute_desc[7] = {};
+    VkFormat shape_formats[] = {
+        VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32_SFLOAT,
+        VK_FORMAT_R32_UINT, VK_FORMAT_R32_UINT, VK_FORMAT_R32_SFLOAT,
+    };
+    u32 shape_offsets[] = {
+        offsetof(Vk_Shape_Instance, p0), offsetof(Vk_Shape_Instance, p1),
+        offsetof(Vk_Shape_Instance, radius), offsetof(Vk_Shape_Instance, stroke),
+        offsetof(Vk_Shape_Instance, color), offsetof(Vk_Shape_Instance, kind),
+        offsetof(Vk_Shape_Instance, depth),
     };
+    for (u32 i = 0; i < ARRAY_COUNT(shape_attribute_desc); ++i) {
+        shape_attribute_desc[i].binding = 1;
+        shape_attribute_desc[i].location = i;
+        shape_attribute_desc[i].format = shape_formats[i];
+        shape_attribute_desc[i].offset = shape_offsets[i];
+    }
 
     VkPipelineVertexInputStateCreateInfo vertex_input_info{};
     vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.pVertexBindingDescriptions = &binding_desc;
-    vertex_input_info.vertexAttributeDescriptionCount = ARRAY_COUNT(attribute_desc);
-    vertex_input_info.pVertexAttributeDescriptions = attribute_desc;
+    if (desc->vertex_format == VK_VERTEX_FORMAT_SHAPE) {
+        vertex_input_info.vertexBindingDescriptionCount = 1;
+        vertex_input_info.pVertexBindingDescriptions = &shape_binding_desc;
+        vertex_input_info.vertexAttributeDescriptionCount = ARRAY_COUNT(shape_attribute_desc);
+        vertex_input_info.pVertexAttributeDescriptions = shape_attribute_desc;
+    } else {
+        vertex_input_info.vertexBindingDescriptionCount = ARRAY_COUNT(binding_descs);
+        vertex_input_info.pVertexBindingDescriptions = binding_descs;
+        vertex_input_info.vertexAttributeDescriptionCount = ARRAY_COUNT(attribute_desc);
+        vertex_input_info.pVertexAttributeDescriptions = attribute_desc;
+    }
 
     VkPipelineInputAssemblyStateCreateInfo input_assembly_info{};
     input_assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    input_assembly_info.topology = (VkPrimitiveTopology)desc->topology;
     input_assembly_info.primitiveRestartEnable = VK_FALSE;
 
     VkPipelineViewportStateCreateInfo viewport_info{};
@@ -729,9 +2175,9 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     rasterizer_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer_info.depthClampEnable = VK_FALSE;
     rasterizer_info.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer_info.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer_info.polygonMode = desc->wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
     rasterizer_info.lineWidth = 1.0f;
-    rasterizer_info.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer_info.cullMode = desc->cull_back ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
     rasterizer_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
     rasterizer_info.depthBiasEnable = VK_FALSE;
 
@@ -743,7 +2189,35 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     VkPipelineColorBlendAttachmentState color_blend_attachment{};
     color_blend_attachment.colorWriteMask =
         VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    color_blend_attachment.blendEnable = VK_FALSE;
+    color_blend_attachment.blendEnable = desc->blend != VK_BLEND_OPAQUE;
+    color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    switch (desc->blend) {
+        case VK_BLEND_ALPHA: {
+            color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        } break;
+        case VK_BLEND_PREMULTIPLIED: {
+            color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        } break;
+        case VK_BLEND_ADDITIVE: {
+            color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        } break;
+        case VK_BLEND_MULTIPLY: {
+            color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_DST_COLOR;
+            color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+            color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        } break;
+    }
 
     VkPipelineColorBlendStateCreateInfo color_blend_info{};
     color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -755,7 +2229,15 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     color_blend_info.blendConstants[1] = 0.0f;
     color_blend_info.blendConstants[2] = 0.0f;
     color_blend_info.blendConstants[3] = 0.0f;
-    
+
+    // Opaque items write depth so later ones behind them are rejected early.
+    // Equal depths pass, so ties still resolve in submission order.
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_info{};
+    depth_stencil_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_info.depthTestEnable = desc->depth != VK_DEPTH_OFF;
+    depth_stencil_info.depthWriteEnable = desc->depth == VK_DEPTH_TEST_WRITE;
+    depth_stencil_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
     VkDynamicState dynamic_states[] = {
         VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR,
@@ -765,14 +2247,6 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     dynamic_state_info.dynamicStateCount = ARRAY_COUNT(dynamic_states);
     dynamic_state_info.pDynamicStates = dynamic_states;
 
-    VkPipelineLayoutCreateInfo pipeline_layout_info{};
-    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_info.setLayoutCount = 0;
-    pipeline_layout_info.pushConstantRangeCount = 0;
-
-    VK_CHECK(vkCreatePipelineLayout(
-        context->device, &pipeline_layout_info, context->allocator, &context->pipeline_layout));
-
     VkGraphicsPipelineCreateInfo pipeline_info{};
     pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipeline_info.stageCount = ARRAY_COUNT(shader_stages);
@@ -782,35 +2256,120 @@ internal void vk_create_graphics_pipeline(Vk_Context *context) {
     pipeline_info.pViewportState = &viewport_info;
     pipeline_info.pRasterizationState = &rasterizer_info;
     pipeline_info.pMultisampleState = &multisampling_info;
-    pipeline_info.pDepthStencilState = NULL; // optional
+    pipeline_info.pDepthStencilState = context->depth_format != VK_FORMAT_UNDEFINED ? &depth_stencil_info : NULL;
     pipeline_info.pColorBlendState = &color_blend_info;
     pipeline_info.pDynamicState = &dynamic_state_info;
     pipeline_info.layout = context->pipeline_layout;
     pipeline_info.renderPass = context->render_pass;
     pipeline_info.subpass = 0;
-    pipeline_info.basePipelineHandle = VK_NULL_HANDLE; // optional
+    pipeline_info.basePipelineIndex = -1;
+
+    // Variants differ from the first default by a few bits of fixed-function
+    // state, which some drivers build faster as a derivative.
+    Vk_Pipeline_Variant *base = &context->pipeline_variants[0];
+    if (variant == base) {
+        pipeline_info.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+    } else {
+        pipeline_info.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+        pipeline_info.basePipelineHandle = base->pipeline;
+    }
+
+    // Without a render pass, the attachment formats come from here instead.
+    VkPipelineRenderingCreateInfoKHR rendering_info{};
+    rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachmentFormats = &context->swapchain_image_format;
+    rendering_info.depthAttachmentFormat = context->depth_format;
+    if (context->rendering_path != VK_RENDERING_PATH_RENDER_PASS) pipeline_info.pNext = &rendering_info;
 
     VK_CHECK(vkCreateGraphicsPipelines(
-        context->device, VK_NULL_HANDLE, 1, &pipeline_info, context->allocator, &context->graphics_pipeline));
+        context->device, context->pipeline_cache, 1, &pipeline_info, context->allocator, &variant->pipeline));
+
+    char name[64];
+    snprintf(name, sizeof(name), "variant %016llx", (unsigned long long)variant->key);
+    VK_NAME(context, VK_OBJECT_TYPE_PIPELINE, variant->pipeline, name);
+
+    variant->state.store(VK_PIPELINE_STATE_READY, std::memory_order_release);
+    LOG_INFO("Built pipeline variant %016llx in %.2f ms", (unsigned long long)variant->key, NS_TO_MS(time_now_ns() - start_ns));
+}
+
+internal VkPipeline vk_resolve_pipeline(Vk_Context *context, Vk_Pipeline_Id id) {
+    Vk_Pipeline_Variant *variant = &context->pipeline_variants[id - 1];
+    if (variant->state.load(std::memory_order_acquire) != VK_PIPELINE_STATE_READY) {
+        variant = &context->pipeline_variants[variant->fallback - 1];
+    }
+    return variant->pipeline;
+}
+
+internal VkFormat vk_choose_depth_format(Vk_Context *context) {
+    if (!context->config.depth_buffer) return VK_FORMAT_UNDEFINED;
 
-    vkDestroyShaderModule(context->device, frag_shader_module, context->allocator);
-    delete[] frag_shader_code;
+    // No stencil is needed. Even 16 bits leave 256 steps per layer.
+    VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM};
+    for (u32 i = 0; i < ARRAY_COUNT(candidates); ++i) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(context->physical_device, candidates[i], &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) return candidates[i];
+    }
+
+    LOG_WARNING("No depth format supported, drawing without a depth buffer");
+    return VK_FORMAT_UNDEFINED;
+}
+
+internal void vk_init_statistics(Vk_Context *context) {
+    if (!context->has_pipeline_statistics) return;
+
+    VkQueryPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    pool_info.queryCount = 1;
+    pool_info.pipelineStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    VK_CHECK(vkCreateQueryPool(context->device, &pool_info, context->allocator, &context->statistics_pool));
+}
+
+internal void vk_cleanup_statistics(Vk_Context *context) {
+    vkDestroyQueryPool(context->device, context->statistics_pool, context->allocator);
+}
 
-    vkDestroyShaderModule(context->device, vert_shader_module, context->allocator);
-    delete[] vert_shader_code;
+internal void vk_update_statistics(Vk_Context *context) {
+    if (!context->statistics_pending) return;
+    context->statistics_pending = false;
+
+    // In order of the statistic bits.
+    u64 results[2];
+    VkResult result = vkGetQueryPoolResults(
+        context->device, context->statistics_pool, 0, 1, sizeof(results), results, sizeof(results),
+        VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) return;
+
+    Vk_Gpu_Stats *gpu = &context->stats.gpu;
+    gpu->vertex_invocations = results[0];
+    gpu->fragment_invocations = results[1];
+    gpu->overdraw_shaded = (f32)(results[1] / MAX(context->statistics_pixels, 1.0));
 }
 
 internal void vk_create_framebuffers(Vk_Context *context) {
+    if (context->rendering_path != VK_RENDERING_PATH_RENDER_PASS) return;
+
     context->framebuffers = new VkFramebuffer[context->swapchain_image_count];
 
+    // The depth transient is swapchain-sized, so every framebuffer can share it.
+    VkImageView depth_view = VK_NULL_HANDLE;
+    u32 attachment_count = 1;
+    if (context->depth_format != VK_FORMAT_UNDEFINED) {
+        depth_view = graph_resource(context->graph, context->depth_target)->view;
+        attachment_count = 2;
+    }
+
     for (u32 i = 0; i < context->swapchain_image_count; ++i) {
-        // TODO: we might need depth attachment later
-        VkImageView attachments[] = {context->swapchain_image_views[i]};
+        VkImageView attachments[] = {context->swapchain_image_views[i], depth_view};
         
         VkFramebufferCreateInfo create_info{};
         create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         create_info.renderPass = context->render_pass;
-        create_info.attachmentCount = ARRAY_COUNT(attachments);
+        create_info.attachmentCount = attachment_count;
         create_info.pAttachments = attachments;
         create_info.width = context->swapchain_extent.width;
         create_info.height = context->swapchain_extent.height;
@@ -819,14 +2378,36 @@ internal void vk_create_framebuffers(Vk_Context *context) {
         VK_CHECK(vkCreateFramebuffer(
             context->device, &create_info, context->allocator, &context->framebuffers[i]));
     }
+
+    if (context->resolution.enabled) {
+        Graph_Resource *scene = graph_resource(context->graph, context->scene_target);
+        VkImageView attachments[] = {scene->view, depth_view};
+
+        VkFramebufferCreateInfo create_info{};
+        create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        create_info.renderPass = context->render_pass;
+        create_info.attachmentCount = attachment_count;
+        create_info.pAttachments = attachments;
+        create_info.width = scene->extent.width;
+        create_info.height = scene->extent.height;
+        create_info.layers = 1;
+
+        VK_CHECK(vkCreateFramebuffer(
+            context->device, &create_info, context->allocator, &context->scene_framebuffer));
+    }
 }
 
 internal void vk_cleanup_framebuffers(Vk_Context *context) {
+    if (context->framebuffers == NULL) return;
+
     for (u32 i = 0; i < context->swapchain_image_count; ++i) {
         vkDestroyFramebuffer(context->device, context->framebuffers[i], context->allocator);
     }
     delete[] context->framebuffers;
     context->framebuffers = NULL;
+
+    vkDestroyFramebuffer(context->device, context->scene_framebuffer, context->allocator);
+    context->scene_framebuffer = VK_NULL_HANDLE;
 }
 
 internal void vk_create_command_buffer(Vk_Context *context) {
@@ -847,6 +2428,7 @@ internal void vk_create_command_buffer(Vk_Context *context) {
         alloc_info.commandBufferCount = 1;
 
         VK_CHECK(vkAllocateCommandBuffers(context->device, &alloc_info, &context->command_buffer));
+        VK_NAME(context, VK_OBJECT_TYPE_COMMAND_BUFFER, context->command_buffer, "frame");
     }
 }
 
@@ -866,70 +2448,633 @@ internal void vk_create_sync_objects(Vk_Context *context) {
 
     VK_CHECK(vkCreateFence(
         context->device, &fence_create_info, context->allocator, &context->in_flight_fence));
-}
 
-internal void vk_record_command_buffer(Vk_Context *context, u32 image_index) {
-    VkCommandBufferBeginInfo cmd_begin_info{};
-    cmd_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    cmd_begin_info.flags = 0; // optional
-    cmd_begin_info.pInheritanceInfo = NULL; // optional, only relevant for secondary command buffers
-    VK_CHECK(vkBeginCommandBuffer(context->command_buffer, &cmd_begin_info));
+    VK_NAME(context, VK_OBJECT_TYPE_SEMAPHORE, context->image_available_semaphore, "image available");
+    VK_NAME(context, VK_OBJECT_TYPE_SEMAPHORE, context->render_finished_semaphore, "render finished");
+    VK_NAME(context, VK_OBJECT_TYPE_FENCE, context->in_flight_fence, "frame in flight");
+}
 
-    { // Render pass
-        VkRenderPassBeginInfo render_pass_info{};
-        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        render_pass_info.renderPass = context->render_pass;
-        render_pass_info.framebuffer = context->framebuffers[image_index];
-        render_pass_info.renderArea.offset.x = 0;
-        render_pass_info.renderArea.offset.y = 0;
-        render_pass_info.renderArea.extent.width = context->swapchain_extent.width;
-        render_pass_info.renderArea.extent.height = context->swapchain_extent.height;
-        render_pass_info.pNext = NULL;
-        u32 clear_value_count = 1;
-        auto clear_values = new VkClearValue[clear_value_count]{};
-        clear_values[0].color.float32[0] = 0.0f;
-        clear_values[0].color.float32[1] = 0.0f;
-        clear_values[0].color.float32[2] = 0.0f;
-        clear_values[0].color.float32[3] = 1.0f;
-        render_pass_info.clearValueCount = clear_value_count;
-        render_pass_info.pClearValues = clear_values;
+internal void vk_create_frame_graph(Vk_Context *context) {
+    Render_Graph *graph = graph_create();
 
-        vkCmdBeginRenderPass(context->command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    // Waiting on image_available_semaphore happens at the color output stage.
+    // A headless frame ends ready to be copied out instead of presented.
+    Graph_Access final_access = context->config.headless ? GRAPH_ACCESS_TRANSFER_SRC : GRAPH_ACCESS_PRESENT;
+    context->backbuffer = graph_import_image(
+        graph, "backbuffer", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, final_access);
 
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (f32)context->swapchain_extent.width;
-        viewport.height = (f32)context->swapchain_extent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(context->command_buffer, 0, 1, &viewport);
-    
-        VkRect2D scissor{};
-        scissor.offset.x = 0;
-        scissor.offset.y = 0;
-        scissor.extent = context->swapchain_extent;
-        vkCmdSetScissor(context->command_buffer, 0, 1, &scissor);
+    // Swapchain-sized even when the scene renders smaller, so the UI can use
+    // it too. Recreated with the swapchain like every transient.
+    b8 has_depth = context->depth_format != VK_FORMAT_UNDEFINED;
+    if (has_depth) context->depth_target = graph_create_image(graph, "depth", context->depth_format, 1.0f);
 
-        vkCmdBindPipeline(context->command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->graphics_pipeline);
+    if (context->resolution.enabled) {
+        // Allocated at full size; the scene only renders into the scaled
+        // corner of it, so a scale change never recreates anything.
+        context->scene_target = graph_create_image(graph, "scene", context->swapchain_image_format, 1.0f);
 
-        {
-            u32 first_binding = 0;
-            VkBuffer buffers[] = {context->vertex_buffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(context->command_buffer, first_binding, ARRAY_COUNT(buffers), buffers, offsets);
-        }
+        u32 scene_pass = graph_add_pass(graph, "scene", vk_scene_pass, context);
+        graph_use(graph, scene_pass, context->scene_target, GRAPH_ACCESS_COLOR_WRITE);
+        if (has_depth) graph_use(graph, scene_pass, context->depth_target, GRAPH_ACCESS_DEPTH_WRITE);
 
-        vkCmdBindIndexBuffer(context->command_buffer, context->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        u32 upscale_pass = graph_add_pass(graph, "upscale", vk_upscale_pass, context);
+        graph_use(graph, upscale_pass, context->scene_target, GRAPH_ACCESS_TRANSFER_SRC);
+        graph_use(graph, upscale_pass, context->backbuffer, GRAPH_ACCESS_TRANSFER_DST);
 
-        vkCmdDrawIndexed(context->command_buffer, 6, 1, 0, 0, 0);
+        u32 ui_pass = graph_add_pass(graph, "ui", vk_ui_pass, context);
+        graph_use(graph, ui_pass, context->backbuffer, GRAPH_ACCESS_COLOR_WRITE);
+        if (has_depth) graph_use(graph, ui_pass, context->depth_target, GRAPH_ACCESS_DEPTH_WRITE);
+    } else {
+        // Scene and UI both go straight into the backbuffer.
+        context->scene_target = context->backbuffer;
 
-        vkCmdEndRenderPass(context->command_buffer);
+        u32 scene_pass = graph_add_pass(graph, "scene", vk_scene_pass, context);
+        graph_use(graph, scene_pass, context->backbuffer, GRAPH_ACCESS_COLOR_WRITE);
+        if (has_depth) graph_use(graph, scene_pass, context->depth_target, GRAPH_ACCESS_DEPTH_WRITE);
+    }
 
-        delete[] clear_values;
+    // Last, so it sees the UI too.
+    if (context->config.capture) {
+        u32 capture_pass = graph_add_pass(graph, "capture", vk_capture_pass, context);
+        graph_use(graph, capture_pass, context->backbuffer, GRAPH_ACCESS_TRANSFER_SRC);
+        graph_set_side_effects(graph, capture_pass);
     }
 
-    VK_CHECK(vkEndCommandBuffer(context->command_buffer));
+    graph_compile(graph, context);
+    context->graph = graph;
+}
+
+internal void vk_scene_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data) {
+    auto context = (Vk_Context *)user_data;
+
+    b8 offscreen = context->resolution.enabled;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    if (context->framebuffers) {
+        framebuffer = offscreen ? context->scene_framebuffer : context->framebuffers[context->frame_image_index];
+    }
+
+    VkImageView depth_view = VK_NULL_HANDLE;
+    if (context->depth_format != VK_FORMAT_UNDEFINED) depth_view = graph_resource(graph, context->depth_target)->view;
+
+    // Statistics queries have to begin and end outside the render pass.
+    if (context->has_pipeline_statistics) vkCmdBeginQuery(command_buffer, context->statistics_pool, 0, 0);
+
+    VkExtent2D extent = vk_scene_extent(context);
+    vk_cmd_begin_rendering(
+        context, command_buffer, graph_resource(graph, context->scene_target)->view, depth_view, framebuffer,
+        extent, true);
+    f64 covered_pixels = vk_cmd_draw_items(context, command_buffer, extent, false);
+    if (!offscreen) covered_pixels += vk_cmd_draw_items(context, command_buffer, extent, true);
+    vk_cmd_end_rendering(context, command_buffer);
+
+    f64 pixels = (f64)extent.width * extent.height;
+    if (context->has_pipeline_statistics) {
+        vkCmdEndQuery(command_buffer, context->statistics_pool, 0);
+        context->statistics_pending = true;
+        context->statistics_pixels = pixels;
+    }
+
+    context->stats.overdraw_covered = (f32)(covered_pixels / MAX(pixels, 1.0));
+}
+
+internal void vk_upscale_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data) {
+    auto context = (Vk_Context *)user_data;
+
+    VkExtent2D src_extent = vk_scene_extent(context);
+    VkExtent2D dst_extent = context->swapchain_extent;
+
+    VkImageBlit blit{};
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1].x = (s32)src_extent.width;
+    blit.srcOffsets[1].y = (s32)src_extent.height;
+    blit.srcOffsets[1].z = 1;
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.layerCount = 1;
+    blit.dstOffsets[1].x = (s32)dst_extent.width;
+    blit.dstOffsets[1].y = (s32)dst_extent.height;
+    blit.dstOffsets[1].z = 1;
+
+    vkCmdBlitImage(
+        command_buffer,
+        graph_resource(graph, context->scene_target)->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        graph_resource(graph, context->backbuffer)->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &blit, VK_FILTER_LINEAR);
+}
+
+internal void vk_ui_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data) {
+    auto context = (Vk_Context *)user_data;
+
+    VkImageView depth_view = VK_NULL_HANDLE;
+    if (context->depth_format != VK_FORMAT_UNDEFINED) depth_view = graph_resource(graph, context->depth_target)->view;
+
+    VkFramebuffer framebuffer = context->framebuffers ? context->framebuffers[context->frame_image_index] : VK_NULL_HANDLE;
+    vk_cmd_begin_rendering(
+        context, command_buffer, graph_resource(graph, context->backbuffer)->view, depth_view, framebuffer,
+        context->swapchain_extent, false);
+    vk_cmd_draw_items(context, command_buffer, context->swapchain_extent, true);
+    vk_cmd_end_rendering(context, command_buffer);
+}
+
+internal void vk_cmd_begin_rendering(
+    Vk_Context *context, VkCommandBuffer command_buffer, VkImageView view, VkImageView depth_view,
+    VkFramebuffer framebuffer, VkExtent2D extent, b8 clear) {
+    b8 has_depth = depth_view != VK_NULL_HANDLE;
+
+    VkClearValue clear_values[2] = {};
+    clear_values[0].color.float32[3] = 1.0f;
+    clear_values[1].depthStencil.depth = 1.0f;
+
+    if (context->rendering_path != VK_RENDERING_PATH_RENDER_PASS) {
+        VkRenderingAttachmentInfoKHR color_attachment{};
+        color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        color_attachment.imageView = view;
+        color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color_attachment.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.clearValue = clear_values[0];
+
+        VkRenderingAttachmentInfoKHR depth_attachment{};
+        depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        depth_attachment.imageView = depth_view;
+        depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.clearValue = clear_values[1];
+
+        VkRenderingInfoKHR rendering_info{};
+        rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        rendering_info.renderArea.extent = extent;
+        rendering_info.layerCount = 1;
+        rendering_info.colorAttachmentCount = 1;
+        rendering_info.pColorAttachments = &color_attachment;
+        rendering_info.pDepthAttachment = has_depth ? &depth_attachment : NULL;
+
+        context->cmd_begin_rendering(command_buffer, &rendering_info);
+    } else {
+        VkRenderPassBeginInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        render_pass_info.renderPass = clear ? context->render_pass : context->overlay_render_pass;
+        render_pass_info.framebuffer = framebuffer;
+        render_pass_info.renderArea.offset.x = 0;
+        render_pass_info.renderArea.offset.y = 0;
+        render_pass_info.renderArea.extent = extent;
+        render_pass_info.pNext = NULL;
+        // Indexed by attachment, so the depth clear needs the color slot too.
+        render_pass_info.clearValueCount = has_depth ? 2 : (clear ? 1 : 0);
+        render_pass_info.pClearValues = clear_values;
+
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (f32)extent.width;
+    viewport.height = (f32)extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset.x = 0;
+    scissor.offset.y = 0;
+    scissor.extent = extent;
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+}
+
+internal void vk_cmd_end_rendering(Vk_Context *context, VkCommandBuffer command_buffer) {
+    if (context->rendering_path != VK_RENDERING_PATH_RENDER_PASS) {
+        context->cmd_end_rendering(command_buffer);
+    } else {
+        vkCmdEndRenderPass(command_buffer);
+    }
+}
+
+internal f64 vk_cmd_draw_items(Vk_Context *context, VkCommandBuffer command_buffer, VkExtent2D extent, b8 ui) {
+    if (context->texture_binding != VK_TEXTURE_BINDING_PER_DRAW) {
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipeline_layout,
+            0, 1, &context->texture_set, 0, NULL);
+        context->stats.submit.descriptor_binds++;
+    }
+
+    // The camera was latched right before recording, so the transform and the
+    // culling bounds both come from the freshest input. UI items skip it.
+    Vk_Push_Constants push_constants{};
+    Vk_Bounds bounds;
+    f32 pixels_per_unit[2];
+    if (ui) {
+        for (u32 i = 0; i < 4; ++i) push_constants.view_projection[i * 5] = 1.0f;
+        bounds = {{-1.0f, -1.0f}, {1.0f, 1.0f}};
+        pixels_per_unit[0] = extent.width * 0.5f;
+        pixels_per_unit[1] = extent.height * 0.5f;
+    } else {
+        vk_camera_view_projection(&context->camera, context->swapchain_extent, push_constants.view_projection);
+        bounds = vk_camera_bounds(&context->camera, context->swapchain_extent);
+        pixels_per_unit[0] = pixels_per_unit[1] = context->camera.zoom * extent.height * 0.5f;
+    }
+    push_constants.viewport_size[0] = (f32)extent.width;
+    push_constants.viewport_size[1] = (f32)extent.height;
+    vkCmdPushConstants(
+        command_buffer, context->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT,
+        0, sizeof(Vk_Push_Constants), &push_constants);
+
+    Vk_Bind_State bound = {VK_NULL_HANDLE, NULL, VK_NULL_HANDLE, UINT32_MAX};
+
+    // Passes share the instance buffer, each one appending after the last.
+    u32 first_instance = context->instance_count;
+
+    Vk_Frame_Stats *stats = &context->stats;
+    Vk_Draw_Item *items = context->frame_items;
+    Sort_Entry *entries = context->sort_entries;
+    u32 visible_count = 0;
+    for (u32 i = 0; i < context->frame_item_count; ++i) {
+        Vk_Draw_Item *item = &items[i];
+        if (item->ui != ui) continue;
+        if (!vk_is_item_visible(item, &bounds)) {
+            stats->culled_count++;
+            continue;
+        }
+        if (first_instance + visible_count == MAX_SPRITE_INSTANCES) {
+            LOG_WARNING("Dropping sprites over MAX_SPRITE_INSTANCES");
+            break;
+        }
+
+        entries[visible_count].key = vk_item_sort_key(context, item);
+        entries[visible_count].value = i;
+        visible_count++;
+    }
+    stats->visible_count += visible_count;
+    stats->instance_count += visible_count;
+    stats->instance_bytes += visible_count * sizeof(Vk_Sprite_Instance);
+    context->instance_count += visible_count;
+
+    vk_count_unsorted_state_changes(context, entries, visible_count, &stats->unsorted);
+
+    // Retained batches sort among the items as units, so layers and
+    // translucency order across both.
+    Scene *scene = ui ? NULL : context->scene;
+    u32 entry_count = visible_count;
+    if (scene) {
+        for (u32 b = 0; b < scene->batch_count; ++b) {
+            if (scene->batches[b].count == 0) continue;
+            entries[entry_count].key = scene_batch_sort_key(scene, context, b);
+            entries[entry_count].value = VK_SORT_SCENE_BATCH | b;
+            entry_count++;
+        }
+    }
+
+    u64 sort_start_ns = time_now_ns();
+    sort_radix(context->jobs, entries, context->sort_scratch, entry_count);
+    stats->sort_ns += time_now_ns() - sort_start_ns;
+
+    // Consecutive items are one instanced draw until the pipeline or mesh
+    // changes, or without bindless textures, the texture. Instances are written
+    // in sorted order, so a run is [batch_start, instance_index).
+    b8 bindless = vk_has_bindless_textures(context);
+    Vk_Sprite_Instance *instances = context->instances + first_instance;
+    Vk_Pipeline_Id batch_pipeline = 0;
+    Vk_Mesh *batch_mesh = NULL;
+    u32 batch_start = 0;
+    u32 instance_index = 0;
+    f64 covered_pixels = 0.0;
+
+    for (u32 i = 0; i < entry_count; ++i) {
+        u32 value = entries[i].value;
+        if (value & VK_SORT_SCENE_BATCH) {
+            if (instance_index > batch_start) {
+                vk_cmd_bind_instances(command_buffer, &bound, context->instance_buffer);
+                vk_cmd_bind_texture(context, command_buffer, &bound, instances[batch_start].texture_index);
+                vk_cmd_draw_sprites(
+                    context, command_buffer, &bound, batch_pipeline, batch_mesh,
+                    first_instance + batch_start, instance_index - batch_start);
+                batch_start = instance_index;
+            }
+            scene_cmd_draw_batch(scene, context, command_buffer, &bound, value & ~VK_SORT_SCENE_BATCH);
+            continue;
+        }
+
+        Vk_Draw_Item *item = &items[value];
+        Vk_Pipeline_Id pipeline = vk_item_pipeline(context, item);
+        u32 texture_index = item->texture->index;
+
+        b8 breaks_batch = instance_index > batch_start &&
+            (pipeline != batch_pipeline || item->mesh != batch_mesh ||
+             (!bindless && texture_index != instances[batch_start].texture_index));
+        if (breaks_batch) {
+            vk_cmd_bind_instances(command_buffer, &bound, context->instance_buffer);
+            vk_cmd_bind_texture(context, command_buffer, &bound, instances[batch_start].texture_index);
+            vk_cmd_draw_sprites(
+                context, command_buffer, &bound, batch_pipeline, batch_mesh,
+                first_instance + batch_start, instance_index - batch_start);
+            batch_start = instance_index;
+        }
+        batch_pipeline = pipeline;
+        batch_mesh = item->mesh;
+
+        Vk_Sprite_Instance *instance = &instances[instance_index++];
+        instance->offset[0] = item->offset[0];
+        instance->offset[1] = item->offset[1];
+        instance->scale[0] = item->scale[0];
+        instance->scale[1] = item->scale[1];
+        instance->texture_index = texture_index;
+        instance->depth = vk_item_depth(item);
+
+        f32 width = 2.0f * item->mesh->extent[0] * fabsf(item->scale[0]) * pixels_per_unit[0];
+        f32 height = 2.0f * item->mesh->extent[1] * fabsf(item->scale[1]) * pixels_per_unit[1];
+        covered_pixels += (f64)width * height;
+    }
+    if (instance_index > batch_start) {
+        vk_cmd_bind_instances(command_buffer, &bound, context->instance_buffer);
+        vk_cmd_bind_texture(context, command_buffer, &bound, instances[batch_start].texture_index);
+        vk_cmd_draw_sprites(
+            context, command_buffer, &bound, batch_pipeline, batch_mesh,
+            first_instance + batch_start, instance_index - batch_start);
+    }
+
+    covered_pixels += vk_cmd_draw_shapes(context, command_buffer, &bound, &bounds, pixels_per_unit, ui);
+
+    return covered_pixels;
+}
+
+internal b8 vk_is_item_visible(Vk_Draw_Item *item, Vk_Bounds *bounds) {
+    for (u32 axis = 0; axis < 2; ++axis) {
+        f32 extent = item->mesh->extent[axis] * fabsf(item->scale[axis]);
+        if (item->offset[axis] + extent < bounds->min[axis]) return false;
+        if (item->offset[axis] - extent > bounds->max[axis]) return false;
+    }
+    return true;
+}
+
+internal Vk_Pipeline_Id vk_item_pipeline(Vk_Context *context, Vk_Draw_Item *item) {
+    return vk_select_pipeline(context, item->pipeline, item->translucent);
+}
+
+internal Vk_Pipeline_Id vk_select_pipeline(Vk_Context *context, Vk_Pipeline_Id pipeline, b8 translucent) {
+    u32 kind = translucent ? VK_PIPELINE_TRANSLUCENT : VK_PIPELINE_OPAQUE;
+    if (context->overdraw_heatmap) return context->default_pipelines[kind + VK_PIPELINE_HEATMAP_OPAQUE];
+    return pipeline != 0 ? pipeline : context->default_pipelines[kind];
+}
+
+internal u64 vk_item_sort_key(Vk_Context *context, Vk_Draw_Item *item) {
+    return vk_sort_key(
+        context, item->layer, item->translucent, vk_item_pipeline(context, item), item->texture->index, item->depth);
+}
+
+internal u64 vk_sort_key(Vk_Context *context, u8 layer, b8 translucent, Vk_Pipeline_Id pipeline, u32 texture, f32 depth) {
+    b8 depth_tested = context->depth_format != VK_FORMAT_UNDEFINED;
+    u64 depth_max = (1ull << VK_SORT_DEPTH_BITS) - 1;
+    u64 depth_bits = MIN((u64)(CLAMP(0.0, (f64)depth, 1.0) * (f64)depth_max), depth_max);
+    u64 pipeline_bits = pipeline & 0xff;
+    u64 texture_bits = texture & 0xffff;
+
+    u64 key = 0;
+    if (translucent || !depth_tested) {
+        key |= (depth_max - depth_bits) << 24;
+        key |= pipeline_bits << 16;
+        key |= texture_bits;
+    } else {
+        key |= pipeline_bits << 47;
+        key |= texture_bits << 31;
+        key |= depth_bits;
+    }
+
+    u64 order;
+    if (depth_tested) {
+        order = translucent ? (1ull << 8) | layer : 255 - layer;
+    } else {
+        order = ((u64)layer << 1) | (translucent ? 1 : 0);
+    }
+    return key | (order << 55);
+}
+
+internal f64 vk_cmd_draw_shapes(
+    Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound, Vk_Bounds *bounds,
+    f32 pixels_per_unit[2], b8 ui) {
+    Vk_Frame_Stats *stats = &context->stats;
+    u32 first_instance = context->shape_instance_count;
+    Vk_Shape_Instance *instances = context->shape_instances + first_instance;
+    u32 count = 0;
+    f64 covered_pixels = 0.0;
+
+    for (u32 i = 0; i < context->shape_count; ++i) {
+        Vk_Shape *shape = &context->shapes[i];
+        if (shape->ui != ui) continue;
+        if (!vk_is_shape_visible(shape, bounds)) {
+            stats->culled_count++;
+            continue;
+        }
+
+        Vk_Shape_Instance *instance = &instances[count++];
+        instance->p0[0] = shape->p0[0];
+        instance->p0[1] = shape->p0[1];
+        instance->p1[0] = shape->p1[0];
+        instance->p1[1] = shape->p1[1];
+        instance->radius = shape->radius;
+        instance->stroke = shape->stroke;
+        instance->color = shape->color;
+        instance->kind = shape->kind;
+        instance->depth = vk_shape_depth(shape);
+
+        f32 size[2];
+        if (shape->kind == VK_SHAPE_SEGMENT) {
+            f32 dx = shape->p1[0] - shape->p0[0];
+            f32 dy = shape->p1[1] - shape->p0[1];
+            size[0] = sqrtf(dx * dx + dy * dy) + 2.0f * shape->radius + shape->stroke;
+            size[1] = 2.0f * shape->radius + shape->stroke;
+        } else {
+            f32 half[2] = {shape->radius, shape->radius};
+            if (shape->kind == VK_SHAPE_RECT) {
+                half[0] = shape->p1[0];
+                half[1] = shape->p1[1];
+            }
+            size[0] = 2.0f * half[0] + shape->stroke;
+            size[1] = 2.0f * half[1] + shape->stroke;
+        }
+        covered_pixels += (f64)size[0] * pixels_per_unit[0] * size[1] * pixels_per_unit[1];
+    }
+    if (count == 0) return 0.0;
+
+    context->shape_instance_count += count;
+    stats->shape_count += count;
+    stats->instance_bytes += count * sizeof(Vk_Shape_Instance);
+
+    VkPipeline pipeline = vk_resolve_pipeline(context, context->shape_pipelines[context->overdraw_heatmap ? 1 : 0]);
+    if (pipeline != bound->pipeline) {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        bound->pipeline = pipeline;
+        stats->submit.pipeline_binds++;
+    }
+
+    // Six vertices per shape, placed by the vertex shader; the instance
+    // binding is moved to the shapes, which sprites rebind per pass.
+    u32 instance_binding = 1;
+    VkDeviceSize instance_offset = (u8 *)context->shape_instances - (u8 *)context->instances;
+    vkCmdBindVertexBuffers(command_buffer, instance_binding, 1, &context->instance_buffer, &instance_offset);
+    bound->instance_buffer = VK_NULL_HANDLE; // Bound at an offset, so sprites have to rebind
+    vkCmdDraw(command_buffer, 6, count, 0, first_instance);
+    stats->submit.draw_calls++;
+
+    return covered_pixels;
+}
+
+internal b8 vk_is_shape_visible(Vk_Shape *shape, Vk_Bounds *bounds) {
+    f32 min[2], max[2];
+    f32 margin = shape->radius + shape->stroke * 0.5f;
+    for (u32 axis = 0; axis < 2; ++axis) {
+        if (shape->kind == VK_SHAPE_SEGMENT) {
+            min[axis] = MIN(shape->p0[axis], shape->p1[axis]) - margin;
+            max[axis] = MAX(shape->p0[axis], shape->p1[axis]) + margin;
+        } else {
+            f32 extent = shape->kind == VK_SHAPE_RECT ? shape->p1[axis] + shape->stroke * 0.5f : margin;
+            min[axis] = shape->p0[axis] - extent;
+            max[axis] = shape->p0[axis] + extent;
+        }
+        if (max[axis] < bounds->min[axis]) return false;
+        if (min[axis] > bounds->max[axis]) return false;
+    }
+    return true;
+}
+
+internal f32 vk_shape_depth(Vk_Shape *shape) {
+    // In front of sprites of the same layer, like an overlay.
+    return vk_layer_depth(shape->layer, 0.0f, shape->ui);
+}
+
+internal void vk_push_shape(Vk_Context *context, Vk_Shape *shape) {
+    if (context->shape_count == MAX_SHAPE_INSTANCES) {
+        LOG_WARNING("Dropping shapes over MAX_SHAPE_INSTANCES");
+        return;
+    }
+    context->shapes[context->shape_count++] = *shape;
+}
+
+internal void vk_push_polyline(
+    Vk_Context *context, const f32 (*points)[2], u32 point_count, f32 width, u32 color, u8 layer, b8 ui) {
+    Vk_Shape segment{};
+    segment.kind = VK_SHAPE_SEGMENT;
+    segment.color = color;
+    segment.radius = width * 0.5f;
+    segment.layer = layer;
+    segment.ui = ui;
+    for (u32 i = 1; i < point_count; ++i) {
+        segment.p0[0] = points[i - 1][0];
+        segment.p0[1] = points[i - 1][1];
+        segment.p1[0] = points[i][0];
+        segment.p1[1] = points[i][1];
+        vk_push_shape(context, &segment);
+    }
+}
+
+internal f32 vk_item_depth(Vk_Draw_Item *item) {
+    return vk_layer_depth(item->layer, item->depth, item->ui);
+}
+
+internal f32 vk_layer_depth(u8 layer, f32 depth, b8 ui) {
+    // Stays short of the next layer's slice, so layers never tie.
+    f32 z = (255 - layer + CLAMP(0.0f, depth, 1.0f) * 0.99f) / 256.0f;
+    return ui ? z * 0.5f : 0.5f + z * 0.5f;
+}
+
+internal void vk_count_unsorted_state_changes(Vk_Context *context, Sort_Entry *entries, u32 count, Vk_Submit_Stats *stats) {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    Vk_Mesh *mesh = NULL;
+    Vk_Texture *texture = NULL;
+    for (u32 i = 0; i < count; ++i) {
+        Vk_Draw_Item *item = &context->frame_items[entries[i].value];
+        VkPipeline item_pipeline = vk_resolve_pipeline(context, vk_item_pipeline(context, item));
+        if (item_pipeline != pipeline) stats->pipeline_binds++;
+        if (item->mesh != mesh) stats->mesh_binds++;
+        if (item->texture != texture) stats->descriptor_binds++;
+        pipeline = item_pipeline;
+        mesh = item->mesh;
+        texture = item->texture;
+    }
+    stats->draw_calls += count;
+}
+
+internal void vk_cmd_bind_instances(VkCommandBuffer command_buffer, Vk_Bind_State *bound, VkBuffer buffer) {
+    if (buffer == bound->instance_buffer) return;
+
+    u32 instance_binding = 1;
+    VkDeviceSize instance_offset = 0;
+    vkCmdBindVertexBuffers(command_buffer, instance_binding, 1, &buffer, &instance_offset);
+    bound->instance_buffer = buffer;
+}
+
+internal void vk_cmd_bind_texture(Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound, u32 slot) {
+    if (context->texture_binding != VK_TEXTURE_BINDING_PER_DRAW || slot == bound->texture) return;
+
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipeline_layout,
+        0, 1, &context->texture_sets[slot], 0, NULL);
+    bound->texture = slot;
+    context->stats.submit.descriptor_binds++;
+}
+
+internal void vk_cmd_draw_sprites(
+    Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound,
+    Vk_Pipeline_Id pipeline_id, Vk_Mesh *mesh, u32 first_instance, u32 instance_count) {
+    Vk_Submit_Stats *stats = &context->stats.submit;
+
+    // Variants still being built share their fallback's bind.
+    VkPipeline pipeline = vk_resolve_pipeline(context, pipeline_id);
+    if (pipeline != bound->pipeline) {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        bound->pipeline = pipeline;
+        stats->pipeline_binds++;
+    }
+
+    if (mesh != bound->mesh) {
+        u32 first_binding = 0;
+        VkBuffer buffers[] = {mesh->vertex_buffer};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(command_buffer, first_binding, ARRAY_COUNT(buffers), buffers, offsets);
+        vkCmdBindIndexBuffer(command_buffer, mesh->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        bound->mesh = mesh;
+        stats->mesh_binds++;
+    }
+
+    vkCmdDrawIndexed(command_buffer, mesh->index_count, instance_count, 0, 0, first_instance);
+    stats->draw_calls++;
+}
+
+internal void vk_record_command_buffer(Vk_Context *context, u32 image_index, Vk_Draw_Item *items, u32 item_count) {
+    VkCommandBufferBeginInfo cmd_begin_info{};
+    cmd_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmd_begin_info.flags = 0; // optional
+    cmd_begin_info.pInheritanceInfo = NULL; // optional, only relevant for secondary command buffers
+    VK_CHECK(vkBeginCommandBuffer(context->command_buffer, &cmd_begin_info));
+
+    context->frame_image_index = image_index;
+    context->frame_items = items;
+    context->frame_item_count = item_count;
+    context->instance_count = 0;
+    context->shape_instance_count = 0;
+
+    // The GPU counters were just read back for the previous frame.
+    Vk_Frame_Stats *stats = &context->stats;
+    Vk_Gpu_Stats gpu = stats->gpu;
+    *stats = {};
+    stats->gpu = gpu;
+    stats->frame_index = context->frame_index++;
+    stats->item_count = item_count;
+    stats->upload_bytes = context->pending_upload_bytes;
+    context->pending_upload_bytes = 0;
+    graph_set_image(
+        context->graph, context->backbuffer,
+        context->swapchain_images[image_index], context->swapchain_image_views[image_index]);
+
+    if (context->scene) scene_cmd_upload(context->scene, context, context->command_buffer);
+
+    vk_cmd_begin_timestamps(context, context->command_buffer);
+    if (context->has_pipeline_statistics) vkCmdResetQueryPool(context->command_buffer, context->statistics_pool, 0, 1);
+    graph_execute(context->graph, context->command_buffer);
+    vk_cmd_end_timestamps(context, context->command_buffer);
+    context->shape_count = 0;
+
+    VK_CHECK(vkEndCommandBuffer(context->command_buffer));
 }
 
 u32 vk_find_memory_type(VkPhysicalDeviceMemoryProperties mem_properties, u32 type_filter, VkMemoryPropertyFlags properties) {
@@ -943,6 +3088,551 @@ u32 vk_find_memory_type(VkPhysicalDeviceMemoryProperties mem_properties, u32 typ
     LOG_FATAL("Failed to find memory type!");
 }
 
+// Memory
+// -----------------------------------------------------------------------------
+
+internal void vk_init_host_allocator(Vk_Host_Allocator *allocator) {
+    allocator->callbacks.pUserData = allocator;
+    allocator->callbacks.pfnAllocation = vk_host_allocation_callback;
+    allocator->callbacks.pfnReallocation = vk_host_reallocation_callback;
+    allocator->callbacks.pfnFree = vk_host_free_callback;
+    allocator->callbacks.pfnInternalAllocation = vk_host_internal_allocation_callback;
+    allocator->callbacks.pfnInternalFree = vk_host_internal_free_callback;
+}
+
+internal void vk_cleanup_host_allocator(Vk_Host_Allocator *allocator) {
+    if (allocator->total_bytes.load() != 0) {
+        LOG_WARNING("%llu host bytes still allocated by Vulkan", (unsigned long long)allocator->total_bytes.load());
+    }
+
+    for (u32 c = 0; c < VK_HOST_SIZE_CLASS_COUNT; ++c) {
+        Vk_Host_Pool *pool = &allocator->pools[c];
+        while (pool->chunks != NULL) {
+            u8 *next = *(u8 **)pool->chunks;
+            free(pool->chunks);
+            pool->chunks = next;
+        }
+        pool->free_slots = NULL;
+    }
+}
+
+internal void *vk_host_allocate(Vk_Host_Allocator *allocator, u64 size, u64 alignment, u32 scope) {
+    // The header sits right before the returned pointer, so that has to be
+    // aligned for it too.
+    alignment = MAX(alignment, 16);
+    u64 header_offset = ALIGN_UP(sizeof(Vk_Host_Header), alignment);
+    u64 total = header_offset + size;
+    scope = MIN(scope, VK_HOST_SCOPE_COUNT - 1);
+
+    u32 size_class = VK_HOST_SIZE_CLASS_COUNT;
+    if (alignment <= VK_HOST_MAX_ALIGNMENT) {
+        for (u32 c = 0; c < VK_HOST_SIZE_CLASS_COUNT; ++c) {
+            if (total <= ((u64)VK_HOST_MIN_SIZE_CLASS << c)) {
+                size_class = c;
+                break;
+            }
+        }
+    }
+
+    u8 *memory;
+    void *base = NULL;
+    if (size_class < VK_HOST_SIZE_CLASS_COUNT) {
+        Vk_Host_Pool *pool = &allocator->pools[size_class];
+        u64 slot_size = (u64)VK_HOST_MIN_SIZE_CLASS << size_class;
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (pool->free_slots == NULL) {
+            // The link to the previous chunk goes in front of the first slot.
+            u8 *chunk = (u8 *)malloc(VK_HOST_CHUNK_SIZE + VK_HOST_MAX_ALIGNMENT);
+            if (chunk == NULL) return NULL;
+            *(u8 **)chunk = pool->chunks;
+            pool->chunks = chunk;
+            allocator->reserved_bytes += VK_HOST_CHUNK_SIZE + VK_HOST_MAX_ALIGNMENT;
+
+            u8 *slots = (u8 *)ALIGN_UP((u64)(chunk + sizeof(u8 *)), VK_HOST_MAX_ALIGNMENT);
+            u64 slot_count = VK_HOST_CHUNK_SIZE / slot_size;
+            for (u64 i = slot_count; i-- > 0;) {
+                u8 *slot = slots + i * slot_size;
+                *(void **)slot = pool->free_slots;
+                pool->free_slots = slot;
+            }
+        }
+
+        u8 *slot = (u8 *)pool->free_slots;
+        pool->free_slots = *(void **)slot;
+        memory = slot + header_offset;
+        allocator->pooled_count++;
+    } else {
+        base = malloc(total + alignment);
+        if (base == NULL) return NULL;
+        memory = (u8 *)ALIGN_UP((u64)((u8 *)base + sizeof(Vk_Host_Header)), alignment);
+    }
+
+    Vk_Host_Header *header = vk_host_header(memory);
+    header->base = base;
+    header->size = size;
+    header->size_class = size_class;
+    header->scope = scope;
+
+    allocator->bytes[scope] += size;
+    allocator->counts[scope]++;
+    allocator->allocation_count++;
+    u64 total_bytes = allocator->total_bytes += size;
+    u64 peak = allocator->peak_bytes.load();
+    while (total_bytes > peak && !allocator->peak_bytes.compare_exchange_weak(peak, total_bytes)) {}
+
+    return memory;
+}
+
+internal void vk_host_free(Vk_Host_Allocator *allocator, void *memory) {
+    if (memory == NULL) return;
+
+    Vk_Host_Header *header = vk_host_header(memory);
+    allocator->bytes[header->scope] -= header->size;
+    allocator->counts[header->scope]--;
+    allocator->total_bytes -= header->size;
+
+    if (header->size_class < VK_HOST_SIZE_CLASS_COUNT) {
+        // Back to the slot's start, which the pool always aligns to
+        // VK_HOST_MAX_ALIGNMENT.
+        u8 *slot = (u8 *)((u64)header & ~((u64)VK_HOST_MAX_ALIGNMENT - 1));
+        Vk_Host_Pool *pool = &allocator->pools[header->size_class];
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        *(void **)slot = pool->free_slots;
+        pool->free_slots = slot;
+    } else {
+        free(header->base);
+    }
+}
+
+internal Vk_Host_Header *vk_host_header(void *memory) {
+    return (Vk_Host_Header *)((u8 *)memory - sizeof(Vk_Host_Header));
+}
+
+internal VKAPI_ATTR void *VKAPI_CALL vk_host_allocation_callback(
+    void *user_data, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    return vk_host_allocate((Vk_Host_Allocator *)user_data, size, alignment, (u32)scope);
+}
+
+internal VKAPI_ATTR void *VKAPI_CALL vk_host_reallocation_callback(
+    void *user_data, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    auto allocator = (Vk_Host_Allocator *)user_data;
+    if (original == NULL) return vk_host_allocate(allocator, size, alignment, (u32)scope);
+    if (size == 0) {
+        vk_host_free(allocator, original);
+        return NULL;
+    }
+
+    void *memory = vk_host_allocate(allocator, size, alignment, (u32)scope);
+    if (memory == NULL) return NULL; // The original stays valid
+    memcpy(memory, original, MIN(size, vk_host_header(original)->size));
+    vk_host_free(allocator, original);
+    return memory;
+}
+
+internal VKAPI_ATTR void VKAPI_CALL vk_host_free_callback(void *user_data, void *memory) {
+    vk_host_free((Vk_Host_Allocator *)user_data, memory);
+}
+
+internal VKAPI_ATTR void VKAPI_CALL vk_host_internal_allocation_callback(
+    void *user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+    auto allocator = (Vk_Host_Allocator *)user_data;
+    allocator->internal_bytes[MIN((u32)scope, VK_HOST_SCOPE_COUNT - 1)] += size;
+}
+
+internal VKAPI_ATTR void VKAPI_CALL vk_host_internal_free_callback(
+    void *user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+    auto allocator = (Vk_Host_Allocator *)user_data;
+    allocator->internal_bytes[MIN((u32)scope, VK_HOST_SCOPE_COUNT - 1)] -= size;
+}
+
+internal void vk_init_memory_tracking(Vk_Context *context) {
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(context->physical_device, &properties);
+
+    context->memory_heap_count = properties.memoryHeapCount;
+    for (u32 i = 0; i < properties.memoryHeapCount; ++i) {
+        Vk_Memory_Heap_Stats *heap = &context->memory_heaps[i];
+        heap->size = properties.memoryHeaps[i].size;
+        heap->device_local = (properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heap->budget = heap->size;
+    }
+    for (u32 i = 0; i < properties.memoryTypeCount; ++i) {
+        context->memory_type_heaps[i] = properties.memoryTypes[i].heapIndex;
+    }
+
+    vk_read_memory_budget(context);
+}
+
+internal u32 vk_device_allocation_slot(VkDeviceMemory memory) {
+    return (u32)(((u64)memory * 0x9e3779b97f4a7c15ull) >> 32) & (VK_MAX_TRACKED_ALLOCATIONS - 1);
+}
+
+internal VkResult vk_allocate_memory(Vk_Context *context, const VkMemoryAllocateInfo *info, VkDeviceMemory *memory) {
+    VkResult result = vkAllocateMemory(context->device, info, context->allocator, memory);
+    if (result != VK_SUCCESS) {
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY) vk_log_memory_report(context);
+        return result;
+    }
+
+    u32 heap = context->memory_type_heaps[info->memoryTypeIndex];
+
+    std::lock_guard<std::mutex> lock(context->memory_mutex);
+    u32 slot = vk_device_allocation_slot(*memory);
+    for (u32 probes = 0; context->device_allocations[slot].memory != VK_NULL_HANDLE; ++probes) {
+        if (probes == VK_MAX_TRACKED_ALLOCATIONS) LOG_FATAL("Out of tracked device allocations");
+        slot = (slot + 1) & (VK_MAX_TRACKED_ALLOCATIONS - 1);
+    }
+
+    Vk_Device_Allocation *allocation = &context->device_allocations[slot];
+    allocation->memory = *memory;
+    allocation->size = info->allocationSize;
+    allocation->heap = heap;
+
+    context->memory_heaps[heap].allocated += info->allocationSize;
+    context->memory_heaps[heap].allocation_count++;
+
+    return result;
+}
+
+internal void vk_free_memory(Vk_Context *context, VkDeviceMemory memory) {
+    if (memory == VK_NULL_HANDLE) return;
+    vkFreeMemory(context->device, memory, context->allocator);
+
+    std::lock_guard<std::mutex> lock(context->memory_mutex);
+    const u32 mask = VK_MAX_TRACKED_ALLOCATIONS - 1;
+    u32 slot = vk_device_allocation_slot(memory);
+    for (u32 probes = 0; context->device_allocations[slot].memory != memory; ++probes) {
+        if (probes == VK_MAX_TRACKED_ALLOCATIONS || context->device_allocations[slot].memory == VK_NULL_HANDLE) {
+            LOG_WARNING("Freeing untracked device memory");
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    Vk_Device_Allocation *allocation = &context->device_allocations[slot];
+    context->memory_heaps[allocation->heap].allocated -= allocation->size;
+    context->memory_heaps[allocation->heap].allocation_count--;
+
+    // Backward shift: later entries of the same probe run move into the hole,
+    // so lookups never stop early at an empty slot.
+    u32 hole = slot;
+    for (u32 next = (hole + 1) & mask; context->device_allocations[next].memory != VK_NULL_HANDLE; next = (next + 1) & mask) {
+        u32 home = vk_device_allocation_slot(context->device_allocations[next].memory);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            context->device_allocations[hole] = context->device_allocations[next];
+            hole = next;
+        }
+    }
+    context->device_allocations[hole] = {};
+}
+
+internal void vk_read_memory_budget(Vk_Context *context) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    if (context->has_memory_budget) {
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budget;
+        vkGetPhysicalDeviceMemoryProperties2(context->physical_device, &properties);
+    }
+
+    std::lock_guard<std::mutex> lock(context->memory_mutex);
+    for (u32 i = 0; i < context->memory_heap_count; ++i) {
+        Vk_Memory_Heap_Stats *heap = &context->memory_heaps[i];
+        if (context->has_memory_budget) {
+            heap->usage = budget.heapUsage[i];
+            heap->budget = budget.heapBudget[i];
+        } else {
+            heap->usage = heap->allocated;
+            heap->budget = heap->size;
+        }
+    }
+}
+
+internal void vk_update_memory_budget(Vk_Context *context) {
+    if (context->memory_budget_frame++ % VK_MEMORY_BUDGET_INTERVAL != 0) return;
+    vk_read_memory_budget(context);
+
+    for (u32 i = 0; i < context->memory_heap_count; ++i) {
+        Vk_Memory_Heap_Stats *heap = &context->memory_heaps[i];
+        u32 bit = 1u << i;
+        if (heap->usage < (u64)(heap->budget * VK_MEMORY_BUDGET_WARNING)) {
+            context->memory_budget_warned &= ~bit;
+            continue;
+        }
+        if (context->memory_budget_warned & bit) continue;
+        context->memory_budget_warned |= bit;
+
+        if (context->memory_warning) {
+            context->memory_warning(i, heap->usage, heap->budget, context->memory_warning_data);
+        } else {
+            LOG_WARNING("Memory heap %u at %.1f of %.1f MB budget",
+                i, heap->usage / (f64)MB(1), heap->budget / (f64)MB(1));
+        }
+    }
+}
+
+internal void vk_get_memory_stats(Vk_Context *context, Vk_Memory_Stats *stats) {
+    Vk_Host_Allocator *allocator = &context->host_allocator;
+    Vk_Host_Memory_Stats *host = &stats->host;
+    for (u32 s = 0; s < VK_HOST_SCOPE_COUNT; ++s) {
+        host->bytes[s] = allocator->bytes[s].load();
+        host->counts[s] = allocator->counts[s].load();
+        host->internal_bytes[s] = allocator->internal_bytes[s].load();
+    }
+    host->total_bytes = allocator->total_bytes.load();
+    host->peak_bytes = allocator->peak_bytes.load();
+    host->allocation_count = allocator->allocation_count.load();
+    host->pooled_count = allocator->pooled_count.load();
+    host->reserved_bytes = allocator->reserved_bytes.load();
+
+    std::lock_guard<std::mutex> lock(context->memory_mutex);
+    stats->heap_count = context->memory_heap_count;
+    for (u32 i = 0; i < context->memory_heap_count; ++i) stats->heaps[i] = context->memory_heaps[i];
+    stats->has_budget = context->has_memory_budget;
+}
+
+internal void vk_log_memory_report(Vk_Context *context) {
+    Vk_Memory_Stats stats;
+    vk_get_memory_stats(context, &stats);
+
+    local_persist const char *scope_names[VK_HOST_SCOPE_COUNT] = {"command", "object", "cache", "device", "instance"};
+    Vk_Host_Memory_Stats *host = &stats.host;
+    LOG_INFO("Vulkan host memory: %.1f KB live, %.1f KB peak, %llu of %llu allocations pooled, %.1f KB in pool chunks",
+        host->total_bytes / (f64)KB(1), host->peak_bytes / (f64)KB(1),
+        (unsigned long long)host->pooled_count, (unsigned long long)host->allocation_count,
+        host->reserved_bytes / (f64)KB(1));
+    for (u32 s = 0; s < VK_HOST_SCOPE_COUNT; ++s) {
+        if (host->counts[s] == 0 && host->internal_bytes[s] == 0) continue;
+        LOG_INFO("  %-8s %10.1f KB in %llu allocations, %.1f KB internal", scope_names[s],
+            host->bytes[s] / (f64)KB(1), (unsigned long long)host->counts[s], host->internal_bytes[s] / (f64)KB(1));
+    }
+
+    LOG_INFO("Vulkan device memory (%s):", stats.has_budget ? "VK_EXT_memory_budget" : "tracked only");
+    for (u32 i = 0; i < stats.heap_count; ++i) {
+        Vk_Memory_Heap_Stats *heap = &stats.heaps[i];
+        LOG_INFO("  heap %u (%s): %.1f MB in %u allocations, %.1f MB used of %.1f MB budget, %.1f MB heap",
+            i, heap->device_local ? "device local" : "host", heap->allocated / (f64)MB(1), heap->allocation_count,
+            heap->usage / (f64)MB(1), heap->budget / (f64)MB(1), heap->size / (f64)MB(1));
+    }
+}
+
+// Capture
+// -----------------------------------------------------------------------------
+
+internal u32 vk_format_texel_size(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R5G6B5_UNORM_PACK16:
+        case VK_FORMAT_B5G6R5_UNORM_PACK16:
+            return 2;
+
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+        case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+            return 4;
+
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+
+        default:
+            return 0;
+    }
+}
+
+internal void vk_capture_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data) {
+    auto context = (Vk_Context *)user_data;
+    Vk_Capture *capture = &context->capture;
+    capture->recorded_slot = VK_CAPTURE_NONE;
+    if (context->capture_proc == NULL || !context->config.capture) return;
+
+    u32 texel_size = vk_format_texel_size(context->swapchain_image_format);
+    if (texel_size == 0) {
+        LOG_WARNING("Swapchain format %d has no known texel size, frame capture disabled",
+            context->swapchain_image_format);
+        context->config.capture = false;
+        return;
+    }
+
+    u64 frame_index = capture->frame_index++;
+    Vk_Capture_Slot *slot = &capture->slots[capture->record_slot];
+    if (slot->state.load(std::memory_order_acquire) != VK_CAPTURE_FREE) {
+        capture->dropped_count++;
+        return;
+    }
+
+    VkExtent2D extent = context->swapchain_extent;
+    VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * texel_size;
+    if (slot->size < size) {
+        // Free, so neither the GPU nor the consumer still uses the old one.
+        vk_cleanup_capture_slot(context, slot);
+        vk_create_capture_slot(context, slot, size);
+    }
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(
+        command_buffer, graph_resource(graph, context->backbuffer)->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        slot->buffer, 1, &region);
+
+    // The fence alone doesn't make the copy visible to the host.
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot->buffer;
+    barrier.size = size;
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, NULL, 1, &barrier, 0, NULL);
+
+    Vk_Capture_Frame *frame = &slot->frame;
+    frame->pixels = slot->mapped;
+    frame->width = extent.width;
+    frame->height = extent.height;
+    frame->row_pitch = extent.width * texel_size;
+    frame->format = context->swapchain_image_format;
+    frame->frame_index = frame_index;
+
+    slot->state.store(VK_CAPTURE_RECORDED, std::memory_order_relaxed);
+    capture->recorded_slot = capture->record_slot;
+    capture->record_slot = (capture->record_slot + 1) % VK_CAPTURE_RING_SIZE;
+}
+
+internal void vk_collect_capture(Vk_Context *context) {
+    Vk_Capture *capture = &context->capture;
+    if (capture->recorded_slot == VK_CAPTURE_NONE) return;
+
+    // Still the submitted frame's, the next one hasn't been submitted yet.
+    Vk_Capture_Slot *slot = &capture->slots[capture->recorded_slot];
+    slot->frame.submit_ns = context->frame_timing.submit_ns;
+    slot->state.store(VK_CAPTURE_READY);
+    capture->recorded_slot = VK_CAPTURE_NONE;
+
+    // A single consumer at a time keeps frames in order. A running one picks
+    // this slot up after its current one.
+    if (!capture->consuming.exchange(true)) {
+        job_submit(context->jobs, vk_capture_job, context, &capture->jobs);
+    }
+}
+
+internal void vk_capture_job(void *data) {
+    auto context = (Vk_Context *)data;
+    Vk_Capture *capture = &context->capture;
+
+    for (;;) {
+        Vk_Capture_Slot *slot = &capture->slots[capture->consume_slot];
+        if (slot->state.load() != VK_CAPTURE_READY) {
+            // Done, unless the slot became ready before consuming was cleared
+            // and no other job was started for it.
+            capture->consuming.store(false);
+            if (slot->state.load() != VK_CAPTURE_READY || capture->consuming.exchange(true)) return;
+            continue;
+        }
+        slot->state.store(VK_CAPTURE_CONSUMING, std::memory_order_relaxed);
+
+        if (!slot->coherent) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = slot->memory;
+            range.size = VK_WHOLE_SIZE;
+            VK_CHECK(vkInvalidateMappedMemoryRanges(context->device, 1, &range));
+        }
+
+        context->capture_proc(&slot->frame, context->capture_data);
+        capture->captured_count++;
+        capture->captured_bytes += (u64)slot->frame.row_pitch * slot->frame.height;
+
+        capture->consume_slot = (capture->consume_slot + 1) % VK_CAPTURE_RING_SIZE;
+        slot->state.store(VK_CAPTURE_FREE, std::memory_order_release);
+    }
+}
+
+internal void vk_create_capture_slot(Vk_Context *context, Vk_Capture_Slot *slot, VkDeviceSize size) {
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VK_CHECK(vkCreateBuffer(context->device, &buffer_info, context->allocator, &slot->buffer));
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, slot->buffer, "capture");
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(context->device, slot->buffer, &requirements);
+
+    VkPhysicalDeviceMemoryProperties mem_properties;
+    vkGetPhysicalDeviceMemoryProperties(context->physical_device, &mem_properties);
+
+    // Uncached reads are several times slower than cached ones, which is
+    // worth an invalidate per frame where the cached type isn't coherent.
+    VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    u32 type = UINT32_MAX;
+    for (u32 i = 0; i < mem_properties.memoryTypeCount && type == UINT32_MAX; ++i) {
+        if ((requirements.memoryTypeBits & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & cached) == cached) {
+            type = i;
+        }
+    }
+    if (type == UINT32_MAX) {
+        type = vk_find_memory_type(
+            mem_properties, requirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        LOG_WARNING("No host-cached memory for frame capture, reading uncached");
+    }
+    slot->coherent = (mem_properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = requirements.size;
+    alloc_info.memoryTypeIndex = type;
+    VK_CHECK(vk_allocate_memory(context, &alloc_info, &slot->memory));
+    VK_CHECK(vkBindBufferMemory(context->device, slot->buffer, slot->memory, 0));
+
+    void *mapped;
+    VK_CHECK(vkMapMemory(context->device, slot->memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+    slot->mapped = (u8 *)mapped;
+    slot->size = size;
+}
+
+internal void vk_cleanup_capture_slot(Vk_Context *context, Vk_Capture_Slot *slot) {
+    if (slot->buffer == VK_NULL_HANDLE) return;
+
+    vkUnmapMemory(context->device, slot->memory);
+    vkDestroyBuffer(context->device, slot->buffer, context->allocator);
+    vk_free_memory(context, slot->memory);
+    slot->buffer = VK_NULL_HANDLE;
+    slot->memory = VK_NULL_HANDLE;
+    slot->mapped = NULL;
+    slot->size = 0;
+}
+
+internal void vk_cleanup_capture(Vk_Context *context) {
+    Vk_Capture *capture = &context->capture;
+    job_wait(context->jobs, &capture->jobs);
+
+    for (u32 i = 0; i < VK_CAPTURE_RING_SIZE; ++i) {
+        vk_cleanup_capture_slot(context, &capture->slots[i]);
+    }
+}
+
+internal void vk_get_capture_stats(Vk_Context *context, Vk_Capture_Stats *stats) {
+    stats->captured_count = context->capture.captured_count.load();
+    stats->dropped_count = context->capture.dropped_count.load();
+    stats->captured_bytes = context->capture.captured_bytes.load();
+}
+
 internal void vk_create_buffer(
     Vk_Context *context, VkDeviceSize size,
     VkBufferUsageFlags usage, VkBuffer *buffer,
@@ -967,12 +3657,12 @@ internal void vk_create_buffer(
     alloc_info.allocationSize = mem_requirements.size;
     alloc_info.memoryTypeIndex = vk_find_memory_type(mem_properties, mem_requirements.memoryTypeBits, properties);
 
-    VK_CHECK(vkAllocateMemory(context->device, &alloc_info, context->allocator, buffer_memory));
+    VK_CHECK(vk_allocate_memory(context, &alloc_info, buffer_memory));
 
     VK_CHECK(vkBindBufferMemory(context->device, *buffer, *buffer_memory, 0));
 }
 
-internal void vk_copy_buffer(Vk_Context *context, VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size) {
+internal VkCommandBuffer vk_begin_one_time_commands(Vk_Context *context) {
     VkCommandBufferAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -981,20 +3671,17 @@ internal void vk_copy_buffer(Vk_Context *context, VkBuffer src_buffer, VkBuffer
 
     VkCommandBuffer command_buffer;
     VK_CHECK(vkAllocateCommandBuffers(context->device, &alloc_info, &command_buffer));
-    
+
     VkCommandBufferBeginInfo begin_info{};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     VK_CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
 
-    VkBufferCopy copy_region{};
-    copy_region.srcOffset = 0;
-    copy_region.dstOffset = 0;
-    copy_region.size = size;
-
-    vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+    return command_buffer;
+}
 
+internal void vk_end_one_time_commands(Vk_Context *context, VkCommandBuffer command_buffer) {
     VK_CHECK(vkEndCommandBuffer(command_buffer));
 
     VkSubmitInfo submit_info{};
@@ -1016,3 +3703,217 @@ internal void vk_copy_buffer(Vk_Context *context, VkBuffer src_buffer, VkBuffer
     vkDestroyFence(context->device, fence, context->allocator);
     vkFreeCommandBuffers(context->device, context->command_pool, 1, &command_buffer);
 }
+
+internal void vk_copy_buffer(
+    Vk_Context *context, VkBuffer src_buffer, VkDeviceSize src_offset, VkBuffer dst_buffer, VkDeviceSize size) {
+    VkCommandBuffer command_buffer = vk_begin_one_time_commands(context);
+
+    VkBufferCopy copy_region{};
+    copy_region.srcOffset = src_offset;
+    copy_region.dstOffset = 0;
+    copy_region.size = size;
+
+    vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+
+    vk_end_one_time_commands(context, command_buffer);
+}
+
+internal void vk_create_staging_buffer(Vk_Context *context, VkDeviceSize size, Vk_Staging_Buffer *staging) {
+    vk_create_buffer(
+        context, size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &staging->buffer,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging->memory);
+
+    void *mapped;
+    VK_CHECK(vkMapMemory(context->device, staging->memory, 0, size, 0, &mapped));
+
+    staging->mapped = (u8 *)mapped;
+    staging->size = size;
+    staging->offset = 0;
+}
+
+internal void vk_cleanup_staging_buffer(Vk_Context *context, Vk_Staging_Buffer *staging) {
+    vkUnmapMemory(context->device, staging->memory);
+    vkDestroyBuffer(context->device, staging->buffer, context->allocator);
+    vk_free_memory(context, staging->memory);
+    *staging = {};
+}
+
+internal u8 *vk_staging_push(
+    Vk_Staging_Buffer *staging, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset) {
+    VkDeviceSize aligned = ALIGN_UP(staging->offset, alignment);
+    if (aligned + size > staging->size) return NULL;
+
+    staging->offset = aligned + size;
+    *offset = aligned;
+    return staging->mapped + aligned;
+}
+
+internal void vk_staging_reset(Vk_Staging_Buffer *staging) {
+    staging->offset = 0;
+}
+
+internal void vk_create_texture(Vk_Context *context, u32 width, u32 height, Vk_Texture *texture) {
+    *texture = {};
+    texture->width = width;
+    texture->height = height;
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_SRGB;
+    image_info.extent.width = width;
+    image_info.extent.height = height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VK_CHECK(vkCreateImage(context->device, &image_info, context->allocator, &texture->image));
+
+    VkMemoryRequirements mem_requirements;
+    vkGetImageMemoryRequirements(context->device, texture->image, &mem_requirements);
+
+    VkPhysicalDeviceMemoryProperties mem_properties;
+    vkGetPhysicalDeviceMemoryProperties(context->physical_device, &mem_properties);
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = mem_requirements.size;
+    alloc_info.memoryTypeIndex = vk_find_memory_type(
+        mem_properties, mem_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VK_CHECK(vk_allocate_memory(context, &alloc_info, &texture->memory));
+    VK_CHECK(vkBindImageMemory(context->device, texture->image, texture->memory, 0));
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = texture->image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = image_info.format;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    VK_CHECK(vkCreateImageView(context->device, &view_info, context->allocator, &texture->view));
+
+    // Sampled from the next frame on, once the write is flushed.
+    texture->index = vk_allocate_texture_slot(context);
+    vk_write_texture_slot(context, texture->index, texture->view);
+}
+
+internal void vk_cleanup_texture(Vk_Context *context, Vk_Texture *texture) {
+    vk_free_texture_slot(context, texture->index);
+    vkDestroyImageView(context->device, texture->view, context->allocator);
+    vkDestroyImage(context->device, texture->image, context->allocator);
+    vk_free_memory(context, texture->memory);
+    *texture = {};
+}
+
+internal void vk_cmd_upload_texture(
+    VkCommandBuffer command_buffer, VkBuffer src_buffer, VkDeviceSize src_offset, Vk_Texture *texture) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture->image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, NULL, 0, NULL, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = src_offset;
+    region.bufferRowLength = 0; // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = texture->width;
+    region.imageExtent.height = texture->height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(
+        command_buffer, src_buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, NULL, 0, NULL, 1, &barrier);
+}
+
+internal void vk_create_mesh(Vk_Context *context, u32 vertex_count, u32 index_count, Vk_Mesh *mesh) {
+    *mesh = {};
+    mesh->vertex_count = vertex_count;
+    mesh->index_count = index_count;
+
+    vk_create_buffer(
+        context, vertex_count * sizeof(Vk_Vertex),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &mesh->vertex_buffer,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mesh->vertex_buffer_memory);
+
+    vk_create_buffer(
+        context, index_count * sizeof(u32),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &mesh->index_buffer,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mesh->index_buffer_memory);
+}
+
+internal void vk_cleanup_mesh(Vk_Context *context, Vk_Mesh *mesh) {
+    vkDestroyBuffer(context->device, mesh->vertex_buffer, context->allocator);
+    vk_free_memory(context, mesh->vertex_buffer_memory);
+
+    vkDestroyBuffer(context->device, mesh->index_buffer, context->allocator);
+    vk_free_memory(context, mesh->index_buffer_memory);
+    *mesh = {};
+}
+
+internal void vk_compute_mesh_extent(const Vk_Vertex *vertices, u32 vertex_count, f32 extent[2]) {
+    extent[0] = 0.0f;
+    extent[1] = 0.0f;
+    for (u32 i = 0; i < vertex_count; ++i) {
+        extent[0] = MAX(extent[0], fabsf(vertices[i].position[0]));
+        extent[1] = MAX(extent[1], fabsf(vertices[i].position[1]));
+    }
+}
+
+internal void vk_cmd_upload_mesh(
+    VkCommandBuffer command_buffer, VkBuffer src_buffer,
+    VkDeviceSize vertex_offset, VkDeviceSize index_offset, Vk_Mesh *mesh) {
+    VkBufferCopy vertex_region{};
+    vertex_region.srcOffset = vertex_offset;
+    vertex_region.dstOffset = 0;
+    vertex_region.size = mesh->vertex_count * sizeof(Vk_Vertex);
+    vkCmdCopyBuffer(command_buffer, src_buffer, mesh->vertex_buffer, 1, &vertex_region);
+
+    VkBufferCopy index_region{};
+    index_region.srcOffset = index_offset;
+    index_region.dstOffset = 0;
+    index_region.size = mesh->index_count * sizeof(u32);
+    vkCmdCopyBuffer(command_buffer, src_buffer, mesh->index_buffer, 1, &index_region);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+        1, &barrier, 0, NULL, 0, NULL);
+}
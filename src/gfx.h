@@ -2,7 +2,55 @@
 
 // -----------------------------------------------------------------------------
 
-#define VK_CHECK(v) ASSERT((v) == VK_SUCCESS)
+// Only negative codes are failures; positive ones (VK_SUBOPTIMAL_KHR,
+// VK_INCOMPLETE, ...) aren't. The reporting is left to an out-of-line call, and
+// debug builds also stop there. vk_draw_frame handles VK_ERROR_OUT_OF_DATE_KHR
+// itself.
+//
+// A failure during init exits, since nothing created so far has a fallback.
+// From the first frame on, the first failure is recorded instead: the call
+// returns as usual, vk_draw_frame stops submitting, and the frame loop sees
+// vk_failed and shuts down.
+#if BUILD_DEBUG
+#define VK_CHECK(v)                                                     \
+    do {                                                                \
+        VkResult vk_check_result_ = (v);                                \
+        if (vk_check_result_ < 0) {                                     \
+            vk_check_failed(vk_check_result_, #v, __FILE__, __LINE__);  \
+            ASSERT(false);                                              \
+        }                                                               \
+    } while (0)
+#else
+#define VK_CHECK(v)                                                     \
+    do {                                                                \
+        VkResult vk_check_result_ = (v);                                \
+        if (vk_check_result_ < 0) {                                     \
+            vk_check_failed(vk_check_result_, #v, __FILE__, __LINE__);  \
+        }                                                               \
+    } while (0)
+#endif
+
+// Object names show up in validation messages and in capture tools. They cost
+// nothing in release builds, where the arguments aren't even evaluated.
+#if BUILD_DEBUG
+#define VK_NAME(context, type, handle, name) vk_set_object_name(context, type, (u64)(handle), name)
+#else
+#define VK_NAME(context, type, handle, name) ((void)0)
+#endif
+
+internal const char *vk_result_name(VkResult result);
+internal void vk_check_failed(VkResult result, const char *call, const char *file, s32 line);
+internal b8 vk_failed();
+
+struct Vk_Error {
+    std::atomic<s32> result; // First failed VkResult, VK_SUCCESS until then
+    const char *call;
+    const char *file;
+    s32 line;
+    std::atomic<b8> recoverable;
+};
+
+global Vk_Error vk_error;
 
 struct Vk_Queue_Family_Indices {
     u32 graphics_family;
@@ -19,38 +67,593 @@ struct Vk_Swapchain_Support_Info {
     VkPresentModeKHR *present_modes;
 };
 
+struct Vk_Embedded_Shader {
+    const char *name;
+    const u32 *code;
+    u64 size;
+};
+
+// Host-visible buffer that stays mapped for the lifetime of the context, so
+// uploads are a memcpy (or a decompress) straight into `mapped`.
+struct Vk_Staging_Buffer {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    u8 *mapped;
+    VkDeviceSize size;
+    VkDeviceSize offset;
+};
+
 struct Vk_Vertex {
     f32 position[2];
     f32 tex_coord[2];
 };
 
+// RGBA8 sRGB image, sampled through its slot in the context's texture array.
+struct Vk_Texture {
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+    u32 index;
+    u32 width;
+    u32 height;
+};
+
+struct Vk_Mesh {
+    VkBuffer vertex_buffer;
+    VkDeviceMemory vertex_buffer_memory;
+    u32 vertex_count;
+
+    VkBuffer index_buffer;
+    VkDeviceMemory index_buffer_memory;
+    u32 index_count;
+
+    // Half size of a box around the origin that holds every vertex, used to
+    // cull instances against the camera.
+    f32 extent[2];
+};
+
+// Per-instance vertex data, matches the instance inputs in quad.vert.glsl.
+struct Vk_Sprite_Instance {
+    f32 offset[2];
+    f32 scale[2];
+    u32 texture_index;
+    f32 depth; // Clip-space z, see vk_item_depth
+};
+
+// Shapes are drawn analytically: each one is a quad around its bounds whose
+// fragment shader evaluates the shape's signed distance, so edges are
+// antialiased at any zoom without tessellation.
+enum Vk_Shape_Kind : u32 {
+    VK_SHAPE_CIRCLE,
+    VK_SHAPE_RECT,
+    VK_SHAPE_SEGMENT, // A capsule, so polyline joins are round
+};
+
+struct Vk_Shape {
+    Vk_Shape_Kind kind;
+    u32 color;   // RGBA8 with R in the low byte, straight alpha
+    f32 p0[2];   // Center, or the segment's start
+    f32 p1[2];   // Rect half extents, or the segment's end
+    f32 radius;  // Circle radius, rect corner radius, segment half width
+    f32 stroke;  // Outline width centered on the edge, 0 to fill
+    u8 layer;
+    b8 ui;       // In clip space, like UI items
+};
+
+// Per-instance vertex data, matches the inputs in shape.vert.glsl.
+struct Vk_Shape_Instance {
+    f32 p0[2];
+    f32 p1[2];
+    f32 radius;
+    f32 stroke;
+    u32 color;
+    u32 kind;
+    f32 depth;
+};
+
+// Orthographic 2D camera. World space has y pointing down like clip space;
+// at zoom 1 the view spans [-1, 1] vertically and the width follows the
+// aspect ratio.
+struct Vk_Camera {
+    f32 position[2]; // World-space center of the view
+    f32 zoom;
+    f32 rotation;    // Radians
+};
+
+// World-space axis-aligned box.
+struct Vk_Bounds {
+    f32 min[2];
+    f32 max[2];
+};
+
+// Matches the push_constant blocks in quad.vert.glsl and shape.vert.glsl.
+struct Vk_Push_Constants {
+    f32 view_projection[16]; // Column-major
+    f32 viewport_size[2];    // In pixels, for antialiasing shapes
+};
+
+// Called once the frame has waited for the GPU and acquired its image, right
+// before recording and submit, so camera input is sampled as late as possible.
+typedef void Vk_Camera_Latch_Proc(Vk_Camera *camera, void *user_data);
+
+typedef u32 Vk_Pipeline_Id; // From vk_request_pipeline, 0 is none
+
+struct Vk_Draw_Item {
+    Vk_Mesh *mesh;
+    Vk_Texture *texture;
+
+    // 0 draws with the default for translucent. Blended variants should be
+    // marked translucent too, so they're sorted back to front.
+    Vk_Pipeline_Id pipeline;
+
+    f32 offset[2];
+    f32 scale[2];
+
+    u8 layer;       // Higher layers draw on top of lower ones
+    b8 translucent; // Alpha blended, drawn back to front within its layer
+    f32 depth;      // Within the layer, 0 is nearest and 1 farthest
+
+    // Drawn after the scene at native resolution, in clip space without the
+    // camera.
+    b8 ui;
+};
+
+// Items are drawn in the order of 64-bit sort keys, most significant first:
+//   opaque:      layer:8 | 0:1 | pipeline:8 | texture:16 | depth:31
+//   translucent: layer:8 | 1:1 | far-to-near depth:31 | pipeline:8 | texture:16
+// Opaque items only need grouping by state. Translucent ones have to stay
+// back to front, so their depth goes before the state. Without a depth buffer
+// nothing rejects what's covered, so opaque items use the translucent layout
+// too and overlap within a layer resolves back to front.
+//
+// With a depth buffer the top nine bits become
+//   opaque:      0:1 | 255 - layer:8
+//   translucent: 1:1 | layer:8
+// so every opaque item goes first, nearest layer first, and early depth
+// testing rejects what they cover. Translucent items follow back to front,
+// tested against the opaque depth but not writing it.
+#define VK_SORT_DEPTH_BITS 31
+
+// Set in a Sort_Entry value when it's a retained scene batch rather than an
+// index into the frame's items.
+#define VK_SORT_SCENE_BATCH 0x80000000u
+
+// Fragment shaders. Each vertex format has its own vertex shader.
+enum Vk_Shader_Kind : u8 {
+    VK_SHADER_SPRITE,
+    VK_SHADER_HEATMAP, // Fixed color per fragment, for overdraw heatmaps
+    VK_SHADER_SHAPE,
+    VK_SHADER_COUNT,
+};
+
+enum Vk_Blend_Mode : u8 {
+    VK_BLEND_OPAQUE,
+    VK_BLEND_ALPHA,         // Straight alpha
+    VK_BLEND_PREMULTIPLIED,
+    VK_BLEND_ADDITIVE,
+    VK_BLEND_MULTIPLY,
+};
+
+// Ignored without a depth buffer.
+enum Vk_Depth_Mode : u8 {
+    VK_DEPTH_OFF,
+    VK_DEPTH_TEST,
+    VK_DEPTH_TEST_WRITE,
+};
+
+enum Vk_Vertex_Format : u8 {
+    VK_VERTEX_FORMAT_SPRITE, // Mesh vertices (Vk_Vertex) plus Vk_Sprite_Instance
+    VK_VERTEX_FORMAT_SHAPE,  // Vk_Shape_Instance only, corners from the vertex index
+    VK_VERTEX_FORMAT_COUNT,
+};
+
+// Pipeline variants are described by a few bytes of state that pack into a
+// u64 key. vk_request_pipeline looks the key up, creating the variant the
+// first time; draws then carry the returned id, so the hot path is an array
+// index rather than a hash.
+struct Vk_Pipeline_Desc {
+    u8 shader;        // Vk_Shader_Kind
+    u8 blend;         // Vk_Blend_Mode
+    u8 depth;         // Vk_Depth_Mode
+    u8 vertex_format; // Vk_Vertex_Format
+    u8 topology;      // VkPrimitiveTopology
+    b8 wireframe;     // Filled on devices without fillModeNonSolid
+    b8 cull_back;
+    u8 unused;
+};
+
+enum Vk_Pipeline_State : u32 {
+    VK_PIPELINE_STATE_PENDING,
+    VK_PIPELINE_STATE_READY,
+};
+
+struct Vk_Context;
+
+struct Vk_Pipeline_Variant {
+    Vk_Context *context; // For the build job
+    Vk_Pipeline_Desc desc;
+    u64 key;
+    Vk_Pipeline_Id fallback; // Drawn with until this one is ready
+    std::atomic<u32> state;  // Vk_Pipeline_State
+    VkPipeline pipeline;
+};
+
+// Variants created at init, which every other one falls back to. The heatmap
+// ones replace the rest in overdraw heatmap mode: they add a fixed color per
+// fragment, so the image goes from black through red and yellow to white as
+// more layers are shaded.
+enum Vk_Pipeline_Kind : u32 {
+    VK_PIPELINE_OPAQUE,
+    VK_PIPELINE_TRANSLUCENT,
+    VK_PIPELINE_HEATMAP_OPAQUE,
+    VK_PIPELINE_HEATMAP_TRANSLUCENT,
+    VK_PIPELINE_COUNT,
+};
+
+struct Vk_Submit_Stats {
+    u32 pipeline_binds;
+    u32 descriptor_binds;
+    u32 mesh_binds;
+    u32 draw_calls;
+};
+
+// GPU counters are read once the frame's fence has signaled, so they describe
+// the frame before the one the CPU counters do. The invocation counts need
+// the pipelineStatisticsQuery feature and cover the scene pass; all of these
+// stay 0 where unsupported.
+struct Vk_Gpu_Stats {
+    f32 frame_ms; // Needs GPU timestamps
+    u64 vertex_invocations;
+    u64 fragment_invocations;
+    f32 overdraw_shaded; // Fragment invocations per scene pixel
+};
+
+// Counters of one frame, gathered while recording it and valid until the
+// next vk_draw_frame. Meant for logs as well as automated perf tests.
+struct Vk_Frame_Stats {
+    u64 frame_index;
+    u32 item_count;
+    u32 visible_count;
+    u32 culled_count;
+    u32 instance_count;
+    u32 shape_count; // Drawn, after culling
+    u32 scene_count; // Retained sprites drawn
+
+    // Retained sprites uploaded this frame; only what changed.
+    u64 scene_upload_bytes;
+    u32 scene_copy_regions;
+
+    // "Submit" is what was recorded after sorting and batching. "Unsorted" is
+    // what drawing the visible items in submission order would cost, one draw
+    // each and a bind whenever consecutive items differ (a descriptor set per
+    // texture, as before bindless).
+    Vk_Submit_Stats submit;
+    Vk_Submit_Stats unsorted;
+
+    u64 instance_bytes; // Written to the instance buffer
+    u64 upload_bytes;   // Streamed through staging since the last frame
+    u64 sort_ns;
+
+    // Summed screen area of the scene pass's visible items over its pixels,
+    // which is what painter's order shades. Compare with gpu.overdraw_shaded.
+    f32 overdraw_covered;
+
+    Vk_Gpu_Stats gpu;
+};
+
+// What a pass has bound, so binds are only recorded on changes.
+struct Vk_Bind_State {
+    VkPipeline pipeline;
+    Vk_Mesh *mesh;
+    VkBuffer instance_buffer; // Per-frame instances or a retained scene's
+    u32 texture;              // Slot whose set is bound, per-draw binding only
+};
+
+enum Vk_Present_Policy : u32 {
+    VK_PRESENT_POLICY_LOW_LATENCY,  // mailbox, else immediate
+    VK_PRESENT_POLICY_POWER_SAVING, // fifo
+    VK_PRESENT_POLICY_ADAPTIVE,     // fifo relaxed, tears only when a frame is late
+    VK_PRESENT_POLICY_CAPPED,       // mailbox, else fifo; the app's fps_cap sets the pace
+};
+
+struct Vk_Config {
+    // Forces a GPU by index, UUID or case-insensitive name substring, as
+    // listed in the startup log. Empty picks the best scoring device.
+    char device_selector[256];
+
+    Vk_Present_Policy present_policy;
+    f32 fps_cap; // The app paces frames to this rate, 0 for no limit
+
+    b8 force_render_pass; // Skip dynamic rendering even where it's supported
+
+    // The scene renders at a fraction of the swapchain extent, adjusted
+    // between the two scales to keep GPU time under the target.
+    b8 dynamic_resolution;
+    f32 min_render_scale;
+    f32 max_render_scale;
+    f32 gpu_target_ms;
+
+    b8 depth_buffer;
+    b8 async_pipelines;
+
+    // No window or surface: frames render into an offscreen image of
+    // headless_extent that stands in for the swapchain and is never presented.
+    // vk_init_end then takes a NULL window.
+    b8 headless;
+    VkExtent2D headless_extent;
+
+    // Instance extensions the window system's surfaces need, as listed by
+    // glfwGetRequiredInstanceExtensions. Left out of headless instances.
+    const char **surface_extensions;
+    u32 surface_extension_count;
+
+    // Copy every finished frame out for Vk_Context::capture_proc, see
+    // Vk_Capture.
+    b8 capture;
+};
+
+// Color format of the headless backbuffer, the one surfaces are asked for.
+#define VK_HEADLESS_FORMAT VK_FORMAT_B8G8R8A8_SRGB
+
+// Dynamic rendering needs no VkRenderPass or VkFramebuffer objects, so a
+// resize only recreates the swapchain. Render passes remain the fallback.
+enum Vk_Rendering_Path : u32 {
+    VK_RENDERING_PATH_RENDER_PASS,
+    VK_RENDERING_PATH_DYNAMIC_KHR,  // VK_KHR_dynamic_rendering
+    VK_RENDERING_PATH_DYNAMIC_CORE, // Vulkan 1.3
+};
+
+// With bindless textures the texture index travels with each instance, so
+// consecutive sprites sharing a mesh are one instanced draw whatever they
+// sample. Devices without descriptor indexing get a fixed-size array that is
+// only indexed with dynamically uniform values, so batches break per texture.
+// Devices that can't index sampler arrays dynamically at all get a set per
+// texture slot instead, bound before each draw.
+enum Vk_Texture_Binding : u32 {
+    VK_TEXTURE_BINDING_ARRAY,
+    VK_TEXTURE_BINDING_PER_DRAW,      // No shaderSampledImageArrayDynamicIndexing
+    VK_TEXTURE_BINDING_BINDLESS_EXT,  // VK_EXT_descriptor_indexing
+    VK_TEXTURE_BINDING_BINDLESS_CORE, // Vulkan 1.2
+};
+
+// CPU timestamps (time_now_ns) of the last vk_draw_frame. present_ns is when
+// vkQueuePresentKHR returned, the closest portable stand-in for scanout, or
+// when the submit returned if headless.
+// ready_ns is when the frame fence and the swapchain image were acquired, so
+// ready_ns - begin_ns is time spent blocked on the GPU or the display.
+struct Vk_Frame_Timing {
+    u64 begin_ns;
+    u64 ready_ns;
+    u64 submit_ns;
+    u64 present_ns;
+};
+
+// Needs blits from and to the swapchain format and GPU timestamps; when
+// either is missing the scene renders straight into the swapchain image.
+// The scene target is allocated at full size and only the scaled corner of it
+// is rendered, so a scale change costs nothing but a different blit.
+// Timestamps are written wherever supported, so the frame's GPU time is in
+// the stats even with dynamic resolution off.
+struct Vk_Resolution {
+    b8 enabled;
+    f32 scale;
+    f32 gpu_ms; // Smoothed
+
+    b8 has_timestamps;
+    VkQueryPool timestamp_pool; // Begin and end of the frame's commands
+    f32 timestamp_period;       // ns per tick
+    u64 timestamp_mask;
+    b8 timestamps_pending;
+};
+
+#define VK_RESOLUTION_SMOOTHING  0.1f  // Weight of the newest GPU time
+#define VK_RESOLUTION_HEADROOM   0.9f  // Fraction of the target to aim for
+#define VK_RESOLUTION_DEAD_ZONE  0.02f // Smaller scale changes are ignored
+
+// Host allocations of the loader and driver go through the context's
+// allocation callbacks. Small ones come from per size class free lists carved
+// out of VK_HOST_CHUNK_SIZE chunks, the rest from malloc. A header in front of
+// each allocation records its size and scope, since frees only get the
+// pointer. Chunks are kept until the context is destroyed.
+#define VK_HOST_SIZE_CLASS_COUNT 7 // 64 bytes to 4 KB, powers of two
+#define VK_HOST_MIN_SIZE_CLASS   64
+#define VK_HOST_MAX_ALIGNMENT    64 // Pooled; more goes to malloc
+#define VK_HOST_CHUNK_SIZE       KB(64)
+#define VK_HOST_SCOPE_COUNT      5 // VkSystemAllocationScope values
+
+struct Vk_Host_Header {
+    void *base;     // What malloc returned, NULL for pooled slots
+    u64 size;       // As requested
+    u32 size_class; // VK_HOST_SIZE_CLASS_COUNT when not pooled
+    u32 scope;
+};
+
+struct Vk_Host_Pool {
+    std::mutex mutex;
+    void *free_slots; // Each free slot starts with the next one's address
+    u8 *chunks;       // Each chunk starts with the next one's address
+};
+
+struct Vk_Host_Allocator {
+    VkAllocationCallbacks callbacks;
+    Vk_Host_Pool pools[VK_HOST_SIZE_CLASS_COUNT];
+
+    // Live, by VkSystemAllocationScope. The internal ones are what the driver
+    // allocated itself and only reported.
+    std::atomic<u64> bytes[VK_HOST_SCOPE_COUNT];
+    std::atomic<u64> counts[VK_HOST_SCOPE_COUNT];
+    std::atomic<u64> internal_bytes[VK_HOST_SCOPE_COUNT];
+    std::atomic<u64> total_bytes;
+    std::atomic<u64> peak_bytes;
+
+    std::atomic<u64> allocation_count; // Since startup
+    std::atomic<u64> pooled_count;
+    std::atomic<u64> reserved_bytes;   // Pool chunks
+};
+
+struct Vk_Host_Memory_Stats {
+    u64 bytes[VK_HOST_SCOPE_COUNT];
+    u64 counts[VK_HOST_SCOPE_COUNT];
+    u64 internal_bytes[VK_HOST_SCOPE_COUNT];
+    u64 total_bytes;
+    u64 peak_bytes;
+    u64 allocation_count;
+    u64 pooled_count;
+    u64 reserved_bytes;
+};
+
+// Device memory is tracked per heap by vk_allocate_memory and vk_free_memory,
+// and compared with VK_EXT_memory_budget's numbers where it's supported.
+#define VK_MAX_TRACKED_ALLOCATIONS 8192 // Power of two, twice the usual maxMemoryAllocationCount
+
+// Budgets are read this often, and the warning fires when a heap's usage
+// goes over this fraction of its budget.
+#define VK_MEMORY_BUDGET_INTERVAL 60 // Frames
+#define VK_MEMORY_BUDGET_WARNING  0.9f
+
+struct Vk_Device_Allocation {
+    VkDeviceMemory memory; // VK_NULL_HANDLE for an empty slot
+    VkDeviceSize size;
+    u32 heap;
+};
+
+struct Vk_Memory_Heap_Stats {
+    u64 size;
+    u64 allocated; // Through vk_allocate_memory
+    u32 allocation_count;
+    u64 usage;  // By the whole process with VK_EXT_memory_budget, else allocated
+    u64 budget; // VK_EXT_memory_budget's estimate, else the heap size
+    b8 device_local;
+};
+
+struct Vk_Memory_Stats {
+    Vk_Host_Memory_Stats host;
+    Vk_Memory_Heap_Stats heaps[VK_MAX_MEMORY_HEAPS];
+    u32 heap_count;
+    b8 has_budget;
+};
+
+// Called from vk_draw_frame when a heap first goes over
+// VK_MEMORY_BUDGET_WARNING of its budget. Without one, a warning is logged.
+typedef void Vk_Memory_Warning_Proc(u32 heap, u64 usage, u64 budget, void *user_data);
+
+// Frame capture copies the backbuffer at the end of each frame into a ring of
+// host-visible buffers, host-cached where the device has such memory, since
+// the CPU reads every byte. A slot is handed over once its frame's fence has
+// signaled, which vk_draw_frame sees at the start of the next frame, and is
+// consumed on a worker, in order and one at a time. Nothing waits on the GPU
+// for it: when the next slot is still queued or being consumed, the frame is
+// dropped instead.
+#define VK_CAPTURE_RING_SIZE 4
+#define VK_CAPTURE_NONE      UINT32_MAX
+
+enum Vk_Capture_State : u32 {
+    VK_CAPTURE_FREE,
+    VK_CAPTURE_RECORDED, // Copy recorded, the frame's fence hasn't been seen yet
+    VK_CAPTURE_READY,    // Copy complete, waiting for the consumer
+    VK_CAPTURE_CONSUMING,
+};
+
+struct Vk_Capture_Frame {
+    const u8 *pixels; // Only valid during the callback
+    u32 width;
+    u32 height;
+    u32 row_pitch; // Rows are tightly packed: width * vk_format_texel_size(format)
+    VkFormat format;
+    u64 frame_index; // Counts dropped frames too, so gaps show drops
+    u64 submit_ns;
+};
+
+// Runs on a worker. Slow consumers make later frames drop, never the
+// renderer wait.
+typedef void Vk_Capture_Proc(Vk_Capture_Frame *frame, void *user_data);
+
+struct Vk_Capture_Slot {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    u8 *mapped;
+    b8 coherent;
+    std::atomic<u32> state; // Vk_Capture_State
+    Vk_Capture_Frame frame;
+};
+
+struct Vk_Capture {
+    Vk_Capture_Slot slots[VK_CAPTURE_RING_SIZE];
+    u32 record_slot;   // Next slot to copy into
+    u32 consume_slot;  // Next slot the consumer reads, only touched by it
+    u32 recorded_slot; // Copied into this frame, VK_CAPTURE_NONE if dropped
+    u64 frame_index;
+
+    std::atomic<b8> consuming; // A consumer job is queued or running
+    Job_Counter jobs;
+
+    std::atomic<u64> captured_count;
+    std::atomic<u64> dropped_count;
+    std::atomic<u64> captured_bytes;
+};
+
+struct Vk_Capture_Stats {
+    u64 captured_count;
+    u64 dropped_count;
+    u64 captured_bytes;
+};
+
+struct Render_Graph;
+struct Scene;
+
 struct Vk_Context {
+    Vk_Config config;
+    Job_System *jobs;
+    Job_Counter init_jobs;
+
     VkInstance instance;
+    u32 instance_version;
     VkSurfaceKHR surface;
-    VkAllocationCallbacks *allocator;
-    VkDebugUtilsMessengerEXT debug_messenger;
+    GLFWwindow *window; // NULL when headless
+    VkAllocationCallbacks *allocator; // &host_allocator.callbacks
+    Vk_Host_Allocator host_allocator;
+    VkDebugUtilsMessengerEXT debug_messenger;   // Debug builds only
+    PFN_vkSetDebugUtilsObjectNameEXT set_object_name; // Debug builds only
 
     VkPhysicalDevice physical_device;
     VkDevice device;
     Vk_Swapchain_Support_Info swapchain_support;
     Vk_Queue_Family_Indices queue_family_support;
 
+    Vk_Rendering_Path rendering_path;
+    PFN_vkCmdBeginRenderingKHR cmd_begin_rendering;
+    PFN_vkCmdEndRenderingKHR cmd_end_rendering;
+
     VkQueue graphics_queue;
     VkQueue present_queue;
     VkQueue transfer_queue;
 
     VkSwapchainKHR swapchain;
+    VkPresentModeKHR present_mode;
     u32 swapchain_image_count;
     VkImage *swapchain_images;
     VkFormat swapchain_image_format;
     VkImageView *swapchain_image_views;
     VkExtent2D swapchain_extent;
+    VkDeviceMemory headless_memory; // Backs the only swapchain image when headless
 
     VkFramebuffer *framebuffers;
 
-    VkRenderPass render_pass;
+    VkRenderPass render_pass; // VK_NULL_HANDLE with dynamic rendering
     VkPipelineLayout pipeline_layout;
-    VkPipeline graphics_pipeline;
+    VkPipelineCache pipeline_cache;
+    VkShaderModule vert_shader_modules[VK_VERTEX_FORMAT_COUNT];
+    VkShaderModule frag_shader_modules[VK_SHADER_COUNT];
+    b8 has_wireframe;
+
+    // Ids index pipeline_variants from 1. The slots are an open-addressed
+    // table of ids by key.
+    Vk_Pipeline_Variant pipeline_variants[MAX_PIPELINE_VARIANTS];
+    u32 pipeline_variant_count;
+    Vk_Pipeline_Id pipeline_slots[MAX_PIPELINE_VARIANTS * 2];
+    Vk_Pipeline_Id default_pipelines[VK_PIPELINE_COUNT];
+    Job_Counter pipeline_jobs;
 
     VkCommandPool command_pool;
     VkCommandBuffer command_buffer;
@@ -59,38 +662,170 @@ struct Vk_Context {
     VkSemaphore render_finished_semaphore;
     VkFence in_flight_fence;
 
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_buffer_memory;
-    u32 vertex_count;
+    Vk_Frame_Timing frame_timing;
 
-    VkBuffer index_buffer;
-    VkDeviceMemory index_buffer_memory;
-    u32 index_count;
+    // The frame is recorded through the graph; the passes read what they
+    // draw from the frame_* fields.
+    Render_Graph *graph;
+    u32 backbuffer;
+    u32 scene_target; // The backbuffer itself without dynamic resolution
+    u32 frame_image_index;
+    Vk_Draw_Item *frame_items;
+    u32 frame_item_count;
+    u32 instance_count; // Written so far this frame, across passes
+    Scene *scene;       // Retained sprites, owned by the caller; may be NULL
+
+    Vk_Resolution resolution;
+
+    // A transient of the graph, cleared by every pass that draws items.
+    VkFormat depth_format; // VK_FORMAT_UNDEFINED without a depth buffer
+    u32 depth_target;
+
+    VkFramebuffer scene_framebuffer; // Render pass path only
+    VkRenderPass overlay_render_pass; // Loads instead of clearing, for the UI
+
+    Vk_Texture_Binding texture_binding;
+    u32 texture_capacity; // Slots in the texture array, at most MAX_TEXTURE_COUNT
+    VkDescriptorSetLayout texture_set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet texture_set;   // Unused with per-draw binding
+    VkDescriptorSet *texture_sets; // One per slot with per-draw binding, else NULL
+    VkSampler sampler;
+
+    // Slot writes are queued and applied once the frame fence has signaled,
+    // so the set never changes under a command buffer that is still pending.
+    VkImageView texture_views[MAX_TEXTURE_COUNT];
+    b8 texture_slot_dirty[MAX_TEXTURE_COUNT];
+    u32 dirty_texture_slots[MAX_TEXTURE_COUNT];
+    u32 dirty_texture_slot_count;
+    u32 free_texture_slots[MAX_TEXTURE_COUNT];
+    u32 free_texture_slot_count;
+    u32 texture_slot_count; // Slots handed out so far, freed ones included
+
+    // Host-visible and persistently mapped, rewritten every frame. Shape
+    // instances follow the sprite ones.
+    VkBuffer instance_buffer;
+    VkDeviceMemory instance_memory;
+    Vk_Sprite_Instance *instances;
+    Vk_Shape_Instance *shape_instances;
+    u32 shape_instance_count; // Written so far this frame, across passes
+
+    // Pushed since the last frame, drawn after the sprites of their pass.
+    Vk_Shape *shapes;
+    u32 shape_count;
+    Vk_Pipeline_Id shape_pipelines[2]; // Normal and heatmap
+
+    // Sort keys of the visible items and retained batches,
+    // MAX_SPRITE_INSTANCES + MAX_SCENE_BATCHES each.
+    Sort_Entry *sort_entries;
+    Sort_Entry *sort_scratch;
+
+    Vk_Frame_Stats stats;
+    u64 frame_index;
+    u64 pending_upload_bytes; // Moved into the stats when the next frame is recorded
+    b8 overdraw_heatmap;
+
+    // Over the scene pass, vertex and fragment shader invocations.
+    b8 has_pipeline_statistics;
+    VkQueryPool statistics_pool;
+    b8 statistics_pending;
+    f64 statistics_pixels; // Rendered by the scene pass
+
+    Vk_Camera camera;
+    Vk_Camera_Latch_Proc *camera_latch; // Optional
+    void *camera_latch_data;
+
+    Vk_Staging_Buffer staging;
+
+    // Open-addressed by handle, guarded by the mutex since textures and meshes
+    // can be created while a worker builds pipelines.
+    std::mutex memory_mutex;
+    Vk_Device_Allocation device_allocations[VK_MAX_TRACKED_ALLOCATIONS];
+    Vk_Memory_Heap_Stats memory_heaps[VK_MAX_MEMORY_HEAPS];
+    u32 memory_heap_count;
+    u32 memory_type_heaps[VK_MAX_MEMORY_TYPES];
+    b8 has_memory_budget;
+    u32 memory_budget_warned; // One bit per heap, cleared once back under
+    u32 memory_budget_frame;
+    Vk_Memory_Warning_Proc *memory_warning; // Optional
+    void *memory_warning_data;
+
+    Vk_Capture capture;
+    Vk_Capture_Proc *capture_proc; // Nothing is copied without one
+    void *capture_data;
+
+    // Bound in place of meshes and textures that aren't resident yet.
+    Vk_Mesh quad_mesh;
+    Vk_Texture placeholder_texture;
 };
 
-internal Vk_Context *vk_init(GLFWwindow *window);
+// Init is split in two so the instance is created on a worker while the
+// caller creates the window. Each phase is recorded in the startup profile.
+internal Vk_Context *vk_init_begin(Job_System *jobs, Vk_Config *config);
+internal void vk_init_end(Vk_Context *context, GLFWwindow *window);
 internal void vk_cleanup(Vk_Context *context);
 
-internal void vk_draw_frame(Vk_Context *context);
+internal void vk_draw_frame(Vk_Context *context, Vk_Draw_Item *items, u32 item_count);
+
+// Call after the framebuffer size changed (and isn't zero).
+internal void vk_recreate_swapchain(Vk_Context *context, GLFWwindow *window);
+// For an out of date or suboptimal swapchain. Left alone while the window is
+// minimized; the app recreates it from the framebuffer size callback.
+internal void vk_refresh_swapchain(Vk_Context *context);
+
+internal void vk_camera_view_projection(Vk_Camera *camera, VkExtent2D extent, f32 view_projection[16]);
+
+// Everything the camera can see, including the corners a rotation brings in.
+internal Vk_Bounds vk_camera_bounds(Vk_Camera *camera, VkExtent2D extent);
+
+// Converts a distance in pixels to world units at the camera's zoom and
+// rotation, y pointing down in both.
+internal void vk_camera_pixels_to_world(Vk_Camera *camera, VkExtent2D extent, f32 pixels[2], f32 world[2]);
 
 internal void vk_wait_idle(Vk_Context *context);
 
+// Queued for the next vk_draw_frame. Shapes are drawn after the sprites of
+// their pass in the order they were pushed, so they aren't sorted against
+// translucent sprites; depth testing still keeps them behind opaque sprites
+// of higher layers.
+internal void vk_push_shape(Vk_Context *context, Vk_Shape *shape);
+
+// One segment per pair of consecutive points, expanded into capsules on the
+// GPU.
+internal void vk_push_polyline(
+    Vk_Context *context, const f32 (*points)[2], u32 point_count, f32 width, u32 color, u8 layer, b8 ui);
+
+// One thread at a time: the init worker requests the defaults, and
+// vk_init_end waits for it before returning, so from then on it's the main
+// thread's. Cheap enough to call per frame, but callers should keep the id
+// rather than requesting it for every draw.
+internal Vk_Pipeline_Id vk_request_pipeline(Vk_Context *context, Vk_Pipeline_Desc *desc);
+
+// Counters of the last recorded frame.
+internal void vk_get_frame_stats(Vk_Context *context, Vk_Frame_Stats *stats);
+
+// Counted into the next frame's upload_bytes.
+internal void vk_count_upload(Vk_Context *context, u64 bytes);
+
+internal void vk_set_overdraw_heatmap(Vk_Context *context, b8 enabled);
+
+// The part of the scene target rendered this frame.
+internal VkExtent2D vk_scene_extent(Vk_Context *context);
+
 // -----------------------------------------------------------------------------
 
+#if BUILD_DEBUG
 global const char *vk_validation_layer_names[] = {
     "VK_LAYER_KHRONOS_validation",
 };
 
 internal b8 vk_check_validation_layer_support();
-
-global const char *vk_required_extension_names[] = {
-    VK_KHR_SURFACE_EXTENSION_NAME,
-    VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
-    "VK_KHR_win32_surface",
-};
+#endif
 
 internal void vk_create_instance(Vk_Context *context);
+internal void vk_create_instance_job(void *data);
 
+#if BUILD_DEBUG
 internal VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
     VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
     VkDebugUtilsMessageTypeFlagsEXT message_types,
@@ -118,35 +853,106 @@ internal VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
 }
 
 internal void vk_create_debug_messenger(Vk_Context *context);
+internal void vk_set_object_name(Vk_Context *context, VkObjectType type, u64 handle, const char *name);
+#endif
 
 internal void vk_create_surface(Vk_Context *context, GLFWwindow *window);
 
 internal void vk_get_queue_family_support(
         VkPhysicalDevice device, VkSurfaceKHR surface, Vk_Queue_Family_Indices *supported);
 
+// Only needed to present, so neither required nor enabled headless.
 global const char *vk_device_extension_names[] = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
 internal b8 vk_check_device_extension_support(VkPhysicalDevice device);
+internal b8 vk_has_device_extension(VkPhysicalDevice device, const char *name);
 
 internal void vk_get_swapchain_support(VkPhysicalDevice device, VkSurfaceKHR surface, Vk_Swapchain_Support_Info *info);
 internal void vk_cleanup_swapchain_support(Vk_Swapchain_Support_Info *info);
 
+// 0 means the device can't run the renderer at all.
 internal u32 vk_rate_device_suitability(VkPhysicalDevice device, VkSurfaceKHR surface);
 
+internal u64 vk_get_device_local_size(VkPhysicalDevice device);
+
+// All zeros on Vulkan 1.0 devices.
+internal void vk_get_device_uuid(VkPhysicalDevice device, u8 uuid[VK_UUID_SIZE]);
+
+internal b8 vk_device_matches_selector(VkPhysicalDevice device, u32 index, const char *selector);
+internal void vk_log_device(VkPhysicalDevice device, u32 index, u32 score);
+internal void vk_log_device_capabilities(VkPhysicalDevice device);
+
 internal void vk_pick_physical_device(Vk_Context *context);
 
+internal Vk_Rendering_Path vk_choose_rendering_path(Vk_Context *context);
+internal const char *vk_rendering_path_name(Vk_Rendering_Path path);
+internal Vk_Texture_Binding vk_choose_texture_binding(Vk_Context *context);
+internal const char *vk_texture_binding_name(Vk_Texture_Binding binding);
+// Whether one draw may sample different textures.
+internal b8 vk_has_bindless_textures(Vk_Context *context);
 internal void vk_create_device(Vk_Context *context);
 
+internal VkSurfaceFormatKHR vk_choose_surface_format(Vk_Swapchain_Support_Info *support);
+internal VkPresentModeKHR vk_choose_present_mode(Vk_Swapchain_Support_Info *support, Vk_Present_Policy policy);
+internal const char *vk_present_mode_name(VkPresentModeKHR present_mode);
+
 internal void vk_create_swapchain(Vk_Context *context, GLFWwindow *window);
 internal void vk_cleanup_swapchain(Vk_Context *context);
 
+// A single offscreen image in place of the swapchain's, for headless contexts.
+internal void vk_create_headless_backbuffer(Vk_Context *context);
+
 internal void vk_create_render_pass(Vk_Context *context);
 
-internal char *vk_read_code(const char *filename, u64 *size);
+internal void vk_init_resolution(Vk_Context *context);
+internal void vk_cleanup_resolution(Vk_Context *context);
+internal void vk_cmd_begin_timestamps(Vk_Context *context, VkCommandBuffer command_buffer);
+internal void vk_cmd_end_timestamps(Vk_Context *context, VkCommandBuffer command_buffer);
+
+// Reads the last frame's GPU time and, with dynamic resolution, moves the
+// scale toward the target. Call once its fence has signaled.
+internal void vk_update_resolution(Vk_Context *context);
+
+internal VkFormat vk_choose_depth_format(Vk_Context *context);
+
+internal void vk_init_statistics(Vk_Context *context);
+internal void vk_cleanup_statistics(Vk_Context *context);
+internal void vk_update_statistics(Vk_Context *context);
+
+#if SHADER_HOT_RELOAD
+#else
+internal const Vk_Embedded_Shader *vk_find_embedded_shader(const char *name);
+#endif
+
+internal VkShaderModule vk_create_shader_module(Vk_Context *context, const char *name);
+
+internal u32 vk_get_texture_capacity(Vk_Context *context);
+internal void vk_create_texture_resources(Vk_Context *context);
+internal void vk_cleanup_texture_resources(Vk_Context *context);
+
+// Slot 0 is the placeholder texture, which is also what freed slots and
+// textures created once the array is full end up sampling.
+internal u32 vk_allocate_texture_slot(Vk_Context *context);
+internal void vk_free_texture_slot(Vk_Context *context, u32 slot);
+internal void vk_write_texture_slot(Vk_Context *context, u32 slot, VkImageView view);
+internal void vk_flush_texture_slots(Vk_Context *context);
+
+internal void vk_create_instance_buffer(Vk_Context *context);
+internal void vk_cleanup_instance_buffer(Vk_Context *context);
 
+// Creates the layout, shader modules, pipeline cache and default variants.
 internal void vk_create_graphics_pipeline(Vk_Context *context);
+internal void vk_create_graphics_pipeline_job(void *data);
+internal void vk_cleanup_pipelines(Vk_Context *context);
+
+internal u64 vk_pipeline_key(Vk_Pipeline_Desc *desc);
+internal void vk_build_pipeline(Vk_Context *context, Vk_Pipeline_Variant *variant);
+internal void vk_build_pipeline_job(void *data);
+
+// The variant's pipeline, or its fallback's while it's still being built.
+internal VkPipeline vk_resolve_pipeline(Vk_Context *context, Vk_Pipeline_Id id);
 
 internal void vk_create_framebuffers(Vk_Context *context);
 internal void vk_cleanup_framebuffers(Vk_Context *context);
@@ -155,16 +961,142 @@ internal void vk_create_command_buffer(Vk_Context *context);
 
 internal void vk_create_sync_objects(Vk_Context *context);
 
-internal void vk_record_command_buffer(Vk_Context *context, u32 image_index);
+internal void vk_create_frame_graph(Vk_Context *context);
+internal void vk_scene_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data);
+internal void vk_upscale_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data);
+internal void vk_ui_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data);
+
+// Also sets the viewport and scissor to extent. framebuffer is ignored with
+// dynamic rendering. The depth attachment, if any, is always cleared.
+internal void vk_cmd_begin_rendering(
+    Vk_Context *context, VkCommandBuffer command_buffer, VkImageView view, VkImageView depth_view,
+    VkFramebuffer framebuffer, VkExtent2D extent, b8 clear);
+internal void vk_cmd_end_rendering(Vk_Context *context, VkCommandBuffer command_buffer);
+
+// Culls, sorts and draws the frame's scene or UI items into a target of the
+// given extent, adding to the stats. Returns the pixels the items cover.
+internal f64 vk_cmd_draw_items(Vk_Context *context, VkCommandBuffer command_buffer, VkExtent2D extent, b8 ui);
+internal b8 vk_is_item_visible(Vk_Draw_Item *item, Vk_Bounds *bounds);
+internal Vk_Pipeline_Id vk_item_pipeline(Vk_Context *context, Vk_Draw_Item *item);
+
+// What a draw with the given variant (0 for the default) is recorded with,
+// which the overdraw heatmap overrides.
+internal Vk_Pipeline_Id vk_select_pipeline(Vk_Context *context, Vk_Pipeline_Id pipeline, b8 translucent);
+// Also keys retained batches, which sort as one item at their farthest depth.
+internal u64 vk_sort_key(Vk_Context *context, u8 layer, b8 translucent, Vk_Pipeline_Id pipeline, u32 texture, f32 depth);
+internal u64 vk_item_sort_key(Vk_Context *context, Vk_Draw_Item *item);
+internal f32 vk_shape_depth(Vk_Shape *shape);
+internal b8 vk_is_shape_visible(Vk_Shape *shape, Vk_Bounds *bounds);
+
+// Appends the pass's visible shapes to the instance buffer and draws them in
+// one call, returning the pixels their quads cover.
+internal f64 vk_cmd_draw_shapes(
+    Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound, Vk_Bounds *bounds,
+    f32 pixels_per_unit[2], b8 ui);
+
+// Layers take equal slices of the depth range, higher ones nearer, and depth
+// orders items within the slice. UI items get the nearer half to themselves.
+internal f32 vk_item_depth(Vk_Draw_Item *item);
+
+// Clip-space z for depth in [0, 1] within layer. UI is always in front.
+internal f32 vk_layer_depth(u8 layer, f32 depth, b8 ui);
+internal void vk_count_unsorted_state_changes(Vk_Context *context, Sort_Entry *entries, u32 count, Vk_Submit_Stats *stats);
+internal void vk_cmd_bind_instances(VkCommandBuffer command_buffer, Vk_Bind_State *bound, VkBuffer buffer);
+// Binds the slot's set with per-draw binding, otherwise does nothing.
+internal void vk_cmd_bind_texture(Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound, u32 slot);
+internal void vk_cmd_draw_sprites(
+    Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound,
+    Vk_Pipeline_Id pipeline, Vk_Mesh *mesh, u32 first_instance, u32 instance_count);
+
+internal void vk_record_command_buffer(Vk_Context *context, u32 image_index, Vk_Draw_Item *items, u32 item_count);
 
 u32 vk_find_memory_type(VkPhysicalDeviceMemoryProperties mem_properties, u32 type_filter, VkMemoryPropertyFlags properties);
 
+internal void vk_init_host_allocator(Vk_Host_Allocator *allocator);
+internal void vk_cleanup_host_allocator(Vk_Host_Allocator *allocator);
+internal void *vk_host_allocate(Vk_Host_Allocator *allocator, u64 size, u64 alignment, u32 scope);
+internal void vk_host_free(Vk_Host_Allocator *allocator, void *memory);
+internal Vk_Host_Header *vk_host_header(void *memory);
+
+internal VKAPI_ATTR void *VKAPI_CALL vk_host_allocation_callback(
+    void *user_data, size_t size, size_t alignment, VkSystemAllocationScope scope);
+internal VKAPI_ATTR void *VKAPI_CALL vk_host_reallocation_callback(
+    void *user_data, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+internal VKAPI_ATTR void VKAPI_CALL vk_host_free_callback(void *user_data, void *memory);
+internal VKAPI_ATTR void VKAPI_CALL vk_host_internal_allocation_callback(
+    void *user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+internal VKAPI_ATTR void VKAPI_CALL vk_host_internal_free_callback(
+    void *user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+// Heap sizes and which memory types they back. Call once the device exists.
+internal void vk_init_memory_tracking(Vk_Context *context);
+
+// Wrap vkAllocateMemory and vkFreeMemory, so every allocation is counted
+// against its heap.
+internal VkResult vk_allocate_memory(Vk_Context *context, const VkMemoryAllocateInfo *info, VkDeviceMemory *memory);
+internal void vk_free_memory(Vk_Context *context, VkDeviceMemory memory);
+
+// Reads the budgets every VK_MEMORY_BUDGET_INTERVAL frames and calls the
+// warning hook for heaps that went over.
+internal void vk_update_memory_budget(Vk_Context *context);
+internal void vk_read_memory_budget(Vk_Context *context);
+internal u32 vk_device_allocation_slot(VkDeviceMemory memory);
+
+internal void vk_get_memory_stats(Vk_Context *context, Vk_Memory_Stats *stats);
+internal void vk_log_memory_report(Vk_Context *context);
+
+// Bytes per texel of the color formats a swapchain can have, 0 for others.
+internal u32 vk_format_texel_size(VkFormat format);
+
+// Recorded last in the frame graph when Vk_Config::capture is set.
+internal void vk_capture_pass(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data);
+
+// Called once the previous frame's fence has signaled: its slot is ready.
+internal void vk_collect_capture(Vk_Context *context);
+internal void vk_capture_job(void *data);
+internal void vk_create_capture_slot(Vk_Context *context, Vk_Capture_Slot *slot, VkDeviceSize size);
+internal void vk_cleanup_capture_slot(Vk_Context *context, Vk_Capture_Slot *slot);
+
+// Waits for the consumer to finish, so call it with the device idle.
+internal void vk_cleanup_capture(Vk_Context *context);
+internal void vk_get_capture_stats(Vk_Context *context, Vk_Capture_Stats *stats);
+
 internal void vk_create_buffer(
     Vk_Context *context, VkDeviceSize size,
     VkBufferUsageFlags usage, VkBuffer *buffer,
     VkMemoryPropertyFlags properties, VkDeviceMemory *buffer_memory);
 
-internal void vk_copy_buffer(Vk_Context *context, VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
+internal VkCommandBuffer vk_begin_one_time_commands(Vk_Context *context);
+internal void vk_end_one_time_commands(Vk_Context *context, VkCommandBuffer command_buffer);
+
+internal void vk_copy_buffer(
+    Vk_Context *context, VkBuffer src_buffer, VkDeviceSize src_offset, VkBuffer dst_buffer, VkDeviceSize size);
+
+internal void vk_create_staging_buffer(Vk_Context *context, VkDeviceSize size, Vk_Staging_Buffer *staging);
+internal void vk_cleanup_staging_buffer(Vk_Context *context, Vk_Staging_Buffer *staging);
+
+// Returns a pointer into the mapping and the offset to copy from, or NULL if
+// the buffer is full. Call vk_staging_reset once the copies have completed.
+internal u8 *vk_staging_push(
+    Vk_Staging_Buffer *staging, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset);
+internal void vk_staging_reset(Vk_Staging_Buffer *staging);
+
+internal void vk_create_texture(Vk_Context *context, u32 width, u32 height, Vk_Texture *texture);
+internal void vk_cleanup_texture(Vk_Context *context, Vk_Texture *texture);
+
+// Records the layout transitions and copy that fill the whole texture from
+// tightly packed RGBA8 pixels in src_buffer.
+internal void vk_cmd_upload_texture(
+    VkCommandBuffer command_buffer, VkBuffer src_buffer, VkDeviceSize src_offset, Vk_Texture *texture);
+
+// Device-local vertex (Vk_Vertex) and u32 index buffers.
+internal void vk_create_mesh(Vk_Context *context, u32 vertex_count, u32 index_count, Vk_Mesh *mesh);
+internal void vk_cleanup_mesh(Vk_Context *context, Vk_Mesh *mesh);
+internal void vk_compute_mesh_extent(const Vk_Vertex *vertices, u32 vertex_count, f32 extent[2]);
+
+internal void vk_cmd_upload_mesh(
+    VkCommandBuffer command_buffer, VkBuffer src_buffer,
+    VkDeviceSize vertex_offset, VkDeviceSize index_offset, Vk_Mesh *mesh);
 
 global Vk_Vertex vk_quad_vertices[] = {
     {{-1.0f, -1.0f}, {0.f, 1.f}}, // Bottom-left
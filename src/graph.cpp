@@ -0,0 +1,444 @@
+internal Render_Graph *graph_create() {
+    return new Render_Graph{};
+}
+
+internal void graph_destroy(Render_Graph *graph, Vk_Context *context) {
+    graph_cleanup_transients(graph, context);
+    delete graph;
+}
+
+internal Graph_Resource_Id graph_import_image(
+    Render_Graph *graph, const char *name, VkPipelineStageFlags ready_stages, Graph_Access final_access) {
+    ASSERT(graph->resource_count < MAX_GRAPH_RESOURCES);
+    Graph_Resource_Id id = graph->resource_count++;
+
+    Graph_Resource *resource = &graph->resources[id];
+    snprintf(resource->name, sizeof(resource->name), "%s", name);
+    resource->imported = true;
+    resource->aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    resource->initial_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource->initial_state.stages = ready_stages;
+    resource->final_access = final_access;
+    return id;
+}
+
+internal Graph_Resource_Id graph_create_image(Render_Graph *graph, const char *name, VkFormat format, f32 scale) {
+    ASSERT(graph->resource_count < MAX_GRAPH_RESOURCES);
+    Graph_Resource_Id id = graph->resource_count++;
+
+    Graph_Resource *resource = &graph->resources[id];
+    snprintf(resource->name, sizeof(resource->name), "%s", name);
+    resource->format = format;
+    resource->scale = scale;
+    resource->aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    return id;
+}
+
+internal u32 graph_add_pass(Render_Graph *graph, const char *name, Graph_Execute_Proc *execute, void *user_data) {
+    ASSERT(graph->pass_count < MAX_GRAPH_PASSES);
+    u32 index = graph->pass_count++;
+
+    Graph_Pass *pass = &graph->passes[index];
+    pass->name = name;
+    pass->execute = execute;
+    pass->user_data = user_data;
+    return index;
+}
+
+internal void graph_use(Render_Graph *graph, u32 pass_index, Graph_Resource_Id resource, Graph_Access access) {
+    Graph_Pass *pass = &graph->passes[pass_index];
+    ASSERT(pass->use_count < MAX_GRAPH_PASS_USES);
+    ASSERT(resource < graph->resource_count);
+
+    pass->uses[pass->use_count].resource = resource;
+    pass->uses[pass->use_count].access = access;
+    pass->use_count++;
+
+    if (access == GRAPH_ACCESS_DEPTH_WRITE) graph->resources[resource].aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+internal void graph_set_side_effects(Render_Graph *graph, u32 pass_index) {
+    graph->passes[pass_index].side_effects = true;
+}
+
+internal Graph_State graph_access_state(Graph_Access access) {
+    Graph_State state{};
+    switch (access) {
+        case GRAPH_ACCESS_COLOR_WRITE:
+            state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            state.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            state.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            state.is_write = true;
+            break;
+
+        case GRAPH_ACCESS_DEPTH_WRITE:
+            state.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            state.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            state.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            state.is_write = true;
+            break;
+
+        case GRAPH_ACCESS_SAMPLED:
+            state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            state.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            state.access = VK_ACCESS_SHADER_READ_BIT;
+            break;
+
+        case GRAPH_ACCESS_TRANSFER_SRC:
+            state.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            state.access = VK_ACCESS_TRANSFER_READ_BIT;
+            break;
+
+        case GRAPH_ACCESS_TRANSFER_DST:
+            state.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            state.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            state.is_write = true;
+            break;
+
+        case GRAPH_ACCESS_PRESENT:
+            state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            state.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            break;
+    }
+    return state;
+}
+
+internal VkImageUsageFlags graph_access_usage(Graph_Access access) {
+    switch (access) {
+        case GRAPH_ACCESS_COLOR_WRITE:  return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        case GRAPH_ACCESS_DEPTH_WRITE:  return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        case GRAPH_ACCESS_SAMPLED:      return VK_IMAGE_USAGE_SAMPLED_BIT;
+        case GRAPH_ACCESS_TRANSFER_SRC: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        case GRAPH_ACCESS_TRANSFER_DST: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        default:                        return 0;
+    }
+}
+
+// Reads of the same layout can overlap; anything involving a write or a
+// layout change has to wait.
+internal b8 graph_needs_barrier(Graph_State *current, Graph_State *next) {
+    return current->layout != next->layout || current->is_write || next->is_write;
+}
+
+internal void graph_compute_lifetimes(Render_Graph *graph) {
+    { // Cull passes that don't contribute to an imported image
+        b8 needed[MAX_GRAPH_RESOURCES] = {};
+        for (u32 i = 0; i < graph->resource_count; ++i) {
+            needed[i] = graph->resources[i].imported;
+        }
+
+        graph->culled_pass_count = 0;
+        for (u32 p = graph->pass_count; p-- > 0;) {
+            Graph_Pass *pass = &graph->passes[p];
+
+            b8 live = pass->side_effects;
+            for (u32 u = 0; u < pass->use_count; ++u) {
+                Graph_Use *use = &pass->uses[u];
+                if (graph_access_state(use->access).is_write && needed[use->resource]) live = true;
+            }
+
+            pass->culled = !live;
+            if (!live) {
+                graph->culled_pass_count++;
+                continue;
+            }
+
+            for (u32 u = 0; u < pass->use_count; ++u) {
+                Graph_Use *use = &pass->uses[u];
+                if (!graph_access_state(use->access).is_write) needed[use->resource] = true;
+            }
+        }
+    }
+
+    { // Lifetimes and usage of transients
+        for (u32 i = 0; i < graph->resource_count; ++i) {
+            Graph_Resource *resource = &graph->resources[i];
+            resource->first_pass = UINT32_MAX;
+            resource->last_pass = 0;
+            if (!resource->imported) resource->usage = 0;
+        }
+
+        for (u32 p = 0; p < graph->pass_count; ++p) {
+            Graph_Pass *pass = &graph->passes[p];
+            if (pass->culled) continue;
+
+            for (u32 u = 0; u < pass->use_count; ++u) {
+                Graph_Resource *resource = &graph->resources[pass->uses[u].resource];
+                resource->first_pass = MIN(resource->first_pass, p);
+                resource->last_pass = MAX(resource->last_pass, p);
+                resource->usage |= graph_access_usage(pass->uses[u].access);
+            }
+        }
+    }
+}
+
+internal void graph_compile(Render_Graph *graph, Vk_Context *context) {
+    graph_cleanup_transients(graph, context);
+    graph_compute_lifetimes(graph);
+    graph_create_transients(graph, context);
+
+    { // Barriers
+        Graph_State states[MAX_GRAPH_RESOURCES];
+        Graph_State block_states[MAX_GRAPH_RESOURCES] = {};
+        for (u32 i = 0; i < graph->resource_count; ++i) {
+            states[i] = graph->resources[i].initial_state;
+        }
+
+        graph->barrier_count = 0;
+        for (u32 p = 0; p < graph->pass_count; ++p) {
+            Graph_Pass *pass = &graph->passes[p];
+            pass->first_barrier = graph->barrier_count;
+            pass->barrier_count = 0;
+            if (pass->culled) continue;
+
+            for (u32 u = 0; u < pass->use_count; ++u) {
+                Graph_Use *use = &pass->uses[u];
+                Graph_Resource *resource = &graph->resources[use->resource];
+                Graph_State *current = &states[use->resource];
+                Graph_State next = graph_access_state(use->access);
+
+                // A transient's first use has to wait for whatever used its
+                // memory last, and never needs the old contents.
+                if (!resource->imported && p == resource->first_pass && current->layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+                    Graph_State *previous = &block_states[resource->block];
+                    current->stages = previous->stages;
+                    current->access = previous->access;
+                    current->is_write = previous->is_write;
+                }
+
+                if (graph_needs_barrier(current, &next)) {
+                    ASSERT(graph->barrier_count < ARRAY_COUNT(graph->barriers));
+                    Graph_Barrier *barrier = &graph->barriers[graph->barrier_count++];
+                    barrier->resource = use->resource;
+                    barrier->src = *current;
+                    barrier->dst = next;
+                    pass->barrier_count++;
+                    *current = next;
+                } else {
+                    current->stages |= next.stages;
+                    current->access |= next.access;
+                }
+
+                if (!resource->imported) block_states[resource->block] = *current;
+            }
+        }
+
+        graph->final_barrier_start = graph->barrier_count;
+        for (u32 i = 0; i < graph->resource_count; ++i) {
+            Graph_Resource *resource = &graph->resources[i];
+            if (!resource->imported) continue;
+
+            Graph_State final_state = graph_access_state(resource->final_access);
+            if (!graph_needs_barrier(&states[i], &final_state)) continue;
+
+            ASSERT(graph->barrier_count < ARRAY_COUNT(graph->barriers));
+            Graph_Barrier *barrier = &graph->barriers[graph->barrier_count++];
+            barrier->resource = i;
+            barrier->src = states[i];
+            barrier->dst = final_state;
+        }
+    }
+
+    LOG_INFO("Render graph: %u passes (%u culled), %u barriers per frame, %.2f MB transient memory (%.2f MB saved by aliasing)",
+        graph->pass_count, graph->culled_pass_count, graph->barrier_count,
+        graph->transient_size / (f64)MB(1), (graph->unaliased_size - graph->transient_size) / (f64)MB(1));
+}
+
+internal void graph_create_transients(Render_Graph *graph, Vk_Context *context) {
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        Graph_Resource *resource = &graph->resources[i];
+        if (resource->imported || resource->first_pass == UINT32_MAX) continue;
+
+        resource->extent.width = MAX((u32)(context->swapchain_extent.width * resource->scale), 1u);
+        resource->extent.height = MAX((u32)(context->swapchain_extent.height * resource->scale), 1u);
+
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent.width = resource->extent.width;
+        image_info.extent.height = resource->extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.format = resource->format;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage = resource->usage;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VK_CHECK(vkCreateImage(context->device, &image_info, context->allocator, &resource->image));
+        VK_NAME(context, VK_OBJECT_TYPE_IMAGE, resource->image, resource->name);
+
+        vkGetImageMemoryRequirements(context->device, resource->image, &resource->memory_requirements);
+    }
+
+    graph_place_transients(graph);
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(context->physical_device, &memory_properties);
+
+    for (u32 b = 0; b < graph->block_count; ++b) {
+        Graph_Memory_Block *block = &graph->blocks[b];
+
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = block->size;
+        alloc_info.memoryTypeIndex = vk_find_memory_type(
+            memory_properties, block->memory_type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VK_CHECK(vk_allocate_memory(context, &alloc_info, &block->memory));
+    }
+
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        Graph_Resource *resource = &graph->resources[i];
+        if (resource->imported || resource->first_pass == UINT32_MAX) continue;
+
+        VK_CHECK(vkBindImageMemory(context->device, resource->image, graph->blocks[resource->block].memory, 0));
+
+        VkImageViewCreateInfo view_info{};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = resource->image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = resource->format;
+        view_info.subresourceRange.aspectMask = resource->aspect;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+        VK_CHECK(vkCreateImageView(context->device, &view_info, context->allocator, &resource->view));
+    }
+}
+
+internal void graph_place_transients(Render_Graph *graph) {
+    Graph_Resource_Id order[MAX_GRAPH_RESOURCES];
+    u32 order_count = 0;
+
+    graph->block_count = 0;
+    graph->transient_size = 0;
+    graph->unaliased_size = 0;
+
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        Graph_Resource *resource = &graph->resources[i];
+        if (resource->imported || resource->first_pass == UINT32_MAX) continue;
+        graph->unaliased_size += resource->memory_requirements.size;
+
+        // Sorted by first use, so a block is free for this resource once its
+        // last occupant's lifetime has ended.
+        u32 at = order_count++;
+        while (at > 0 && graph->resources[order[at - 1]].first_pass > resource->first_pass) {
+            order[at] = order[at - 1];
+            --at;
+        }
+        order[at] = i;
+    }
+
+    for (u32 i = 0; i < order_count; ++i) {
+        Graph_Resource *resource = &graph->resources[order[i]];
+        VkMemoryRequirements *requirements = &resource->memory_requirements;
+
+        u32 best = UINT32_MAX;
+        for (u32 b = 0; b < graph->block_count; ++b) {
+            Graph_Memory_Block *block = &graph->blocks[b];
+            if (block->last_pass >= resource->first_pass) continue;
+            if ((block->memory_type_bits & requirements->memoryTypeBits) == 0) continue;
+            if (best == UINT32_MAX || block->size > graph->blocks[best].size) best = b;
+        }
+
+        if (best == UINT32_MAX) {
+            best = graph->block_count++;
+            graph->blocks[best] = {};
+            graph->blocks[best].memory_type_bits = requirements->memoryTypeBits;
+        }
+
+        Graph_Memory_Block *block = &graph->blocks[best];
+        block->size = MAX(block->size, requirements->size);
+        block->memory_type_bits &= requirements->memoryTypeBits;
+        block->last_pass = resource->last_pass;
+        block->last_resource = order[i];
+        resource->block = best;
+    }
+
+    for (u32 b = 0; b < graph->block_count; ++b) {
+        graph->transient_size += graph->blocks[b].size;
+    }
+}
+
+internal void graph_cleanup_transients(Render_Graph *graph, Vk_Context *context) {
+    for (u32 i = 0; i < graph->resource_count; ++i) {
+        Graph_Resource *resource = &graph->resources[i];
+        if (resource->imported || resource->image == VK_NULL_HANDLE) continue;
+
+        vkDestroyImageView(context->device, resource->view, context->allocator);
+        vkDestroyImage(context->device, resource->image, context->allocator);
+        resource->view = VK_NULL_HANDLE;
+        resource->image = VK_NULL_HANDLE;
+    }
+
+    for (u32 b = 0; b < graph->block_count; ++b) {
+        vk_free_memory(context, graph->blocks[b].memory);
+    }
+    graph->block_count = 0;
+    graph->transient_size = 0;
+    graph->unaliased_size = 0;
+}
+
+internal void graph_set_image(Render_Graph *graph, Graph_Resource_Id resource, VkImage image, VkImageView view) {
+    ASSERT(graph->resources[resource].imported);
+    graph->resources[resource].image = image;
+    graph->resources[resource].view = view;
+}
+
+internal Graph_Resource *graph_resource(Render_Graph *graph, Graph_Resource_Id resource) {
+    return &graph->resources[resource];
+}
+
+internal void graph_cmd_barriers(Render_Graph *graph, VkCommandBuffer command_buffer, u32 first, u32 count) {
+    if (count == 0) return;
+
+    VkImageMemoryBarrier image_barriers[MAX_GRAPH_RESOURCES];
+    ASSERT(count <= ARRAY_COUNT(image_barriers));
+
+    VkPipelineStageFlags src_stages = 0;
+    VkPipelineStageFlags dst_stages = 0;
+    for (u32 i = 0; i < count; ++i) {
+        Graph_Barrier *barrier = &graph->barriers[first + i];
+        Graph_Resource *resource = &graph->resources[barrier->resource];
+
+        // Write-after-read only needs the execution dependency.
+        VkImageMemoryBarrier *image_barrier = &image_barriers[i];
+        *image_barrier = {};
+        image_barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_barrier->srcAccessMask = barrier->src.is_write ? barrier->src.access : 0;
+        image_barrier->dstAccessMask = barrier->dst.access;
+        image_barrier->oldLayout = barrier->src.layout;
+        image_barrier->newLayout = barrier->dst.layout;
+        image_barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier->image = resource->image;
+        image_barrier->subresourceRange.aspectMask = resource->aspect;
+        image_barrier->subresourceRange.baseMipLevel = 0;
+        image_barrier->subresourceRange.levelCount = 1;
+        image_barrier->subresourceRange.baseArrayLayer = 0;
+        image_barrier->subresourceRange.layerCount = 1;
+
+        src_stages |= barrier->src.stages;
+        dst_stages |= barrier->dst.stages;
+    }
+
+    if (src_stages == 0) src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 0, NULL, 0, NULL, count, image_barriers);
+}
+
+internal void graph_execute(Render_Graph *graph, VkCommandBuffer command_buffer) {
+    for (u32 p = 0; p < graph->pass_count; ++p) {
+        Graph_Pass *pass = &graph->passes[p];
+        if (pass->culled) continue;
+
+        graph_cmd_barriers(graph, command_buffer, pass->first_barrier, pass->barrier_count);
+        pass->execute(graph, command_buffer, pass->user_data);
+    }
+
+    graph_cmd_barriers(graph, command_buffer, graph->final_barrier_start, graph->barrier_count - graph->final_barrier_start);
+}
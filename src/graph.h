@@ -0,0 +1,156 @@
+#pragma once
+
+// Render Graph
+// -----------------------------------------------------------------------------
+
+// Passes are added in execution order and declare how they use named images.
+// graph_compile then:
+//   - culls passes whose writes never reach an imported image,
+//   - works out every layout transition and pipeline barrier up front,
+//   - creates the transient images and lets those whose lifetimes don't
+//     overlap share memory.
+//
+// The graph is static between compiles; only imported images (e.g. the
+// current swapchain image) are rebound per frame with graph_set_image.
+// Recompile when the swapchain extent changes, since transients follow it.
+
+#define MAX_GRAPH_RESOURCES 32
+#define MAX_GRAPH_PASSES    32
+#define MAX_GRAPH_PASS_USES 8
+
+typedef u32 Graph_Resource_Id;
+
+enum Graph_Access : u32 {
+    GRAPH_ACCESS_COLOR_WRITE,
+    GRAPH_ACCESS_DEPTH_WRITE,
+    GRAPH_ACCESS_SAMPLED,
+    GRAPH_ACCESS_TRANSFER_SRC,
+    GRAPH_ACCESS_TRANSFER_DST,
+    GRAPH_ACCESS_PRESENT,
+};
+
+// Where a resource is, or needs to be, at some point in the frame.
+struct Graph_State {
+    VkImageLayout layout;
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    b8 is_write;
+};
+
+struct Graph_Resource {
+    char name[64];
+    b8 imported;
+
+    // Transients: the extent is the swapchain extent times scale.
+    VkFormat format;
+    f32 scale;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+
+    // Imported images start in initial_state every frame and are left in
+    // the layout of final_access.
+    Graph_State initial_state;
+    Graph_Access final_access;
+
+    VkImage image;
+    VkImageView view;
+    VkExtent2D extent;
+
+    // Filled in by graph_compile.
+    u32 first_pass;
+    u32 last_pass;
+    u32 block;
+    VkMemoryRequirements memory_requirements;
+};
+
+struct Render_Graph;
+typedef void Graph_Execute_Proc(Render_Graph *graph, VkCommandBuffer command_buffer, void *user_data);
+
+struct Graph_Use {
+    Graph_Resource_Id resource;
+    Graph_Access access;
+};
+
+struct Graph_Barrier {
+    Graph_Resource_Id resource;
+    Graph_State src;
+    Graph_State dst;
+};
+
+struct Graph_Pass {
+    const char *name;
+    Graph_Execute_Proc *execute;
+    void *user_data;
+
+    Graph_Use uses[MAX_GRAPH_PASS_USES];
+    u32 use_count;
+
+    // Never culled, for passes whose output leaves the graph (e.g. readbacks
+    // into buffers) and so doesn't show up as a write.
+    b8 side_effects;
+
+    // Filled in by graph_compile. Barriers run before the pass.
+    b8 culled;
+    u32 first_barrier;
+    u32 barrier_count;
+};
+
+// Transients that share a block are bound at offset 0 of the same memory.
+struct Graph_Memory_Block {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    u32 memory_type_bits;
+    u32 last_pass;
+    Graph_Resource_Id last_resource;
+};
+
+struct Render_Graph {
+    Graph_Resource resources[MAX_GRAPH_RESOURCES];
+    u32 resource_count;
+
+    Graph_Pass passes[MAX_GRAPH_PASSES];
+    u32 pass_count;
+
+    // Per-pass barriers first, then the final transitions of imported images.
+    Graph_Barrier barriers[MAX_GRAPH_RESOURCES * (MAX_GRAPH_PASSES + 1)];
+    u32 barrier_count;
+    u32 final_barrier_start;
+
+    Graph_Memory_Block blocks[MAX_GRAPH_RESOURCES];
+    u32 block_count;
+
+    u32 culled_pass_count;
+    VkDeviceSize transient_size; // Memory actually allocated
+    VkDeviceSize unaliased_size; // What it would take without aliasing
+};
+
+internal Render_Graph *graph_create();
+internal void graph_destroy(Render_Graph *graph, Vk_Context *context);
+
+internal Graph_Resource_Id graph_import_image(
+    Render_Graph *graph, const char *name, VkPipelineStageFlags ready_stages, Graph_Access final_access);
+internal Graph_Resource_Id graph_create_image(Render_Graph *graph, const char *name, VkFormat format, f32 scale);
+
+internal u32 graph_add_pass(Render_Graph *graph, const char *name, Graph_Execute_Proc *execute, void *user_data);
+internal void graph_use(Render_Graph *graph, u32 pass, Graph_Resource_Id resource, Graph_Access access);
+internal void graph_set_side_effects(Render_Graph *graph, u32 pass);
+
+// Safe to call again after a resize; transients are recreated.
+internal void graph_compile(Render_Graph *graph, Vk_Context *context);
+
+internal void graph_set_image(Render_Graph *graph, Graph_Resource_Id resource, VkImage image, VkImageView view);
+internal Graph_Resource *graph_resource(Render_Graph *graph, Graph_Resource_Id resource);
+
+internal void graph_execute(Render_Graph *graph, VkCommandBuffer command_buffer);
+
+internal Graph_State graph_access_state(Graph_Access access);
+internal b8 graph_needs_barrier(Graph_State *current, Graph_State *next);
+internal void graph_cleanup_transients(Render_Graph *graph, Vk_Context *context);
+internal void graph_create_transients(Render_Graph *graph, Vk_Context *context);
+
+// The parts of graph_compile that don't touch the device, so placement can be
+// checked without one: culling and lifetimes, then assigning transients with
+// memory_requirements filled in to blocks.
+internal void graph_compute_lifetimes(Render_Graph *graph);
+internal void graph_place_transients(Render_Graph *graph);
+internal void graph_cmd_barriers(Render_Graph *graph, VkCommandBuffer command_buffer, u32 first, u32 count);
@@ -0,0 +1,99 @@
+// -----------------------------------------------------------------------------
+
+internal Job_System *job_system_init(u32 thread_count) {
+    if (thread_count == 0) {
+        u32 hardware_threads = std::thread::hardware_concurrency();
+        thread_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+
+    auto jobs = new Job_System{};
+    jobs->queue = new Job[JOB_QUEUE_CAPACITY]{};
+    jobs->thread_count = thread_count;
+    jobs->threads = new std::thread[thread_count];
+    for (u32 i = 0; i < thread_count; ++i) {
+        jobs->threads[i] = std::thread(job_worker_main, jobs);
+    }
+
+    LOG_INFO("Job system started with %u worker(s)", thread_count);
+
+    return jobs;
+}
+
+internal void job_system_cleanup(Job_System *jobs) {
+    {
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+        jobs->quit = true;
+    }
+    jobs->wake.notify_all();
+
+    for (u32 i = 0; i < jobs->thread_count; ++i) {
+        jobs->threads[i].join();
+    }
+
+    delete[] jobs->threads;
+    delete[] jobs->queue;
+    delete jobs;
+}
+
+internal void job_run(Job job) {
+    job.proc(job.data);
+    if (job.counter) job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+internal b8 job_try_pop(Job_System *jobs, Job *job) {
+    std::lock_guard<std::mutex> lock(jobs->mutex);
+    if (jobs->queue_count == 0) return false;
+
+    *job = jobs->queue[jobs->queue_head];
+    jobs->queue_head = (jobs->queue_head + 1) % JOB_QUEUE_CAPACITY;
+    jobs->queue_count--;
+    return true;
+}
+
+internal void job_submit(Job_System *jobs, Job_Proc *proc, void *data, Job_Counter *counter) {
+    Job job{proc, data, counter};
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(jobs->mutex);
+        if (jobs->queue_count < JOB_QUEUE_CAPACITY) {
+            u32 tail = (jobs->queue_head + jobs->queue_count) % JOB_QUEUE_CAPACITY;
+            jobs->queue[tail] = job;
+            jobs->queue_count++;
+            job.proc = NULL;
+        }
+    }
+
+    if (job.proc) {
+        job_run(job);
+    } else {
+        jobs->wake.notify_one();
+    }
+}
+
+internal void job_wait(Job_System *jobs, Job_Counter *counter) {
+    while (counter->pending.load(std::memory_order_acquire) > 0) {
+        Job job;
+        if (job_try_pop(jobs, &job)) {
+            job_run(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+internal void job_worker_main(Job_System *jobs) {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs->mutex);
+            jobs->wake.wait(lock, [jobs] { return jobs->quit || jobs->queue_count > 0; });
+            if (jobs->queue_count == 0) return; // quit requested and nothing left to run
+
+            job = jobs->queue[jobs->queue_head];
+            jobs->queue_head = (jobs->queue_head + 1) % JOB_QUEUE_CAPACITY;
+            jobs->queue_count--;
+        }
+        job_run(job);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// Fixed pool of worker threads pulling from one FIFO queue. Jobs must not
+// touch Vulkan objects that need external synchronization unless the caller
+// guarantees exclusive access.
+
+typedef void Job_Proc(void *data);
+
+struct Job_Counter {
+    std::atomic<u32> pending;
+};
+
+struct Job {
+    Job_Proc *proc;
+    void *data;
+    Job_Counter *counter;
+};
+
+struct Job_System {
+    std::thread *threads;
+    u32 thread_count;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    Job *queue;
+    u32 queue_head;
+    u32 queue_count;
+    b8 quit;
+};
+
+// thread_count 0 picks one worker per hardware thread, minus the main thread.
+internal Job_System *job_system_init(u32 thread_count);
+internal void job_system_cleanup(Job_System *jobs);
+
+// counter may be NULL. If the queue is full the job runs on the calling thread.
+internal void job_submit(Job_System *jobs, Job_Proc *proc, void *data, Job_Counter *counter);
+
+// Runs queued jobs on the calling thread until the counter drops to zero.
+internal void job_wait(Job_System *jobs, Job_Counter *counter);
+
+internal void job_run(Job job);
+internal b8 job_try_pop(Job_System *jobs, Job *job);
+internal void job_worker_main(Job_System *jobs);
@@ -1,10 +1,16 @@
 #include "main.h"
 
 #include "base.cpp"
+#include "job.cpp"
+#include "sort.cpp"
 #include "gfx.cpp"
+#include "graph.cpp"
+#include "asset.cpp"
+#include "stream.cpp"
+#include "scene.cpp"
 #include "app.cpp"
 
-int main() {
-    app_run();
+int main(int argc, char **argv) {
+    app_run(argc, argv);
     return 0;
 }
@@ -1,15 +1,5 @@
 #pragma once
 
-// Includes
-// -----------------------------------------------------------------------------
-
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
-#include "base.h"
-#include "gfx.h"
-#include "app.h"
-
 // Configurables
 // -----------------------------------------------------------------------------
 
@@ -21,3 +11,116 @@
 #define WINDOW_WIDTH  640
 #define WINDOW_HEIGHT 480
 #define WINDOW_TITLE  APP_NAME
+
+// Same syntax as the --device command line option, which takes precedence.
+#define DEVICE_SELECTOR_ENV "VK2D_DEVICE"
+
+// Overridable with --present and --fps-cap. Frames are only paced, with
+// sleep + spin, under --present capped or when --fps-cap is given; capped
+// uses DEFAULT_FPS_CAP unless --fps-cap says otherwise.
+#define DEFAULT_PRESENT_POLICY VK_PRESENT_POLICY_LOW_LATENCY
+#define DEFAULT_FPS_CAP        240.0f
+
+// With --redraw on-demand the loop blocks in glfwWaitEvents and only renders
+// for input, animation, streaming or an explicit app_request_redraw. The
+// animation then starts paused.
+#define DEFAULT_REDRAW_ON_DEMAND 0
+
+// Overridable with --dynamic-resolution, --render-scale-min/max and
+// --gpu-target-ms. The scene's render scale follows measured GPU time; UI is
+// always drawn at the swapchain's resolution. Off by default, since the scene
+// then goes through an offscreen target and a blit even at scale 1.
+#define DEFAULT_DYNAMIC_RESOLUTION 0
+#define DEFAULT_MIN_RENDER_SCALE   0.5f
+#define DEFAULT_MAX_RENDER_SCALE   1.0f
+#define DEFAULT_GPU_TARGET_MS      16.0f
+
+// Overridable with --depth. Opaque sprites then go front to back and the depth
+// test rejects what they hide.
+#define DEFAULT_DEPTH_BUFFER 1
+
+// Overridable with --platform: auto, win32, x11, wayland or null. The null
+// platform has no display at all; GLFW backs its windows with
+// VK_EXT_headless_surface, so the app runs on servers without X or Wayland.
+#define DEFAULT_PLATFORM GLFW_ANY_PLATFORM
+
+// Applies in both redraw modes while the window doesn't have focus.
+#define UNFOCUSED_FPS_CAP 10.0f
+
+// The simulation always advances in fixed steps; rendering interpolates
+// between the last two. If a frame takes too long, at most
+// MAX_SIM_STEPS_PER_FRAME are run and the rest of the backlog is dropped.
+#define SIM_TICK_RATE           60
+#define MAX_SIM_STEPS_PER_FRAME 8
+
+// Input-to-present latency is logged this often, when there was any input,
+// along with the average CPU time per frame.
+#define LATENCY_REPORT_INTERVAL_S 2
+
+// Host and device memory use is logged this often, checked along with the
+// latency report.
+#define MEMORY_REPORT_INTERVAL_S 10
+
+// Debug builds only: also forward INFO and VERBOSE validation messages.
+#ifndef VALIDATION_VERBOSE
+#define VALIDATION_VERBOSE 0
+#endif
+
+// Load SPIR-V from res/shaders at runtime instead of the embedded copies, so
+// shaders can be recompiled without rebuilding the executable.
+#ifndef SHADER_HOT_RELOAD
+#define SHADER_HOT_RELOAD 0
+#endif
+
+// Persistently mapped upload memory, see Vk_Staging_Buffer.
+#define STAGING_BUFFER_SIZE MB(16)
+
+// Upper bound on slots in the texture array; device limits may lower it.
+#define MAX_TEXTURE_COUNT 1024
+
+// Sprites drawn per frame, each one Vk_Sprite_Instance in the instance buffer.
+#define MAX_SPRITE_INSTANCES 16384
+
+// Shapes drawn per frame, each one Vk_Shape_Instance after the sprites in the
+// instance buffer.
+#define MAX_SHAPE_INSTANCES 262144
+
+// Distinct pipeline states; at most 255, they're 8 bits of the sort key.
+#define MAX_PIPELINE_VARIANTS 64
+
+// Where the driver's pipeline cache is kept between runs.
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+// Overridable with --pipelines. Variants requested after init are built on a
+// worker, drawing with a default pipeline until they're ready.
+#define DEFAULT_ASYNC_PIPELINES 1
+
+// Edge length of the checkerboard bound while a texture is still streaming.
+#define PLACEHOLDER_TEXTURE_SIZE 8
+
+#define JOB_QUEUE_CAPACITY 1024
+
+#define ASSET_PACK_PATH "res/assets.pak"
+
+// Streamed assets share their own staging buffer, and at most
+// STREAM_UPLOAD_BUDGET bytes of it are uploaded per frame (at least one asset
+// always goes through, so a single large asset can't stall forever).
+#define MAX_STREAM_REQUESTS  256
+#define STREAM_STAGING_SIZE  MB(16)
+#define STREAM_UPLOAD_BUDGET MB(2)
+
+// Includes
+// -----------------------------------------------------------------------------
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "base.h"
+#include "job.h"
+#include "sort.h"
+#include "gfx.h"
+#include "graph.h"
+#include "asset.h"
+#include "stream.h"
+#include "scene.h"
+#include "app.h"
@@ -0,0 +1,221 @@
+// Retained Scene
+// -----------------------------------------------------------------------------
+
+internal Scene *scene_create(Vk_Context *context, u32 slot_capacity) {
+    auto scene = new Scene{};
+    scene->slot_capacity = slot_capacity;
+
+    vk_create_buffer(
+        context, slot_capacity * sizeof(Vk_Sprite_Instance),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &scene->instance_buffer,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scene->instance_memory);
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, scene->instance_buffer, "scene instances");
+
+    scene->instances = new Vk_Sprite_Instance[slot_capacity]{};
+    scene->slot_objects = new Scene_Handle[slot_capacity]{};
+    scene->dirty = new u64[(slot_capacity + 63) / 64]{};
+    scene->objects = new Scene_Object[slot_capacity]{};
+    scene->copy_regions = new VkBufferCopy[slot_capacity / 2 + 1];
+
+    return scene;
+}
+
+internal void scene_destroy(Scene *scene, Vk_Context *context) {
+    vkDestroyBuffer(context->device, scene->instance_buffer, context->allocator);
+    vk_free_memory(context, scene->instance_memory);
+
+    delete[] scene->instances;
+    delete[] scene->slot_objects;
+    delete[] scene->dirty;
+    delete[] scene->objects;
+    delete[] scene->copy_regions;
+    delete scene;
+}
+
+internal Scene_Batch_Id scene_create_batch(
+    Scene *scene, Vk_Mesh *mesh, u32 capacity, u8 layer, b8 translucent, Vk_Pipeline_Id pipeline) {
+    if (scene->batch_count == MAX_SCENE_BATCHES) LOG_FATAL("Out of scene batches");
+    if (scene->slot_count + capacity > scene->slot_capacity) LOG_FATAL("Out of scene slots");
+
+    Scene_Batch_Id id = scene->batch_count++;
+    Scene_Batch *batch = &scene->batches[id];
+    batch->mesh = mesh;
+    batch->pipeline = pipeline;
+    batch->translucent = translucent;
+    batch->layer = layer;
+    batch->depth = 0.0f;
+    batch->first_slot = scene->slot_count;
+    batch->capacity = capacity;
+    batch->count = 0;
+
+    scene->slot_count += capacity;
+    return id;
+}
+
+internal Scene_Handle scene_add(
+    Scene *scene, Scene_Batch_Id batch_id, const f32 offset[2], const f32 scale[2], Vk_Texture *texture, f32 depth) {
+    Scene_Batch *batch = &scene->batches[batch_id];
+    if (batch->count == batch->capacity) return 0;
+
+    Scene_Handle handle = scene->free_object;
+    if (handle != 0) {
+        scene->free_object = scene->objects[handle - 1].next_free;
+    } else {
+        handle = ++scene->object_count;
+    }
+
+    u32 slot = batch->first_slot + batch->count++;
+    Scene_Object *object = &scene->objects[handle - 1];
+    object->batch = batch_id;
+    object->slot = slot;
+    object->next_free = 0;
+    scene->slot_objects[slot] = handle;
+
+    Vk_Sprite_Instance *instance = &scene->instances[slot];
+    instance->offset[0] = offset[0];
+    instance->offset[1] = offset[1];
+    instance->scale[0] = scale[0];
+    instance->scale[1] = scale[1];
+    instance->texture_index = texture->index;
+    instance->depth = vk_layer_depth(batch->layer, depth, false);
+    scene_mark_dirty(scene, slot);
+    batch->depth = MAX(batch->depth, depth);
+
+    return handle;
+}
+
+internal void scene_remove(Scene *scene, Scene_Handle handle) {
+    Scene_Object *object = &scene->objects[handle - 1];
+    Scene_Batch *batch = &scene->batches[object->batch];
+
+    // The batch's last object moves into the hole to keep it packed.
+    u32 last = batch->first_slot + --batch->count;
+    if (object->slot != last) {
+        Scene_Handle moved = scene->slot_objects[last];
+        scene->instances[object->slot] = scene->instances[last];
+        scene->slot_objects[object->slot] = moved;
+        scene->objects[moved - 1].slot = object->slot;
+        scene_mark_dirty(scene, object->slot);
+    }
+    scene->slot_objects[last] = 0;
+
+    object->next_free = scene->free_object;
+    scene->free_object = handle;
+}
+
+internal void scene_set_offset(Scene *scene, Scene_Handle handle, const f32 offset[2]) {
+    Vk_Sprite_Instance *instance = scene_instance(scene, handle);
+    if (instance->offset[0] == offset[0] && instance->offset[1] == offset[1]) return;
+    instance->offset[0] = offset[0];
+    instance->offset[1] = offset[1];
+    scene_mark_dirty(scene, scene->objects[handle - 1].slot);
+}
+
+internal void scene_set_scale(Scene *scene, Scene_Handle handle, const f32 scale[2]) {
+    Vk_Sprite_Instance *instance = scene_instance(scene, handle);
+    if (instance->scale[0] == scale[0] && instance->scale[1] == scale[1]) return;
+    instance->scale[0] = scale[0];
+    instance->scale[1] = scale[1];
+    scene_mark_dirty(scene, scene->objects[handle - 1].slot);
+}
+
+internal void scene_set_texture(Scene *scene, Scene_Handle handle, Vk_Texture *texture) {
+    Vk_Sprite_Instance *instance = scene_instance(scene, handle);
+    if (instance->texture_index == texture->index) return;
+    instance->texture_index = texture->index;
+    scene_mark_dirty(scene, scene->objects[handle - 1].slot);
+}
+
+internal Vk_Sprite_Instance *scene_instance(Scene *scene, Scene_Handle handle) {
+    ASSERT(handle != 0 && handle <= scene->object_count);
+    return &scene->instances[scene->objects[handle - 1].slot];
+}
+
+internal void scene_mark_dirty(Scene *scene, u32 slot) {
+    scene->dirty[slot / 64] |= 1ull << (slot % 64);
+}
+
+internal void scene_cmd_upload(Scene *scene, Vk_Context *context, VkCommandBuffer command_buffer) {
+    vk_staging_reset(&context->staging); // The previous frame's copies have completed
+
+    // Dirty runs, bridging short clean gaps.
+    u32 region_count = 0;
+    u32 run_start = 0;
+    u32 run_end = 0; // Exclusive, equal to run_start when there's no run
+    b8 full = false;
+    u32 word_count = (scene->slot_count + 63) / 64;
+    for (u32 w = 0; w < word_count && !full; ++w) {
+        u64 bits = scene->dirty[w];
+        while (bits != 0 && !full) {
+            u32 slot = w * 64 + bit_scan_forward_64(bits);
+            bits &= bits - 1;
+
+            if (run_end > run_start && slot <= run_end + SCENE_COALESCE_GAP) {
+                run_end = slot + 1;
+                continue;
+            }
+            if (run_end > run_start) full = !scene_push_run(scene, context, run_start, run_end, &region_count);
+            run_start = slot;
+            run_end = slot + 1;
+        }
+    }
+    if (!full && run_end > run_start) full = !scene_push_run(scene, context, run_start, run_end, &region_count);
+    if (full) LOG_WARNING("Scene changes exceed staging, deferring the rest");
+    if (region_count == 0) return;
+
+    vkCmdCopyBuffer(command_buffer, context->staging.buffer, scene->instance_buffer, region_count, scene->copy_regions);
+    context->stats.scene_copy_regions = region_count;
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+        1, &barrier, 0, NULL, 0, NULL);
+}
+
+internal b8 scene_push_run(Scene *scene, Vk_Context *context, u32 start, u32 end, u32 *region_count) {
+    u64 size = (end - start) * sizeof(Vk_Sprite_Instance);
+    VkDeviceSize offset;
+    u8 *dst = vk_staging_push(&context->staging, size, 16, &offset);
+    if (dst == NULL) return false;
+    memcpy(dst, &scene->instances[start], size);
+
+    VkBufferCopy *region = &scene->copy_regions[(*region_count)++];
+    region->srcOffset = offset;
+    region->dstOffset = start * sizeof(Vk_Sprite_Instance);
+    region->size = size;
+
+    for (u32 slot = start; slot < end; ++slot) scene->dirty[slot / 64] &= ~(1ull << (slot % 64));
+    context->stats.scene_upload_bytes += size;
+    return true;
+}
+
+internal u64 scene_batch_sort_key(Scene *scene, Vk_Context *context, Scene_Batch_Id batch_id) {
+    Scene_Batch *batch = &scene->batches[batch_id];
+    Vk_Pipeline_Id pipeline = vk_select_pipeline(context, batch->pipeline, batch->translucent);
+    u32 texture = scene->instances[batch->first_slot].texture_index;
+    return vk_sort_key(context, batch->layer, batch->translucent, pipeline, texture, batch->depth);
+}
+
+internal void scene_cmd_draw_batch(
+    Scene *scene, Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound, Scene_Batch_Id batch_id) {
+    Scene_Batch *batch = &scene->batches[batch_id];
+    vk_cmd_bind_instances(command_buffer, bound, scene->instance_buffer);
+
+    // Without bindless textures a draw can't cross a texture change.
+    b8 bindless = vk_has_bindless_textures(context);
+    Vk_Pipeline_Id pipeline = vk_select_pipeline(context, batch->pipeline, batch->translucent);
+    u32 end = batch->first_slot + batch->count;
+    u32 start = batch->first_slot;
+    for (u32 slot = start + 1; slot <= end; ++slot) {
+        if (slot < end && (bindless || scene->instances[slot].texture_index == scene->instances[start].texture_index)) {
+            continue;
+        }
+        vk_cmd_bind_texture(context, command_buffer, bound, scene->instances[start].texture_index);
+        vk_cmd_draw_sprites(context, command_buffer, bound, pipeline, batch->mesh, start, slot - start);
+        start = slot;
+    }
+    context->stats.scene_count += batch->count;
+}
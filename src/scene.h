@@ -0,0 +1,99 @@
+#pragma once
+
+// Retained Scene
+// -----------------------------------------------------------------------------
+
+// Sprites that persist between frames live in a device-local instance buffer
+// instead of being rebuilt every frame. Changes only mark their slots dirty;
+// when the frame is recorded, dirty slots are coalesced into ranges, copied
+// through staging and scattered into place with one vkCmdCopyBuffer, so the
+// bytes uploaded follow how much changed rather than the scene size.
+//
+// Objects are grouped into batches that share a mesh, pipeline and layer. A
+// batch owns a fixed range of slots and keeps its objects packed at the front,
+// so it draws as one instanced call (one per texture run without bindless
+// textures). Batches sort among the frame's items as single items, keyed by
+// their layer, pipeline and the farthest depth any of their objects was added
+// with; inside a batch, objects draw in slot order. So a translucent batch
+// blends correctly against everything outside it, but overlapping objects
+// within it only do if they were added back to front. Retained sprites aren't
+// culled.
+
+#define MAX_SCENE_BATCHES 64
+
+// A run of clean slots at most this long is copied along with the dirty ones
+// around it, trading a few bytes for fewer copy regions.
+#define SCENE_COALESCE_GAP 4
+
+typedef u32 Scene_Handle; // 0 is never a valid handle
+typedef u32 Scene_Batch_Id;
+
+struct Scene_Batch {
+    Vk_Mesh *mesh;
+    Vk_Pipeline_Id pipeline; // 0 for the default, as with Vk_Draw_Item
+    b8 translucent;
+    u8 layer;
+    f32 depth; // Farthest depth an object was added with, for sorting
+
+    u32 first_slot;
+    u32 capacity;
+    u32 count;
+};
+
+struct Scene_Object {
+    Scene_Batch_Id batch;
+    u32 slot;      // Absolute, in the instance buffer
+    u32 next_free; // Handle of the next free object while on the free list
+};
+
+struct Scene {
+    VkBuffer instance_buffer;
+    VkDeviceMemory instance_memory;
+
+    // What the GPU copy will hold once the dirty slots are uploaded.
+    Vk_Sprite_Instance *instances;
+    Scene_Handle *slot_objects;
+    u64 *dirty; // One bit per slot
+    u32 slot_capacity;
+    u32 slot_count; // Handed out to batches so far
+
+    Scene_Object *objects; // Indexed by handle - 1
+    u32 object_count;
+    u32 free_object; // 0 when the free list is empty
+
+    Scene_Batch batches[MAX_SCENE_BATCHES];
+    u32 batch_count;
+
+    VkBufferCopy *copy_regions; // Scratch for scene_cmd_upload
+};
+
+internal Scene *scene_create(Vk_Context *context, u32 slot_capacity);
+internal void scene_destroy(Scene *scene, Vk_Context *context);
+
+internal Scene_Batch_Id scene_create_batch(
+    Scene *scene, Vk_Mesh *mesh, u32 capacity, u8 layer, b8 translucent, Vk_Pipeline_Id pipeline);
+
+// Returns 0 when the batch is full.
+internal Scene_Handle scene_add(
+    Scene *scene, Scene_Batch_Id batch, const f32 offset[2], const f32 scale[2], Vk_Texture *texture, f32 depth);
+internal void scene_remove(Scene *scene, Scene_Handle handle);
+
+internal void scene_set_offset(Scene *scene, Scene_Handle handle, const f32 offset[2]);
+internal void scene_set_scale(Scene *scene, Scene_Handle handle, const f32 scale[2]);
+internal void scene_set_texture(Scene *scene, Scene_Handle handle, Vk_Texture *texture);
+
+// Recorded by vk_record_command_buffer, before any pass reads the instances.
+// Slots that don't fit in staging stay dirty for the next frame.
+internal void scene_cmd_upload(Scene *scene, Vk_Context *context, VkCommandBuffer command_buffer);
+
+// Batches are drawn from vk_cmd_draw_items, in the order of their sort keys.
+internal u64 scene_batch_sort_key(Scene *scene, Vk_Context *context, Scene_Batch_Id batch_id);
+internal void scene_cmd_draw_batch(
+    Scene *scene, Vk_Context *context, VkCommandBuffer command_buffer, Vk_Bind_State *bound, Scene_Batch_Id batch_id);
+
+internal Vk_Sprite_Instance *scene_instance(Scene *scene, Scene_Handle handle);
+internal void scene_mark_dirty(Scene *scene, u32 slot);
+
+// Copies slots [start, end) through staging and clears their dirty bits.
+// Returns false if staging is full.
+internal b8 scene_push_run(Scene *scene, Vk_Context *context, u32 start, u32 end, u32 *region_count);
@@ -0,0 +1,87 @@
+// -----------------------------------------------------------------------------
+
+internal void sort_radix(Job_System *jobs, Sort_Entry *entries, Sort_Entry *scratch, u32 count) {
+    if (count < 2) return;
+
+    // One read of the keys tells which passes would move anything.
+    u32 byte_counts[8][256] = {};
+    for (u32 i = 0; i < count; ++i) {
+        u64 key = entries[i].key;
+        for (u32 byte = 0; byte < 8; ++byte) {
+            byte_counts[byte][(key >> (byte * 8)) & 0xff]++;
+        }
+    }
+
+    u32 task_count = 1;
+    if (jobs) task_count = CLAMP(1, count / SORT_MIN_TASK_ENTRIES, MIN(jobs->thread_count + 1, SORT_MAX_TASKS));
+
+    Sort_Task tasks[SORT_MAX_TASKS];
+    u32 chunk = (count + task_count - 1) / task_count;
+    for (u32 t = 0; t < task_count; ++t) {
+        tasks[t].begin = MIN(t * chunk, count);
+        tasks[t].end = MIN(tasks[t].begin + chunk, count);
+    }
+
+    Sort_Entry *src = entries;
+    Sort_Entry *dst = scratch;
+    for (u32 byte = 0; byte < 8; ++byte) {
+        u32 shift = byte * 8;
+        if (byte_counts[byte][(src[0].key >> shift) & 0xff] == count) continue;
+
+        for (u32 t = 0; t < task_count; ++t) {
+            tasks[t].src = src;
+            tasks[t].dst = dst;
+            tasks[t].shift = shift;
+        }
+
+        if (task_count == 1) {
+            sort_count_job(&tasks[0]);
+        } else {
+            Job_Counter counter{};
+            for (u32 t = 0; t < task_count; ++t) job_submit(jobs, sort_count_job, &tasks[t], &counter);
+            job_wait(jobs, &counter);
+        }
+
+        // Bucket by bucket, chunk by chunk, so earlier chunks land first.
+        u32 offset = 0;
+        for (u32 bucket = 0; bucket < 256; ++bucket) {
+            for (u32 t = 0; t < task_count; ++t) {
+                u32 bucket_count = tasks[t].offsets[bucket];
+                tasks[t].offsets[bucket] = offset;
+                offset += bucket_count;
+            }
+        }
+
+        if (task_count == 1) {
+            sort_scatter_job(&tasks[0]);
+        } else {
+            Job_Counter counter{};
+            for (u32 t = 0; t < task_count; ++t) job_submit(jobs, sort_scatter_job, &tasks[t], &counter);
+            job_wait(jobs, &counter);
+        }
+
+        Sort_Entry *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != entries) memcpy(entries, src, count * sizeof(Sort_Entry));
+}
+
+internal void sort_count_job(void *data) {
+    auto task = (Sort_Task *)data;
+
+    memset(task->offsets, 0, sizeof(task->offsets));
+    for (u32 i = task->begin; i < task->end; ++i) {
+        task->offsets[(task->src[i].key >> task->shift) & 0xff]++;
+    }
+}
+
+internal void sort_scatter_job(void *data) {
+    auto task = (Sort_Task *)data;
+
+    for (u32 i = task->begin; i < task->end; ++i) {
+        Sort_Entry entry = task->src[i];
+        task->dst[task->offsets[(entry.key >> task->shift) & 0xff]++] = entry;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Radix Sort
+// -----------------------------------------------------------------------------
+
+// Stable LSD radix sort of 64-bit keys, one byte per pass. Passes where every
+// key has the same byte are skipped, so keys that only use their top and
+// bottom bits cost less than eight passes.
+//
+// Large inputs are split into contiguous chunks, one job each: every pass
+// counts the chunks in parallel, turns the counts into per-chunk offsets, and
+// scatters the chunks in parallel. Chunks are scattered in order, so the
+// parallel sort is stable too.
+
+#define SORT_MAX_TASKS          16
+#define SORT_MIN_TASK_ENTRIES   4096 // Below this a job costs more than it saves
+
+struct Sort_Entry {
+    u64 key;
+    u32 value;
+};
+
+struct Sort_Task {
+    Sort_Entry *src;
+    Sort_Entry *dst;
+    u32 begin;
+    u32 end;
+    u32 shift;
+    u32 offsets[256]; // Counts, then where this chunk's entries go in dst
+};
+
+// scratch must hold count entries. The result ends up in entries.
+internal void sort_radix(Job_System *jobs, Sort_Entry *entries, Sort_Entry *scratch, u32 count);
+
+internal void sort_count_job(void *data);
+internal void sort_scatter_job(void *data);
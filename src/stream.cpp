@@ -0,0 +1,401 @@
+// Asset Streaming
+// -----------------------------------------------------------------------------
+
+internal Streamer *stream_init(Job_System *jobs, Asset_Pack *pack) {
+    auto streamer = new Streamer{};
+    streamer->jobs = jobs;
+    streamer->pack = pack;
+    streamer->requests = new Stream_Request[MAX_STREAM_REQUESTS]{};
+    streamer->upload_budget = STREAM_UPLOAD_BUDGET;
+    return streamer;
+}
+
+internal void stream_init_uploads(Streamer *streamer, Vk_Context *context) {
+    vk_create_staging_buffer(context, STREAM_STAGING_SIZE, &streamer->staging);
+    VK_NAME(context, VK_OBJECT_TYPE_BUFFER, streamer->staging.buffer, "stream staging");
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = context->command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+    VK_CHECK(vkAllocateCommandBuffers(context->device, &alloc_info, &streamer->command_buffer));
+    VK_NAME(context, VK_OBJECT_TYPE_COMMAND_BUFFER, streamer->command_buffer, "stream upload");
+
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VK_CHECK(vkCreateFence(context->device, &fence_info, context->allocator, &streamer->upload_fence));
+    VK_NAME(context, VK_OBJECT_TYPE_FENCE, streamer->upload_fence, "stream upload");
+}
+
+internal void stream_cleanup(Streamer *streamer, Vk_Context *context) {
+    job_wait(streamer->jobs, &streamer->pending_jobs);
+
+    if (streamer->upload_in_flight) {
+        VK_CHECK(vkWaitForFences(context->device, 1, &streamer->upload_fence, VK_TRUE, UINT64_MAX));
+    }
+
+    for (u32 i = 0; i < streamer->request_count; ++i) {
+        Stream_Request *request = &streamer->requests[i];
+        if (request->texture.image != VK_NULL_HANDLE) vk_cleanup_texture(context, &request->texture);
+        if (request->mesh.vertex_buffer != VK_NULL_HANDLE) vk_cleanup_mesh(context, &request->mesh);
+        delete[] request->data;
+    }
+
+    vkDestroyFence(context->device, streamer->upload_fence, context->allocator);
+    vkFreeCommandBuffers(context->device, context->command_pool, 1, &streamer->command_buffer);
+    vk_cleanup_staging_buffer(context, &streamer->staging);
+
+    delete[] streamer->requests;
+    delete streamer;
+}
+
+internal Stream_Handle stream_request(Streamer *streamer, const char *name, Stream_Kind kind, Stream_Priority priority) {
+    u64 name_hash = asset_hash_name(name);
+    for (u32 i = 0; i < streamer->request_count; ++i) {
+        Stream_Request *request = &streamer->requests[i];
+        if (request->name_hash == name_hash && request->kind == kind) {
+            stream_set_priority(streamer, i + 1, MAX(request->priority, priority));
+            return i + 1;
+        }
+    }
+
+    if (streamer->request_count == MAX_STREAM_REQUESTS) {
+        LOG_ERROR("Too many stream requests, %s is never going to load", name);
+        return 0;
+    }
+
+    u64 name_length = strlen(name);
+    if (name_length >= sizeof(streamer->requests[0].name)) {
+        LOG_ERROR("Asset name is too long: %s", name);
+        return 0;
+    }
+
+    Stream_Handle handle;
+    {
+        std::lock_guard<std::mutex> lock(streamer->mutex);
+        Stream_Request *request = &streamer->requests[streamer->request_count];
+        memcpy(request->name, name, name_length + 1);
+        request->name_hash = name_hash;
+        request->kind = kind;
+        request->priority = priority;
+        request->distance = 0.0f;
+        request->state.store(STREAM_STATE_QUEUED, std::memory_order_relaxed);
+        handle = ++streamer->request_count;
+    }
+
+    // Each job loads whichever queued request is most important when it
+    // starts, so priorities set after the request still take effect.
+    job_submit(streamer->jobs, stream_load_job, streamer, &streamer->pending_jobs);
+
+    return handle;
+}
+
+internal Stream_Handle stream_request_texture(Streamer *streamer, const char *name, Stream_Priority priority) {
+    return stream_request(streamer, name, STREAM_KIND_TEXTURE, priority);
+}
+
+internal Stream_Handle stream_request_mesh(Streamer *streamer, const char *name, Stream_Priority priority) {
+    return stream_request(streamer, name, STREAM_KIND_MESH, priority);
+}
+
+internal void stream_set_priority(Streamer *streamer, Stream_Handle handle, Stream_Priority priority) {
+    if (handle == 0 || handle > streamer->request_count) return;
+    std::lock_guard<std::mutex> lock(streamer->mutex);
+    streamer->requests[handle - 1].priority = priority;
+}
+
+internal void stream_set_distance(Streamer *streamer, Stream_Handle handle, f32 distance) {
+    if (handle == 0 || handle > streamer->request_count) return;
+    std::lock_guard<std::mutex> lock(streamer->mutex);
+    streamer->requests[handle - 1].distance = distance;
+}
+
+internal Stream_State stream_state(Streamer *streamer, Stream_Handle handle) {
+    if (handle == 0 || handle > streamer->request_count) return STREAM_STATE_FAILED;
+    return (Stream_State)streamer->requests[handle - 1].state.load(std::memory_order_acquire);
+}
+
+internal Vk_Texture *stream_texture(Streamer *streamer, Vk_Context *context, Stream_Handle handle) {
+    if (stream_state(streamer, handle) != STREAM_STATE_RESIDENT) return &context->placeholder_texture;
+    Stream_Request *request = &streamer->requests[handle - 1];
+    ASSERT(request->kind == STREAM_KIND_TEXTURE);
+    return &request->texture;
+}
+
+internal Vk_Mesh *stream_mesh(Streamer *streamer, Vk_Context *context, Stream_Handle handle) {
+    if (stream_state(streamer, handle) != STREAM_STATE_RESIDENT) return &context->quad_mesh;
+    Stream_Request *request = &streamer->requests[handle - 1];
+    ASSERT(request->kind == STREAM_KIND_MESH);
+    return &request->mesh;
+}
+
+internal b8 stream_is_busy(Streamer *streamer) {
+    if (streamer->upload_in_flight) return true;
+    for (u32 i = 0; i < streamer->request_count; ++i) {
+        if (streamer->requests[i].state.load(std::memory_order_relaxed) == STREAM_STATE_DECODED) return true;
+    }
+    return false;
+}
+
+internal b8 stream_is_before(Stream_Request *a, Stream_Request *b) {
+    if (a->priority != b->priority) return a->priority > b->priority;
+    return a->distance < b->distance;
+}
+
+internal void stream_update(Streamer *streamer, Vk_Context *context) {
+    if (streamer->upload_in_flight) {
+        // The staging buffer is reused by the next batch, so nothing new goes
+        // out until the previous copies have landed.
+        if (vkGetFenceStatus(context->device, streamer->upload_fence) != VK_SUCCESS) return;
+
+        for (u32 i = 0; i < streamer->request_count; ++i) {
+            Stream_Request *request = &streamer->requests[i];
+            if (request->state.load(std::memory_order_relaxed) != STREAM_STATE_UPLOADING) continue;
+
+            delete[] request->data;
+            request->data = NULL;
+            request->state.store(STREAM_STATE_RESIDENT, std::memory_order_release);
+        }
+
+        VK_CHECK(vkResetFences(context->device, 1, &streamer->upload_fence));
+        vk_staging_reset(&streamer->staging);
+        streamer->upload_in_flight = false;
+    }
+
+    u64 uploaded_bytes = 0;
+    u32 uploaded_count = 0;
+    for (;;) {
+        // Priorities are only written on this thread, so no lock is needed to read them.
+        Stream_Request *request = NULL;
+        for (u32 i = 0; i < streamer->request_count; ++i) {
+            Stream_Request *candidate = &streamer->requests[i];
+            if (candidate->state.load(std::memory_order_acquire) != STREAM_STATE_DECODED) continue;
+            if (request == NULL || stream_is_before(candidate, request)) request = candidate;
+        }
+        if (request == NULL) break;
+
+        if (uploaded_count > 0 && uploaded_bytes + request->data_size > streamer->upload_budget) break;
+
+        VkDeviceSize offset;
+        u8 *dst = vk_staging_push(&streamer->staging, request->data_size, 16, &offset);
+        if (dst == NULL) {
+            if (uploaded_count > 0) break;
+
+            LOG_ERROR("%s is larger than the streaming staging buffer", request->name);
+            delete[] request->data;
+            request->data = NULL;
+            request->state.store(STREAM_STATE_FAILED, std::memory_order_release);
+            continue;
+        }
+        memcpy(dst, request->data, request->data_size);
+
+        if (uploaded_count == 0) {
+            VK_CHECK(vkResetCommandBuffer(streamer->command_buffer, 0));
+
+            VkCommandBufferBeginInfo begin_info{};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            VK_CHECK(vkBeginCommandBuffer(streamer->command_buffer, &begin_info));
+        }
+
+        switch (request->kind) {
+            case STREAM_KIND_TEXTURE:
+                vk_create_texture(context, request->width, request->height, &request->texture);
+                VK_NAME(context, VK_OBJECT_TYPE_IMAGE, request->texture.image, request->name);
+                vk_cmd_upload_texture(streamer->command_buffer, streamer->staging.buffer, offset, &request->texture);
+                break;
+
+            case STREAM_KIND_MESH: {
+                vk_create_mesh(context, request->vertex_count, request->index_count, &request->mesh);
+                request->mesh.extent[0] = request->mesh_extent[0];
+                request->mesh.extent[1] = request->mesh_extent[1];
+                VK_NAME(context, VK_OBJECT_TYPE_BUFFER, request->mesh.vertex_buffer, request->name);
+                VK_NAME(context, VK_OBJECT_TYPE_BUFFER, request->mesh.index_buffer, request->name);
+                VkDeviceSize index_offset = offset + request->vertex_count * sizeof(Vk_Vertex);
+                vk_cmd_upload_mesh(
+                    streamer->command_buffer, streamer->staging.buffer, offset, index_offset, &request->mesh);
+            } break;
+        }
+
+        request->state.store(STREAM_STATE_UPLOADING, std::memory_order_relaxed);
+        uploaded_bytes += request->data_size;
+        uploaded_count++;
+    }
+
+    if (uploaded_count > 0) {
+        vk_count_upload(context, uploaded_bytes);
+        VK_CHECK(vkEndCommandBuffer(streamer->command_buffer));
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &streamer->command_buffer;
+        VK_CHECK(vkQueueSubmit(context->graphics_queue, 1, &submit_info, streamer->upload_fence));
+
+        streamer->upload_in_flight = true;
+    }
+}
+
+// Worker side
+// -----------------------------------------------------------------------------
+
+internal void stream_load_job(void *data) {
+    auto streamer = (Streamer *)data;
+
+    Stream_Request *request = NULL;
+    {
+        std::lock_guard<std::mutex> lock(streamer->mutex);
+        for (u32 i = 0; i < streamer->request_count; ++i) {
+            Stream_Request *candidate = &streamer->requests[i];
+            if (candidate->state.load(std::memory_order_relaxed) != STREAM_STATE_QUEUED) continue;
+            if (request == NULL || stream_is_before(candidate, request)) request = candidate;
+        }
+        if (request == NULL) return;
+        request->state.store(STREAM_STATE_LOADING, std::memory_order_relaxed);
+    }
+
+    u64 start_ns = time_now_ns();
+    b8 loaded = stream_load(streamer, request);
+    startup_record(request->name, start_ns);
+
+    if (loaded) {
+        request->state.store(STREAM_STATE_DECODED, std::memory_order_release);
+
+        Stream_Wake_Proc *wake = streamer->wake.load(std::memory_order_acquire);
+        if (wake) wake();
+    } else {
+        LOG_WARNING("Failed to stream %s", request->name);
+        request->state.store(STREAM_STATE_FAILED, std::memory_order_release);
+    }
+}
+
+internal b8 stream_load(Streamer *streamer, Stream_Request *request) {
+    const Asset_Pack_Entry *entry = NULL;
+    if (streamer->pack) entry = asset_pack_find_hash(streamer->pack, request->name_hash);
+
+    if (entry) {
+        // Uncompressed entries decode straight out of the mapping.
+        if (entry->compression == ASSET_COMPRESSION_NONE) {
+            return stream_decode(request, asset_pack_data(streamer->pack, entry), entry->size);
+        }
+
+        auto buffer = new u8[entry->size];
+        b8 ok = asset_pack_read(streamer->pack, entry, buffer) && stream_decode(request, buffer, entry->size);
+        delete[] buffer;
+        return ok;
+    }
+
+    File_Mapping file;
+    if (!file_map(request->name, &file)) return false;
+    b8 ok = stream_decode(request, file.data, file.size);
+    file_unmap(&file);
+    return ok;
+}
+
+internal b8 stream_decode(Stream_Request *request, const u8 *src, u64 src_size) {
+    switch (request->kind) {
+        case STREAM_KIND_TEXTURE: return stream_decode_tga(request, src, src_size);
+        case STREAM_KIND_MESH:    return stream_decode_mesh(request, src, src_size);
+    }
+    return false;
+}
+
+internal b8 stream_decode_tga(Stream_Request *request, const u8 *src, u64 src_size) {
+    if (src_size < 18) return false;
+
+    u8 id_length = src[0];
+    u8 color_map_type = src[1];
+    u8 image_type = src[2];
+    u32 width = src[12] | (src[13] << 8);
+    u32 height = src[14] | (src[15] << 8);
+    u32 bytes_per_pixel = src[16] / 8;
+    b8 top_down = (src[17] & 0x20) != 0;
+    b8 rle = image_type == 10;
+
+    if (color_map_type != 0 || (image_type != 2 && image_type != 10) ||
+        (bytes_per_pixel != 3 && bytes_per_pixel != 4) || width == 0 || height == 0) {
+        return false;
+    }
+
+    const u8 *ip = src + 18 + id_length;
+    const u8 *ip_end = src + src_size;
+    if (ip > ip_end) return false;
+
+    u64 pixel_count = (u64)width * height;
+    auto pixels = new u8[pixel_count * 4];
+
+    u8 color[4] = {0, 0, 0, 255};
+    u64 i = 0;
+    while (i < pixel_count) {
+        u64 run = pixel_count - i;
+        b8 repeat = false;
+        if (rle) {
+            if (ip >= ip_end) break;
+            u8 packet = *ip++;
+            run = MIN((u64)(packet & 0x7f) + 1, pixel_count - i);
+            repeat = (packet & 0x80) != 0;
+        }
+
+        u64 needed = (repeat ? 1 : run) * bytes_per_pixel;
+        if ((u64)(ip_end - ip) < needed) break;
+
+        for (u64 r = 0; r < run; ++r, ++i) {
+            if (!repeat || r == 0) {
+                color[0] = ip[2]; // Stored as BGR(A)
+                color[1] = ip[1];
+                color[2] = ip[0];
+                color[3] = bytes_per_pixel == 4 ? ip[3] : 255;
+                ip += bytes_per_pixel;
+            }
+
+            u64 x = i % width;
+            u64 y = i / width;
+            if (!top_down) y = height - 1 - y;
+            memcpy(&pixels[(y * width + x) * 4], color, 4);
+        }
+    }
+
+    if (i < pixel_count) {
+        delete[] pixels;
+        return false;
+    }
+
+    request->data = pixels;
+    request->data_size = pixel_count * 4;
+    request->width = width;
+    request->height = height;
+    return true;
+}
+
+internal b8 stream_decode_mesh(Stream_Request *request, const u8 *src, u64 src_size) {
+    if (src_size < sizeof(Stream_Mesh_Header)) return false;
+
+    Stream_Mesh_Header header;
+    memcpy(&header, src, sizeof(header));
+
+    u64 vertex_size = (u64)header.vertex_count * sizeof(Vk_Vertex);
+    u64 index_size = (u64)header.index_count * sizeof(u32);
+    if (header.magic != STREAM_MESH_MAGIC || header.vertex_count == 0 || header.index_count == 0 ||
+        sizeof(header) + vertex_size + index_size != src_size) {
+        return false;
+    }
+
+    auto data = new u8[vertex_size + index_size];
+    memcpy(data, src + sizeof(header), vertex_size + index_size);
+
+    auto indices = (const u32 *)(data + vertex_size);
+    for (u32 i = 0; i < header.index_count; ++i) {
+        if (indices[i] >= header.vertex_count) {
+            delete[] data;
+            return false;
+        }
+    }
+
+    request->data = data;
+    request->data_size = vertex_size + index_size;
+    request->vertex_count = header.vertex_count;
+    request->index_count = header.index_count;
+    vk_compute_mesh_extent((const Vk_Vertex *)data, header.vertex_count, request->mesh_extent);
+    return true;
+}
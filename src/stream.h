@@ -0,0 +1,129 @@
+#pragma once
+
+// Asset Streaming
+// -----------------------------------------------------------------------------
+
+// Requests return a handle immediately. Worker jobs read the asset (from the
+// pack, falling back to a loose file) and decode it to GPU-ready bytes, then
+// stream_update uploads a budgeted amount per frame on the main thread. Until
+// an asset is resident, lookups return the context's placeholder texture or
+// quad mesh.
+//
+// Supported sources:
+//   textures: uncompressed or RLE TGA, 24 or 32 bpp
+//   meshes:   Stream_Mesh_Header, Vk_Vertex[vertex_count], u32[index_count]
+
+#define STREAM_MESH_MAGIC 0x48534D56 // "VMSH"
+
+struct Stream_Mesh_Header {
+    u32 magic;
+    u32 vertex_count;
+    u32 index_count;
+    u32 reserved;
+};
+
+typedef u32 Stream_Handle; // 0 is never a valid handle
+
+// Called from worker threads when an asset is ready to upload, e.g. to wake a
+// main loop that is blocked waiting for events.
+typedef void Stream_Wake_Proc(void);
+
+enum Stream_Kind : u32 {
+    STREAM_KIND_TEXTURE,
+    STREAM_KIND_MESH,
+};
+
+enum Stream_State : u32 {
+    STREAM_STATE_QUEUED,    // Waiting for a worker
+    STREAM_STATE_LOADING,   // A worker is reading and decoding it
+    STREAM_STATE_DECODED,   // Waiting for upload budget
+    STREAM_STATE_UPLOADING, // Copy submitted, waiting on the upload fence
+    STREAM_STATE_RESIDENT,
+    STREAM_STATE_FAILED,
+};
+
+// Higher classes always go first; within a class, nearer assets go first.
+enum Stream_Priority : u32 {
+    STREAM_PRIORITY_LOW,
+    STREAM_PRIORITY_NORMAL,
+    STREAM_PRIORITY_HIGH,
+    STREAM_PRIORITY_CRITICAL,
+};
+
+struct Stream_Request {
+    char name[128];
+    u64 name_hash;
+    Stream_Kind kind;
+    std::atomic<u32> state;
+
+    // Guarded by Streamer::mutex while workers may be picking requests.
+    Stream_Priority priority;
+    f32 distance;
+
+    // Written by the worker before it publishes STREAM_STATE_DECODED, freed
+    // once the upload completes.
+    u8 *data;
+    u64 data_size;
+    u32 width;
+    u32 height;
+    u32 vertex_count;
+    u32 index_count;
+    f32 mesh_extent[2];
+
+    Vk_Texture texture;
+    Vk_Mesh mesh;
+};
+
+struct Streamer {
+    Job_System *jobs;
+    Asset_Pack *pack; // May be NULL, then only loose files are used
+    Job_Counter pending_jobs;
+    std::atomic<Stream_Wake_Proc *> wake;
+
+    std::mutex mutex;
+    Stream_Request *requests;
+    u32 request_count;
+
+    Vk_Staging_Buffer staging;
+    VkCommandBuffer command_buffer;
+    VkFence upload_fence;
+    b8 upload_in_flight;
+    u64 upload_budget;
+};
+
+// Requests can be made right after stream_init, so assets decode while the
+// GPU is still coming up. Uploads start once stream_init_uploads has run.
+internal Streamer *stream_init(Job_System *jobs, Asset_Pack *pack);
+internal void stream_init_uploads(Streamer *streamer, Vk_Context *context);
+internal void stream_cleanup(Streamer *streamer, Vk_Context *context);
+
+// Requesting the same name again returns the existing handle.
+internal Stream_Handle stream_request_texture(Streamer *streamer, const char *name, Stream_Priority priority);
+internal Stream_Handle stream_request_mesh(Streamer *streamer, const char *name, Stream_Priority priority);
+
+internal void stream_set_priority(Streamer *streamer, Stream_Handle handle, Stream_Priority priority);
+
+// Distance from the camera, in any unit; within a priority nearer requests
+// are decoded and uploaded first.
+internal void stream_set_distance(Streamer *streamer, Stream_Handle handle, f32 distance);
+
+internal Stream_State stream_state(Streamer *streamer, Stream_Handle handle);
+
+// True while decoded assets are waiting for upload or an upload is in
+// flight, i.e. while stream_update still has work to do every frame.
+internal b8 stream_is_busy(Streamer *streamer);
+
+// Never NULL: falls back to the placeholder texture / quad mesh.
+internal Vk_Texture *stream_texture(Streamer *streamer, Vk_Context *context, Stream_Handle handle);
+internal Vk_Mesh *stream_mesh(Streamer *streamer, Vk_Context *context, Stream_Handle handle);
+
+// Call once per frame on the main thread, before recording draws.
+internal void stream_update(Streamer *streamer, Vk_Context *context);
+
+internal Stream_Handle stream_request(Streamer *streamer, const char *name, Stream_Kind kind, Stream_Priority priority);
+internal b8 stream_is_before(Stream_Request *a, Stream_Request *b);
+internal b8 stream_load(Streamer *streamer, Stream_Request *request);
+internal b8 stream_decode(Stream_Request *request, const u8 *src, u64 src_size);
+internal b8 stream_decode_tga(Stream_Request *request, const u8 *src, u64 src_size);
+internal b8 stream_decode_mesh(Stream_Request *request, const u8 *src, u64 src_size);
+internal void stream_load_job(void *data);
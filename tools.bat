@@ -0,0 +1,30 @@
+@echo off
+setlocal
+
+rem Builds the command line tools into bin\
+
+if not exist .\bin mkdir .\bin
+cd .\bin
+
+set cl_include=/I"..\src" /I"%VULKAN_SDK%\Include" /I"..\thirdparty\glfw\include"
+set cl_libpath=/LIBPATH:"%VULKAN_SDK%\Lib" /LIBPATH:"..\thirdparty\glfw\lib"
+set cl_libfile=vulkan-1.lib glfw3.lib user32.lib gdi32.lib shell32.lib
+
+call cl ..\tools\spirv_embed.cpp /nologo /MD /I"..\src" /link /INCREMENTAL:NO /OUT:spirv_embed.exe
+call cl ..\tools\asset_pack.cpp /nologo /O2 /MD /I"..\src" /link /INCREMENTAL:NO /OUT:asset_pack.exe
+
+rem The benchmark never creates shader modules, so it doesn't need the
+rem generated shader header.
+call cl ..\tools\asset_bench.cpp /nologo /O2 /MD /DSHADER_HOT_RELOAD=1 %cl_include% /link /INCREMENTAL:NO /OUT:asset_bench.exe %cl_libpath% %cl_libfile%
+
+rem CPU microbenchmarks; optimized and without asserts so they time what ships.
+call cl ..\tools\micro_bench.cpp /nologo /O2 /MD /DBUILD_DEBUG=0 /DSHADER_HOT_RELOAD=1 %cl_include% /link /INCREMENTAL:NO /OUT:micro_bench.exe %cl_libpath% %cl_libfile%
+
+rem The render benchmark embeds the shaders, so run.bat has to have generated
+rem src\generated\shaders.h first. Built without validation, like release.
+call cl ..\tools\render_bench.cpp /nologo /O2 /MD /DBUILD_DEBUG=0 %cl_include% /link /INCREMENTAL:NO /OUT:render_bench.exe %cl_libpath% %cl_libfile%
+
+rem Same benchmark in the debug profile, to measure what validation costs.
+call cl ..\tools\render_bench.cpp /nologo /O2 /MD %cl_include% /link /INCREMENTAL:NO /OUT:render_bench_debug.exe %cl_libpath% %cl_libfile%
+
+endlocal
@@ -0,0 +1,153 @@
+// Measures how fast an asset pack loads into persistently mapped Vulkan
+// staging memory, once with a cold page cache and then repeatedly warm.
+//
+// Usage: asset_bench <archive.pak> [warm_iterations]
+
+#include "main.h"
+
+#include "base.cpp"
+#include "job.cpp"
+#include "sort.cpp"
+#include "gfx.cpp"
+#include "graph.cpp"
+#include "asset.cpp"
+#include "stream.cpp"
+#include "scene.cpp"
+#include "app.cpp"
+
+// Staging memory only needs a device, not a window or swapchain.
+internal Vk_Context *bench_create_context() {
+    auto context = new Vk_Context{};
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "asset_bench";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+    VK_CHECK(vkCreateInstance(&instance_info, context->allocator, &context->instance));
+
+    u32 physical_device_count = 1;
+    VkResult result = vkEnumeratePhysicalDevices(context->instance, &physical_device_count, &context->physical_device);
+    ASSERT(result == VK_SUCCESS || result == VK_INCOMPLETE);
+    ASSERT(physical_device_count > 0);
+
+    f32 queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    VK_CHECK(vkCreateDevice(context->physical_device, &device_info, context->allocator, &context->device));
+
+    return context;
+}
+
+internal void bench_cleanup_context(Vk_Context *context) {
+    vkDestroyDevice(context->device, context->allocator);
+    vkDestroyInstance(context->instance, context->allocator);
+    delete context;
+}
+
+// Opens the pack and reads every entry into staging, returning elapsed ns.
+internal u64 bench_load_pack(const char *path, Vk_Staging_Buffer *staging, u64 *bytes) {
+    u64 start = time_now_ns();
+
+    Asset_Pack pack;
+    if (!asset_pack_open(&pack, path)) LOG_FATAL("Failed to open %s", path);
+
+    *bytes = 0;
+    for (u32 i = 0; i < pack.header->entry_count; ++i) {
+        const Asset_Pack_Entry *entry = &pack.entries[i];
+
+        VkDeviceSize offset;
+        u8 *dst = vk_staging_push(staging, entry->size, ASSET_PACK_ALIGNMENT, &offset);
+        if (dst == NULL) {
+            // Nothing is copied to the GPU here, so wrapping around is safe.
+            vk_staging_reset(staging);
+            dst = vk_staging_push(staging, entry->size, ASSET_PACK_ALIGNMENT, &offset);
+            ASSERT(dst != NULL);
+        }
+
+        if (!asset_pack_read(&pack, entry, dst)) LOG_FATAL("Corrupt entry %u", i);
+        *bytes += entry->size;
+    }
+
+    asset_pack_close(&pack);
+    vk_staging_reset(staging);
+
+    return time_now_ns() - start;
+}
+
+internal s32 bench_compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <archive.pak> [warm_iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[1];
+    u32 warm_iterations = argc > 2 ? (u32)atoi(argv[2]) : 10;
+    warm_iterations = MAX(warm_iterations, 1);
+
+    u64 largest_entry = 0;
+    u64 stored_bytes = 0;
+    u32 compressed_count = 0;
+    u32 entry_count = 0;
+    {
+        Asset_Pack pack;
+        if (!asset_pack_open(&pack, path)) return 1;
+        entry_count = pack.header->entry_count;
+        for (u32 i = 0; i < entry_count; ++i) {
+            largest_entry = MAX(largest_entry, pack.entries[i].size);
+            stored_bytes += pack.entries[i].stored_size;
+            if (pack.entries[i].compression != ASSET_COMPRESSION_NONE) ++compressed_count;
+        }
+        asset_pack_close(&pack);
+    }
+
+    Vk_Context *context = bench_create_context();
+
+    Vk_Staging_Buffer staging;
+    vk_create_staging_buffer(context, MAX(STAGING_BUFFER_SIZE, ALIGN_UP(largest_entry, KB(64))), &staging);
+
+    LOG_INFO("%s: %u entries (%u compressed), %.2f MB stored", path, entry_count, compressed_count,
+        stored_bytes / (f64)MB(1));
+
+    u64 bytes;
+
+    file_evict_cache(path);
+    u64 cold_ns = bench_load_pack(path, &staging, &bytes);
+    LOG_INFO("cold: %8.3f ms  %9.1f MB/s into staging", NS_TO_MS(cold_ns), bytes / (f64)MB(1) / NS_TO_S(cold_ns));
+
+    auto warm_ns = new u64[warm_iterations];
+    for (u32 i = 0; i < warm_iterations; ++i) {
+        warm_ns[i] = bench_load_pack(path, &staging, &bytes);
+    }
+    qsort(warm_ns, warm_iterations, sizeof(u64), bench_compare_u64);
+
+    u64 warm_min = warm_ns[0];
+    u64 warm_median = warm_ns[warm_iterations / 2];
+    LOG_INFO("warm: %8.3f ms  %9.1f MB/s into staging (median of %u, best %.1f MB/s)",
+        NS_TO_MS(warm_median), bytes / (f64)MB(1) / NS_TO_S(warm_median), warm_iterations,
+        bytes / (f64)MB(1) / NS_TO_S(warm_min));
+
+    delete[] warm_ns;
+
+    vk_cleanup_staging_buffer(context, &staging);
+    bench_cleanup_context(context);
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Builds an asset pack (see Asset_Pack in src/asset.h) from loose files.
+//
+// Usage: asset_pack [--lz4] <output.pak> <file>...
+// Entries are named by the path as given on the command line, so run it from
+// the directory the engine resolves asset names against. With --lz4 each entry
+// is compressed, but stored raw when that doesn't make it smaller.
+
+#include "base.h"
+#include "asset.h"
+#include "base.cpp"
+#include "asset.cpp"
+
+struct Pack_Input {
+    const char *name;
+    File_Mapping file;
+    u8 *compressed;
+    Asset_Pack_Entry entry;
+};
+
+internal void pack_write_padding(FILE *out, u64 *at, u64 alignment) {
+    local_persist const u8 zeros[ASSET_PACK_ALIGNMENT] = {};
+    u64 aligned = ALIGN_UP(*at, alignment);
+    fwrite(zeros, 1, aligned - *at, out);
+    *at = aligned;
+}
+
+int main(int argc, char **argv) {
+    b8 use_lz4 = false;
+    s32 arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--lz4") == 0) {
+        use_lz4 = true;
+        ++arg;
+    }
+
+    if (argc - arg < 2) {
+        fprintf(stderr, "Usage: %s [--lz4] <output.pak> <file>...\n", argv[0]);
+        return 1;
+    }
+
+    const char *output_path = argv[arg++];
+    u32 input_count = argc - arg;
+    auto inputs = new Pack_Input[input_count]{};
+
+    u64 total_size = 0;
+    u64 total_stored_size = 0;
+    for (u32 i = 0; i < input_count; ++i) {
+        Pack_Input *input = &inputs[i];
+        input->name = argv[arg + i];
+        if (!file_map(input->name, &input->file)) {
+            LOG_ERROR("Failed to open %s", input->name);
+            return 1;
+        }
+
+        input->entry.name_hash = asset_hash_name(input->name);
+        input->entry.size = input->file.size;
+        input->entry.stored_size = input->file.size;
+        input->entry.compression = ASSET_COMPRESSION_NONE;
+
+        if (use_lz4 && input->file.size > 0) {
+            u64 capacity = lz4_compress_bound(input->file.size);
+            input->compressed = new u8[capacity];
+            u64 compressed_size = lz4_compress(input->file.data, input->file.size, input->compressed, capacity);
+            if (compressed_size > 0 && compressed_size < input->file.size) {
+                input->entry.stored_size = compressed_size;
+                input->entry.compression = ASSET_COMPRESSION_LZ4;
+            } else {
+                delete[] input->compressed;
+                input->compressed = NULL;
+            }
+        }
+
+        total_size += input->entry.size;
+        total_stored_size += input->entry.stored_size;
+    }
+
+    // The table of contents is binary searched by hash at load time.
+    for (u32 i = 1; i < input_count; ++i) {
+        for (u32 j = i; j > 0 && inputs[j - 1].entry.name_hash > inputs[j].entry.name_hash; --j) {
+            Pack_Input tmp = inputs[j];
+            inputs[j] = inputs[j - 1];
+            inputs[j - 1] = tmp;
+        }
+    }
+    for (u32 i = 1; i < input_count; ++i) {
+        if (inputs[i - 1].entry.name_hash == inputs[i].entry.name_hash) {
+            LOG_ERROR("Name hash collision: %s and %s", inputs[i - 1].name, inputs[i].name);
+            return 1;
+        }
+    }
+
+    Asset_Pack_Header header{};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = input_count;
+    header.toc_offset = ALIGN_UP(sizeof(Asset_Pack_Header), ASSET_PACK_ALIGNMENT);
+    header.data_offset = ALIGN_UP(header.toc_offset + input_count * sizeof(Asset_Pack_Entry), ASSET_PACK_ALIGNMENT);
+
+    u64 offset = header.data_offset;
+    for (u32 i = 0; i < input_count; ++i) {
+        inputs[i].entry.offset = offset;
+        offset = ALIGN_UP(offset + inputs[i].entry.stored_size, ASSET_PACK_ALIGNMENT);
+    }
+
+    FILE *out = file_open(output_path, "wb");
+    if (out == NULL) {
+        LOG_ERROR("Failed to open %s for writing", output_path);
+        return 1;
+    }
+
+    u64 at = 0;
+    fwrite(&header, 1, sizeof(header), out);
+    at += sizeof(header);
+
+    pack_write_padding(out, &at, ASSET_PACK_ALIGNMENT);
+    ASSERT(at == header.toc_offset);
+    for (u32 i = 0; i < input_count; ++i) {
+        fwrite(&inputs[i].entry, 1, sizeof(Asset_Pack_Entry), out);
+        at += sizeof(Asset_Pack_Entry);
+    }
+
+    for (u32 i = 0; i < input_count; ++i) {
+        Pack_Input *input = &inputs[i];
+        pack_write_padding(out, &at, ASSET_PACK_ALIGNMENT);
+        ASSERT(at == input->entry.offset);
+
+        const u8 *data = input->compressed ? input->compressed : input->file.data;
+        fwrite(data, 1, input->entry.stored_size, out);
+        at += input->entry.stored_size;
+    }
+
+    fclose(out);
+
+    LOG_INFO("Packed %u file(s) into %s: %.2f MB -> %.2f MB",
+        input_count, output_path, total_size / (f64)MB(1), total_stored_size / (f64)MB(1));
+
+    for (u32 i = 0; i < input_count; ++i) {
+        file_unmap(&inputs[i].file);
+        delete[] inputs[i].compressed;
+    }
+    delete[] inputs;
+
+    return 0;
+}
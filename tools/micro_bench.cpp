@@ -0,0 +1,382 @@
+// Microbenchmarks of the engine's CPU kernels: sorting, batch building,
+// culling, the staging allocator, render graph placement, hashing,
+// compression and camera math. Each one is timed in isolation with the
+// harness in base, logged to stderr and written as JSON to stdout or the
+// --out file.
+//
+// Usage: micro_bench [name filter] [--out results.json]
+
+#include "main.h"
+
+#include "base.cpp"
+#include "job.cpp"
+#include "sort.cpp"
+#include "gfx.cpp"
+#include "graph.cpp"
+#include "asset.cpp"
+#include "stream.cpp"
+#include "scene.cpp"
+#include "app.cpp"
+
+#define MICRO_ITEM_COUNT    MAX_SPRITE_INSTANCES // A full frame of sprites
+#define MICRO_TEXTURE_COUNT 8
+
+// Shared by the benchmarks, set up once in main. The context is only used by
+// the CPU side of drawing, so it has no device.
+global Job_System *micro_jobs;
+global Vk_Context *micro_context;
+global Vk_Mesh micro_mesh;
+global Vk_Texture micro_textures[MICRO_TEXTURE_COUNT];
+global Vk_Draw_Item *micro_items;
+global u64 micro_random_state = 0x9e3779b97f4a7c15ull;
+
+internal u64 micro_random() {
+    // xorshift64, deterministic so runs are comparable.
+    u64 x = micro_random_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    micro_random_state = x;
+    return x;
+}
+
+internal f32 micro_random_range(f32 min, f32 max) {
+    return min + (max - min) * ((micro_random() >> 40) / (f32)(1 << 24));
+}
+
+// Like a frame of the sprite scene: spread over about twice the view, four
+// layers, a quarter translucent.
+internal void micro_create_items() {
+    micro_context = new Vk_Context{};
+    micro_context->camera.zoom = 1.0f;
+    micro_context->depth_format = VK_FORMAT_D32_SFLOAT;
+
+    micro_mesh.extent[0] = 1.0f;
+    micro_mesh.extent[1] = 1.0f;
+    for (u32 t = 0; t < MICRO_TEXTURE_COUNT; ++t) {
+        micro_textures[t].index = t;
+    }
+
+    micro_items = new Vk_Draw_Item[MICRO_ITEM_COUNT]{};
+    for (u32 i = 0; i < MICRO_ITEM_COUNT; ++i) {
+        Vk_Draw_Item *item = &micro_items[i];
+        item->mesh = &micro_mesh;
+        item->texture = &micro_textures[micro_random() % MICRO_TEXTURE_COUNT];
+        item->offset[0] = micro_random_range(-3.0f, 3.0f);
+        item->offset[1] = micro_random_range(-2.0f, 2.0f);
+        item->scale[0] = item->scale[1] = micro_random_range(0.01f, 0.05f);
+        item->layer = (u8)(micro_random() % 4);
+        item->translucent = micro_random() % 4 == 0;
+        item->depth = micro_random_range(0.0f, 1.0f);
+    }
+}
+
+// Sorting
+// -----------------------------------------------------------------------------
+
+// LSD radix sort costs the same whatever the input order, so the entries are
+// sorted again in place instead of being reshuffled every iteration.
+internal void micro_sort(Benchmark_State *state, u32 count) {
+    auto entries = new Sort_Entry[count];
+    auto scratch = new Sort_Entry[count];
+    for (u32 i = 0; i < count; ++i) {
+        entries[i].key = micro_random();
+        entries[i].value = i;
+    }
+
+    state->items = count;
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        sort_radix(micro_jobs, entries, scratch, count);
+        benchmark_clobber_memory();
+    }
+
+    delete[] entries;
+    delete[] scratch;
+}
+
+BENCHMARK(sort_radix_1k) {
+    micro_sort(state, 1024);
+}
+
+BENCHMARK(sort_radix_16k) {
+    micro_sort(state, 16384);
+}
+
+BENCHMARK(sort_radix_256k) {
+    micro_sort(state, 262144);
+}
+
+// Batch Building
+// -----------------------------------------------------------------------------
+
+BENCHMARK(item_sort_keys_16k) {
+    state->items = MICRO_ITEM_COUNT;
+    for (u64 i = 0; i < state->iterations; ++i) {
+        for (u32 j = 0; j < MICRO_ITEM_COUNT; ++j) {
+            benchmark_do_not_optimize(vk_item_sort_key(micro_context, &micro_items[j]));
+        }
+    }
+}
+
+BENCHMARK(item_cull_16k) {
+    VkExtent2D extent = {1280, 720};
+    state->items = MICRO_ITEM_COUNT;
+    for (u64 i = 0; i < state->iterations; ++i) {
+        Vk_Bounds bounds = vk_camera_bounds(&micro_context->camera, extent);
+        u32 visible = 0;
+        for (u32 j = 0; j < MICRO_ITEM_COUNT; ++j) {
+            visible += vk_is_item_visible(&micro_items[j], &bounds);
+        }
+        benchmark_do_not_optimize(visible);
+    }
+}
+
+// What vk_cmd_draw_items does on the CPU before recording: cull, key, sort,
+// then merge runs of items that share their state into one draw each.
+BENCHMARK(batch_build_16k) {
+    VkExtent2D extent = {1280, 720};
+    auto entries = new Sort_Entry[MICRO_ITEM_COUNT];
+    auto scratch = new Sort_Entry[MICRO_ITEM_COUNT];
+
+    state->items = MICRO_ITEM_COUNT;
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        Vk_Bounds bounds = vk_camera_bounds(&micro_context->camera, extent);
+        u32 count = 0;
+        for (u32 j = 0; j < MICRO_ITEM_COUNT; ++j) {
+            Vk_Draw_Item *item = &micro_items[j];
+            if (!vk_is_item_visible(item, &bounds)) continue;
+            entries[count].key = vk_item_sort_key(micro_context, item);
+            entries[count].value = j;
+            count++;
+        }
+        sort_radix(micro_jobs, entries, scratch, count);
+
+        u32 draws = 0;
+        Vk_Draw_Item *previous = NULL;
+        for (u32 j = 0; j < count; ++j) {
+            Vk_Draw_Item *item = &micro_items[entries[j].value];
+            if (!previous || item->mesh != previous->mesh || item->texture != previous->texture ||
+                item->translucent != previous->translucent) {
+                draws++;
+            }
+            previous = item;
+        }
+        benchmark_do_not_optimize(draws);
+    }
+
+    delete[] entries;
+    delete[] scratch;
+}
+
+// Allocators
+// -----------------------------------------------------------------------------
+
+// Sizes of instance and mesh uploads, bump allocated and reset per frame.
+BENCHMARK(staging_push_16k) {
+    Vk_Staging_Buffer staging{};
+    staging.size = MB(8);
+    staging.mapped = new u8[staging.size];
+
+    u32 sizes[256];
+    for (u32 i = 0; i < ARRAY_COUNT(sizes); ++i) {
+        sizes[i] = 24 + (u32)(micro_random() % 232);
+    }
+
+    state->items = MICRO_ITEM_COUNT;
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        for (u32 j = 0; j < MICRO_ITEM_COUNT; ++j) {
+            VkDeviceSize offset;
+            u8 *dst = vk_staging_push(&staging, sizes[j % ARRAY_COUNT(sizes)], 16, &offset);
+            benchmark_do_not_optimize(dst);
+        }
+        vk_staging_reset(&staging);
+    }
+
+    delete[] staging.mapped;
+}
+
+// Render Graph
+// -----------------------------------------------------------------------------
+
+#define MICRO_GRAPH_CHAIN 8
+
+// A chain of post-processing passes, each sampling the previous one's target.
+// Only neighbours overlap, so the targets should ping-pong between two blocks;
+// anything else is a placement bug and fails the run.
+BENCHMARK(graph_place_chain_8) {
+    Render_Graph *graph = graph_create();
+    Graph_Resource_Id backbuffer = graph_import_image(
+        graph, "backbuffer", VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, GRAPH_ACCESS_PRESENT);
+
+    VkDeviceSize target_size = MB(8);
+    Graph_Resource_Id targets[MICRO_GRAPH_CHAIN];
+    for (u32 i = 0; i < MICRO_GRAPH_CHAIN; ++i) {
+        targets[i] = graph_create_image(graph, "target", VK_FORMAT_R8G8B8A8_UNORM, 1.0f);
+        graph->resources[targets[i]].memory_requirements = {target_size, 4096, 1};
+    }
+    for (u32 i = 0; i <= MICRO_GRAPH_CHAIN; ++i) {
+        u32 pass = graph_add_pass(graph, "pass", NULL, NULL);
+        if (i > 0) graph_use(graph, pass, targets[i - 1], GRAPH_ACCESS_SAMPLED);
+        graph_use(graph, pass, i < MICRO_GRAPH_CHAIN ? targets[i] : backbuffer, GRAPH_ACCESS_COLOR_WRITE);
+    }
+
+    state->items = MICRO_GRAPH_CHAIN;
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        graph_compute_lifetimes(graph);
+        graph_place_transients(graph);
+        benchmark_clobber_memory();
+    }
+
+    b8 ping_pong = graph->block_count == 2 && graph->transient_size == 2 * target_size &&
+        graph->unaliased_size == MICRO_GRAPH_CHAIN * target_size;
+    for (u32 i = 0; i < MICRO_GRAPH_CHAIN; ++i) {
+        if (graph->resources[targets[i]].block != i % 2) ping_pong = false;
+    }
+    if (!ping_pong) {
+        LOG_FATAL("graph_place_chain_8: %u targets placed in %u blocks, %.0f MB instead of %.0f MB",
+            MICRO_GRAPH_CHAIN, graph->block_count, graph->transient_size / (f64)MB(1), 2 * target_size / (f64)MB(1));
+    }
+
+    delete graph; // Nothing was allocated on a device
+}
+
+// Hashing and Compression
+// -----------------------------------------------------------------------------
+
+BENCHMARK(hash_fnv1a_4k) {
+    u8 data[KB(4)];
+    for (u32 i = 0; i < sizeof(data); ++i) {
+        data[i] = (u8)micro_random();
+    }
+
+    state->bytes = sizeof(data);
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        benchmark_do_not_optimize(hash_fnv1a_64(data, sizeof(data)));
+    }
+}
+
+// Roughly texture-like: runs of repeated pixels with some noise, so it
+// compresses without being trivial.
+internal void micro_fill_compressible(u8 *data, u64 size) {
+    u32 pixel = 0;
+    for (u64 i = 0; i < size; i += 4) {
+        if (micro_random() % 8 == 0) pixel = (u32)micro_random();
+        memcpy(&data[i], &pixel, MIN(4, size - i));
+    }
+}
+
+BENCHMARK(lz4_compress_1m) {
+    u64 size = MB(1);
+    auto src = new u8[size];
+    micro_fill_compressible(src, size);
+    u64 capacity = lz4_compress_bound(size);
+    auto dst = new u8[capacity];
+
+    state->bytes = size;
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        benchmark_do_not_optimize(lz4_compress(src, size, dst, capacity));
+    }
+
+    delete[] src;
+    delete[] dst;
+}
+
+BENCHMARK(lz4_decompress_1m) {
+    u64 size = MB(1);
+    auto src = new u8[size];
+    micro_fill_compressible(src, size);
+    u64 capacity = lz4_compress_bound(size);
+    auto compressed = new u8[capacity];
+    u64 compressed_size = lz4_compress(src, size, compressed, capacity);
+    ASSERT(compressed_size > 0);
+
+    // Decompressed bytes, which is what loading is bound by.
+    state->bytes = size;
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        b8 ok = lz4_decompress(compressed, compressed_size, src, size);
+        benchmark_do_not_optimize(ok);
+    }
+
+    delete[] src;
+    delete[] compressed;
+}
+
+// Math
+// -----------------------------------------------------------------------------
+
+BENCHMARK(camera_view_projection) {
+    Vk_Camera camera{};
+    camera.zoom = 1.5f;
+    camera.position[0] = 0.25f;
+    VkExtent2D extent = {1280, 720};
+
+    state->items = 1;
+    for (u64 i = 0; i < state->iterations; ++i) {
+        f32 view_projection[16];
+        camera.rotation = (f32)(i & 63) * 0.1f;
+        vk_camera_view_projection(&camera, extent, view_projection);
+        benchmark_do_not_optimize(view_projection);
+    }
+}
+
+BENCHMARK(bit_scan_forward_4k) {
+    u64 words[4096];
+    for (u32 i = 0; i < ARRAY_COUNT(words); ++i) {
+        words[i] = micro_random() | (1ull << 63);
+    }
+
+    state->items = ARRAY_COUNT(words);
+    benchmark_reset_timer(state);
+    for (u64 i = 0; i < state->iterations; ++i) {
+        u32 sum = 0;
+        for (u32 j = 0; j < ARRAY_COUNT(words); ++j) {
+            sum += bit_scan_forward_64(words[j]);
+        }
+        benchmark_do_not_optimize(sum);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    const char *out_path = NULL;
+    for (s32 i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strncmp(argv[i], "--out=", 6) == 0) {
+            out_path = argv[i] + 6;
+        } else if (argv[i][0] != '-' && filter == NULL) {
+            filter = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [name filter] [--out results.json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    micro_jobs = job_system_init(0);
+    micro_create_items();
+
+    LOG_INFO("%s build, %u benchmarks registered", BUILD_PROFILE_NAME, benchmark_count);
+
+    auto results = new Benchmark_Result[MAX_BENCHMARKS];
+    u32 result_count = benchmark_run(filter, results);
+    if (result_count == 0) LOG_WARNING("No benchmark matches \"%s\"", filter ? filter : "");
+
+    FILE *file = stdout;
+    if (out_path != NULL && (file = file_open(out_path, "wb")) == NULL) LOG_FATAL("Failed to open %s", out_path);
+    benchmark_write_json(file, results, result_count);
+    if (file != stdout) fclose(file);
+
+    delete[] results;
+    delete[] micro_items;
+    delete micro_context;
+    job_system_cleanup(micro_jobs);
+
+    return 0;
+}
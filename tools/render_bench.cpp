@@ -0,0 +1,661 @@
+// Renders canned scenes headless, on any device including software ones such
+// as lavapipe, and reports CPU and GPU frame time percentiles, draw counts and
+// device memory allocated per scene as JSON on stdout. Given a baseline
+// written by an earlier run, exits with 1 when a scene's median CPU or GPU
+// time got worse by more than the threshold.
+//
+// With --capture on every frame is also read back through the capture ring
+// and checksummed on a worker, standing in for an encoder, and the sustained
+// capture rate is reported per scene. Run it with --size 1920x1080 and
+// --size 3840x2160 for the 1080p and 4K figures.
+//
+// render_bench_debug is the same benchmark in the debug profile, with
+// validation, object names and asserts. Comparing against its output gives the
+// per-scene frame time difference between the two profiles:
+//   render_bench_debug --out debug.json
+//   render_bench --baseline debug.json
+//
+// Usage: render_bench [--frames N] [--warmup N] [--size WxH] [--device selector] [--capture on|off]
+//                     [--out results.json] [--baseline baseline.json] [--threshold percent]
+
+#include "main.h"
+
+#include "base.cpp"
+#include "job.cpp"
+#include "sort.cpp"
+#include "gfx.cpp"
+#include "graph.cpp"
+#include "asset.cpp"
+#include "stream.cpp"
+#include "scene.cpp"
+#include "app.cpp"
+
+#define BENCH_DEFAULT_WARMUP    60
+#define BENCH_DEFAULT_FRAMES    300
+#define BENCH_DEFAULT_WIDTH     1280
+#define BENCH_DEFAULT_HEIGHT    720
+#define BENCH_DEFAULT_THRESHOLD 10.0f // Percent
+
+#define BENCH_TEXTURE_COUNT 4
+#define BENCH_TEXTURE_SIZE  32
+
+#define BENCH_SPRITE_COUNT    10000
+#define BENCH_TILEMAP_SIZE    256 // Tiles per side, retained
+#define BENCH_TILEMAP_CHANGES 256 // Tiles animated per frame
+#define BENCH_TEXT_COLUMNS    160
+#define BENCH_TEXT_ROWS       90
+#define BENCH_PARTICLE_COUNT  100000
+
+struct Bench_Particle {
+    f32 position[2];
+    f32 velocity[2];
+};
+
+struct Bench {
+    Vk_Context *vulkan;
+    Vk_Texture textures[BENCH_TEXTURE_COUNT];
+    u32 random_state;
+
+    Vk_Draw_Item *items;
+    u32 item_count;
+    Bench_Particle *particles; // Sprites or particles, whichever scene runs
+
+    Scene *scene;
+    Scene_Handle *tiles;
+
+    std::atomic<u64> capture_checksum; // Keeps the readback from being optimized out
+};
+
+typedef void Bench_Proc(Bench *bench);
+typedef void Bench_Frame_Proc(Bench *bench, u32 frame);
+
+struct Bench_Scene {
+    const char *name;
+    Bench_Proc *setup;
+    Bench_Frame_Proc *frame;
+    Bench_Proc *teardown;
+};
+
+// Percentiles are p50, p90 and p99. Counters are averaged over the measured
+// frames.
+struct Bench_Result {
+    const char *name;
+    f32 cpu_ms[3];
+    f32 gpu_ms[3]; // 0 without GPU timestamps
+    f64 draw_calls;
+    f64 pipeline_binds;
+    f64 instances;
+    f64 shapes;
+    f64 retained;
+    f64 instance_bytes;
+    f64 upload_bytes; // Streamed and retained
+    u64 transient_bytes;    // The render graph's transient blocks, part of device_bytes
+    u64 device_bytes;       // Allocated on every heap at the end of the scene
+    u64 scene_device_bytes; // Of which allocated since the scene's setup
+
+    // Over the measured frames, 0 without --capture.
+    f64 capture_fps;
+    f64 capture_mb_s;
+    u64 capture_dropped;
+};
+
+global const f32 bench_percentiles[3] = {0.5f, 0.9f, 0.99f};
+global const char *bench_percentile_names[3] = {"p50", "p90", "p99"};
+
+// Setup
+// -----------------------------------------------------------------------------
+
+internal f32 bench_random(Bench *bench) {
+    // xorshift32, deterministic so runs are comparable.
+    u32 x = bench->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bench->random_state = x;
+    return (x >> 8) / (f32)(1 << 24);
+}
+
+internal f32 bench_random_range(Bench *bench, f32 min, f32 max) {
+    return min + (max - min) * bench_random(bench);
+}
+
+// Solid colors with a darker border, so tiles and glyphs break batches where
+// textures can't be indexed freely.
+internal void bench_create_textures(Bench *bench) {
+    Vk_Context *vulkan = bench->vulkan;
+    local_persist const u32 colors[BENCH_TEXTURE_COUNT] = {0xff3080f0, 0xff40c040, 0xfff0c040, 0xffc04080};
+
+    u32 size = BENCH_TEXTURE_SIZE;
+    VkDeviceSize offsets[BENCH_TEXTURE_COUNT];
+    for (u32 t = 0; t < BENCH_TEXTURE_COUNT; ++t) {
+        vk_create_texture(vulkan, size, size, &bench->textures[t]);
+
+        u32 *pixels = (u32 *)vk_staging_push(&vulkan->staging, size * size * 4, 16, &offsets[t]);
+        if (pixels == NULL) LOG_FATAL("Staging buffer too small for the benchmark textures");
+        for (u32 y = 0; y < size; ++y) {
+            for (u32 x = 0; x < size; ++x) {
+                b8 border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+                pixels[y * size + x] = border ? (colors[t] & 0xff7f7f7f) : colors[t];
+            }
+        }
+    }
+
+    VkCommandBuffer command_buffer = vk_begin_one_time_commands(vulkan);
+    for (u32 t = 0; t < BENCH_TEXTURE_COUNT; ++t) {
+        vk_cmd_upload_texture(command_buffer, vulkan->staging.buffer, offsets[t], &bench->textures[t]);
+    }
+    vk_end_one_time_commands(vulkan, command_buffer);
+    vk_staging_reset(&vulkan->staging);
+}
+
+// Reads every pixel, as an encoder or a network sender would have to.
+internal void bench_capture_frame(Vk_Capture_Frame *frame, void *user_data) {
+    auto bench = (Bench *)user_data;
+    const u64 *words = (const u64 *)frame->pixels;
+    u64 word_count = (u64)frame->row_pitch * frame->height / sizeof(u64);
+
+    u64 sum = 0;
+    for (u64 i = 0; i < word_count; ++i) sum += words[i];
+    bench->capture_checksum += sum;
+}
+
+// Scenes
+// -----------------------------------------------------------------------------
+
+// Immediate sprites wandering over a bit more than the view, in four layers
+// with a quarter of them translucent, so culling, sorting and batching all
+// have work to do.
+internal void bench_sprites_setup(Bench *bench) {
+    bench->items = new Vk_Draw_Item[BENCH_SPRITE_COUNT]{};
+    bench->particles = new Bench_Particle[BENCH_SPRITE_COUNT];
+    bench->item_count = BENCH_SPRITE_COUNT;
+
+    for (u32 i = 0; i < BENCH_SPRITE_COUNT; ++i) {
+        Vk_Draw_Item *item = &bench->items[i];
+        item->mesh = &bench->vulkan->quad_mesh;
+        item->texture = &bench->textures[i % BENCH_TEXTURE_COUNT];
+        item->scale[0] = item->scale[1] = bench_random_range(bench, 0.01f, 0.04f);
+        item->layer = (u8)(i % 4);
+        item->translucent = i % 4 == 0;
+        item->depth = bench_random(bench);
+
+        Bench_Particle *sprite = &bench->particles[i];
+        sprite->position[0] = bench_random_range(bench, -2.0f, 2.0f);
+        sprite->position[1] = bench_random_range(bench, -1.2f, 1.2f);
+        sprite->velocity[0] = bench_random_range(bench, -0.01f, 0.01f);
+        sprite->velocity[1] = bench_random_range(bench, -0.01f, 0.01f);
+    }
+}
+
+internal void bench_sprites_frame(Bench *bench, u32 frame) {
+    for (u32 i = 0; i < bench->item_count; ++i) {
+        Bench_Particle *sprite = &bench->particles[i];
+        for (u32 axis = 0; axis < 2; ++axis) {
+            f32 limit = axis == 0 ? 2.0f : 1.2f;
+            sprite->position[axis] += sprite->velocity[axis];
+            if (sprite->position[axis] > limit || sprite->position[axis] < -limit) {
+                sprite->velocity[axis] = -sprite->velocity[axis];
+            }
+            bench->items[i].offset[axis] = sprite->position[axis];
+        }
+    }
+}
+
+internal void bench_sprites_teardown(Bench *bench) {
+    delete[] bench->items;
+    delete[] bench->particles;
+    bench->items = NULL;
+    bench->particles = NULL;
+    bench->item_count = 0;
+}
+
+// A retained tilemap much larger than the view, which pans across it while a
+// few tiles change texture each frame.
+internal void bench_tilemap_setup(Bench *bench) {
+    Vk_Context *vulkan = bench->vulkan;
+    u32 count = BENCH_TILEMAP_SIZE * BENCH_TILEMAP_SIZE;
+    bench->scene = scene_create(vulkan, count);
+    bench->tiles = new Scene_Handle[count];
+    vulkan->scene = bench->scene;
+
+    // Tiles are 1/32 of the view's height across.
+    f32 tile = 2.0f / 32.0f;
+    f32 scale[2] = {tile * 0.5f, tile * 0.5f};
+    Scene_Batch_Id batch = scene_create_batch(bench->scene, &vulkan->quad_mesh, count, 0, false, 0);
+    for (u32 i = 0; i < count; ++i) {
+        f32 offset[2] = {
+            tile * ((i % BENCH_TILEMAP_SIZE) - BENCH_TILEMAP_SIZE * 0.5f + 0.5f),
+            tile * ((i / BENCH_TILEMAP_SIZE) - BENCH_TILEMAP_SIZE * 0.5f + 0.5f),
+        };
+        Vk_Texture *texture = &bench->textures[(u32)(bench_random(bench) * BENCH_TEXTURE_COUNT)];
+        bench->tiles[i] = scene_add(bench->scene, batch, offset, scale, texture, 1.0f);
+    }
+}
+
+internal void bench_tilemap_frame(Bench *bench, u32 frame) {
+    Vk_Camera *camera = &bench->vulkan->camera;
+    camera->position[0] = 2.0f * sinf(frame * 0.01f);
+    camera->position[1] = 2.0f * cosf(frame * 0.007f);
+
+    u32 count = BENCH_TILEMAP_SIZE * BENCH_TILEMAP_SIZE;
+    for (u32 c = 0; c < BENCH_TILEMAP_CHANGES; ++c) {
+        u32 i = (u32)(bench_random(bench) * count) % count;
+        Vk_Texture *texture = &bench->textures[(frame + c) % BENCH_TEXTURE_COUNT];
+        scene_set_texture(bench->scene, bench->tiles[i], texture);
+    }
+}
+
+internal void bench_tilemap_teardown(Bench *bench) {
+    bench->vulkan->scene = NULL;
+    bench->vulkan->camera = {};
+    bench->vulkan->camera.zoom = 1.0f;
+    scene_destroy(bench->scene, bench->vulkan);
+    delete[] bench->tiles;
+    bench->scene = NULL;
+    bench->tiles = NULL;
+}
+
+// A screen full of text. There's no font renderer, so glyphs are small
+// translucent UI quads, one per character cell, whose textures change every
+// frame like scrolling text would.
+internal void bench_text_setup(Bench *bench) {
+    u32 count = BENCH_TEXT_COLUMNS * BENCH_TEXT_ROWS;
+    bench->items = new Vk_Draw_Item[count]{};
+    bench->item_count = count;
+
+    f32 cell[2] = {2.0f / BENCH_TEXT_COLUMNS, 2.0f / BENCH_TEXT_ROWS};
+    for (u32 i = 0; i < count; ++i) {
+        Vk_Draw_Item *glyph = &bench->items[i];
+        glyph->mesh = &bench->vulkan->quad_mesh;
+        glyph->translucent = true;
+        glyph->ui = true;
+        glyph->offset[0] = -1.0f + cell[0] * ((i % BENCH_TEXT_COLUMNS) + 0.5f);
+        glyph->offset[1] = -1.0f + cell[1] * ((i / BENCH_TEXT_COLUMNS) + 0.5f);
+        glyph->scale[0] = cell[0] * 0.4f;
+        glyph->scale[1] = cell[1] * 0.4f;
+    }
+}
+
+internal void bench_text_frame(Bench *bench, u32 frame) {
+    for (u32 i = 0; i < bench->item_count; ++i) {
+        bench->items[i].texture = &bench->textures[(i + frame) % BENCH_TEXTURE_COUNT];
+    }
+}
+
+internal void bench_text_teardown(Bench *bench) {
+    delete[] bench->items;
+    bench->items = NULL;
+    bench->item_count = 0;
+}
+
+// Translucent SDF circles falling under gravity, pushed as shapes every frame.
+internal void bench_particles_setup(Bench *bench) {
+    bench->particles = new Bench_Particle[BENCH_PARTICLE_COUNT];
+    for (u32 i = 0; i < BENCH_PARTICLE_COUNT; ++i) {
+        Bench_Particle *particle = &bench->particles[i];
+        particle->position[0] = bench_random_range(bench, -1.8f, 1.8f);
+        particle->position[1] = bench_random_range(bench, -1.0f, 1.0f);
+        particle->velocity[0] = bench_random_range(bench, -0.005f, 0.005f);
+        particle->velocity[1] = bench_random_range(bench, -0.02f, 0.0f);
+    }
+}
+
+internal void bench_particles_frame(Bench *bench, u32 frame) {
+    for (u32 i = 0; i < BENCH_PARTICLE_COUNT; ++i) {
+        Bench_Particle *particle = &bench->particles[i];
+        particle->velocity[1] += 0.0005f; // y points down
+        particle->position[0] += particle->velocity[0];
+        particle->position[1] += particle->velocity[1];
+        if (particle->position[1] > 1.0f) {
+            particle->position[1] = -1.0f;
+            particle->velocity[1] = bench_random_range(bench, -0.02f, 0.0f);
+        }
+
+        Vk_Shape shape{};
+        shape.kind = VK_SHAPE_CIRCLE;
+        shape.color = 0x80000000 | (0x40 + (i % 4) * 0x30) << 16 | 0x80c0;
+        shape.p0[0] = particle->position[0];
+        shape.p0[1] = particle->position[1];
+        shape.radius = 0.004f + (i % 8) * 0.001f;
+        shape.layer = 1;
+        vk_push_shape(bench->vulkan, &shape);
+    }
+}
+
+internal void bench_particles_teardown(Bench *bench) {
+    delete[] bench->particles;
+    bench->particles = NULL;
+}
+
+global Bench_Scene bench_scenes[] = {
+    {"sprites",   bench_sprites_setup,   bench_sprites_frame,   bench_sprites_teardown},
+    {"tilemap",   bench_tilemap_setup,   bench_tilemap_frame,   bench_tilemap_teardown},
+    {"text",      bench_text_setup,      bench_text_frame,      bench_text_teardown},
+    {"particles", bench_particles_setup, bench_particles_frame, bench_particles_teardown},
+};
+
+// Measurement
+// -----------------------------------------------------------------------------
+
+internal s32 bench_compare_f32(const void *a, const void *b) {
+    f32 x = *(const f32 *)a;
+    f32 y = *(const f32 *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts samples in place.
+internal void bench_percentile_values(f32 *samples, u32 count, f32 values[3]) {
+    qsort(samples, count, sizeof(f32), bench_compare_f32);
+    for (u32 p = 0; p < 3; ++p) {
+        u32 index = MIN((u32)(bench_percentiles[p] * count), count - 1);
+        values[p] = samples[index];
+    }
+}
+
+internal u64 bench_device_bytes(Vk_Context *vulkan) {
+    Vk_Memory_Stats stats;
+    vk_get_memory_stats(vulkan, &stats);
+    u64 bytes = 0;
+    for (u32 i = 0; i < stats.heap_count; ++i) bytes += stats.heaps[i].allocated;
+    return bytes;
+}
+
+internal void bench_run_scene(Bench *bench, Bench_Scene *bench_scene, u32 warmup, u32 frames, Bench_Result *result) {
+    Vk_Context *vulkan = bench->vulkan;
+    *result = {};
+    result->name = bench_scene->name;
+    u64 device_start = bench_device_bytes(vulkan);
+
+    bench->random_state = 0x2545f491;
+    bench_scene->setup(bench);
+
+    auto cpu_ms = new f32[frames];
+    auto gpu_ms = new f32[frames];
+    u32 gpu_count = 0;
+
+    Vk_Capture_Stats capture_start{};
+    u64 measure_start_ns = 0;
+
+    for (u32 f = 0; f < warmup + frames; ++f) {
+        if (f == warmup) {
+            vk_get_capture_stats(vulkan, &capture_start);
+            measure_start_ns = time_now_ns();
+        }
+
+        u64 frame_start_ns = time_now_ns();
+        bench_scene->frame(bench, f);
+        vk_draw_frame(vulkan, bench->items, bench->item_count);
+        if (vk_failed()) LOG_FATAL("%s: stopped after a Vulkan error", bench_scene->name);
+        if (f < warmup) continue;
+
+        // Waiting for the GPU isn't CPU time, same as the app's frame graph.
+        Vk_Frame_Timing *timing = &vulkan->frame_timing;
+        u64 cpu_ns = (timing->begin_ns - frame_start_ns) + (timing->present_ns - timing->ready_ns);
+        cpu_ms[f - warmup] = (f32)NS_TO_MS(cpu_ns);
+
+        // The GPU time is the previous frame's, read once its fence signaled.
+        Vk_Frame_Stats stats;
+        vk_get_frame_stats(vulkan, &stats);
+        if (stats.gpu.frame_ms > 0.0f) gpu_ms[gpu_count++] = stats.gpu.frame_ms;
+
+        result->draw_calls += stats.submit.draw_calls;
+        result->pipeline_binds += stats.submit.pipeline_binds;
+        result->instances += stats.instance_count;
+        result->shapes += stats.shape_count;
+        result->retained += stats.scene_count;
+        result->instance_bytes += (f64)stats.instance_bytes;
+        result->upload_bytes += (f64)(stats.upload_bytes + stats.scene_upload_bytes);
+    }
+    vk_wait_idle(vulkan);
+
+    if (vulkan->config.capture) {
+        // The last frame's slot is only handed over by the next vk_draw_frame,
+        // which would count it in the next scene. The device is idle, so hand
+        // it over now, then wait for the consumer to get through the ring.
+        vk_collect_capture(vulkan);
+        job_wait(vulkan->jobs, &vulkan->capture.jobs);
+        f64 seconds = NS_TO_S(time_now_ns() - measure_start_ns);
+
+        Vk_Capture_Stats capture_end;
+        vk_get_capture_stats(vulkan, &capture_end);
+        result->capture_fps = (capture_end.captured_count - capture_start.captured_count) / seconds;
+        result->capture_mb_s = (capture_end.captured_bytes - capture_start.captured_bytes) / (f64)MB(1) / seconds;
+        result->capture_dropped = capture_end.dropped_count - capture_start.dropped_count;
+    }
+
+    bench_percentile_values(cpu_ms, frames, result->cpu_ms);
+    if (gpu_count > 0) bench_percentile_values(gpu_ms, gpu_count, result->gpu_ms);
+
+    result->draw_calls /= frames;
+    result->pipeline_binds /= frames;
+    result->instances /= frames;
+    result->shapes /= frames;
+    result->retained /= frames;
+    result->instance_bytes /= frames;
+    result->upload_bytes /= frames;
+    result->transient_bytes = vulkan->graph->transient_size;
+    result->device_bytes = bench_device_bytes(vulkan);
+    result->scene_device_bytes = result->device_bytes > device_start ? result->device_bytes - device_start : 0;
+
+    delete[] cpu_ms;
+    delete[] gpu_ms;
+    bench_scene->teardown(bench);
+
+    LOG_INFO("%-9s CPU %.3f / %.3f / %.3f ms, GPU %.3f / %.3f / %.3f ms (p50 / p90 / p99), %.0f draws, %.1f MB device memory (%.1f MB for the scene)",
+        result->name, result->cpu_ms[0], result->cpu_ms[1], result->cpu_ms[2],
+        result->gpu_ms[0], result->gpu_ms[1], result->gpu_ms[2], result->draw_calls,
+        result->device_bytes / (f64)MB(1), result->scene_device_bytes / (f64)MB(1));
+    if (vulkan->config.capture) {
+        LOG_INFO("%-9s capture at %ux%u: %.1f fps, %.1f MB/s, %llu of %u frames dropped",
+            result->name, vulkan->swapchain_extent.width, vulkan->swapchain_extent.height, result->capture_fps,
+            result->capture_mb_s, (unsigned long long)result->capture_dropped, frames);
+    }
+}
+
+// Report
+// -----------------------------------------------------------------------------
+
+internal void bench_write_percentiles(FILE *file, const char *name, f32 values[3]) {
+    fprintf(file, "      \"%s\": {", name);
+    for (u32 p = 0; p < 3; ++p) {
+        fprintf(file, "%s\"%s\": %.4f", p > 0 ? ", " : "", bench_percentile_names[p], values[p]);
+    }
+    fprintf(file, "},\n");
+}
+
+internal void bench_write_json(
+    FILE *file, Vk_Context *vulkan, u32 warmup, u32 frames, Bench_Result *results, u32 result_count) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vulkan->physical_device, &properties);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"device\": \"%s\",\n", properties.deviceName);
+    fprintf(file, "  \"build\": \"%s\",\n", BUILD_PROFILE_NAME);
+    fprintf(file, "  \"extent\": [%u, %u],\n", vulkan->swapchain_extent.width, vulkan->swapchain_extent.height);
+    fprintf(file, "  \"warmup\": %u,\n", warmup);
+    fprintf(file, "  \"frames\": %u,\n", frames);
+    fprintf(file, "  \"scenes\": [\n");
+    for (u32 i = 0; i < result_count; ++i) {
+        Bench_Result *result = &results[i];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", result->name);
+        bench_write_percentiles(file, "cpu_ms", result->cpu_ms);
+        bench_write_percentiles(file, "gpu_ms", result->gpu_ms);
+        fprintf(file, "      \"draw_calls\": %.1f,\n", result->draw_calls);
+        fprintf(file, "      \"pipeline_binds\": %.1f,\n", result->pipeline_binds);
+        fprintf(file, "      \"instances\": %.1f,\n", result->instances);
+        fprintf(file, "      \"shapes\": %.1f,\n", result->shapes);
+        fprintf(file, "      \"retained\": %.1f,\n", result->retained);
+        fprintf(file, "      \"instance_bytes\": %.0f,\n", result->instance_bytes);
+        fprintf(file, "      \"upload_bytes\": %.0f,\n", result->upload_bytes);
+        fprintf(file, "      \"transient_bytes\": %llu,\n", (unsigned long long)result->transient_bytes);
+        fprintf(file, "      \"device_bytes\": %llu,\n", (unsigned long long)result->device_bytes);
+        fprintf(file, "      \"scene_device_bytes\": %llu,\n", (unsigned long long)result->scene_device_bytes);
+        fprintf(file, "      \"capture_fps\": %.1f,\n", result->capture_fps);
+        fprintf(file, "      \"capture_mb_s\": %.1f,\n", result->capture_mb_s);
+        fprintf(file, "      \"capture_dropped\": %llu\n", (unsigned long long)result->capture_dropped);
+        fprintf(file, "    }%s\n", i + 1 < result_count ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+// Only understands the layout bench_write_json produces. Returns false if the
+// scene or value isn't in the baseline.
+internal b8 bench_find_baseline(const char *text, const char *scene, const char *metric, f32 *value) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", scene);
+    const char *start = strstr(text, key);
+    if (start == NULL) return false;
+    const char *end = strstr(start + 1, "\"name\":");
+
+    snprintf(key, sizeof(key), "\"%s\": {\"p50\": ", metric);
+    const char *found = strstr(start, key);
+    if (found == NULL || (end != NULL && found > end)) return false;
+
+    *value = (f32)atof(found + strlen(key));
+    return true;
+}
+
+// Medians only; the tail percentiles are too noisy to gate on.
+internal b8 bench_compare_baseline(const char *path, Bench_Result *results, u32 result_count, f32 threshold) {
+    File_Mapping mapping;
+    if (!file_map(path, &mapping)) LOG_FATAL("Failed to open baseline %s", path);
+
+    auto text = new char[mapping.size + 1];
+    memcpy(text, mapping.data, mapping.size);
+    text[mapping.size] = 0;
+    file_unmap(&mapping);
+
+    char baseline_build[16] = "";
+    const char *build = strstr(text, "\"build\": \"");
+    if (build != NULL) sscanf(build, "\"build\": \"%15[^\"]", baseline_build);
+    if (strcmp(baseline_build, BUILD_PROFILE_NAME) != 0) {
+        LOG_INFO("Comparing the %s build against a %s baseline", BUILD_PROFILE_NAME,
+            baseline_build[0] ? baseline_build : "unknown");
+    }
+
+    b8 regressed = false;
+    for (u32 i = 0; i < result_count; ++i) {
+        Bench_Result *result = &results[i];
+        const char *metrics[2] = {"cpu_ms", "gpu_ms"};
+        f32 current[2] = {result->cpu_ms[0], result->gpu_ms[0]};
+        for (u32 m = 0; m < 2; ++m) {
+            f32 baseline;
+            if (!bench_find_baseline(text, result->name, metrics[m], &baseline) || baseline <= 0.0f || current[m] <= 0.0f) {
+                continue;
+            }
+
+            f32 change = (current[m] / baseline - 1.0f) * 100.0f;
+            if (change > threshold) {
+                LOG_ERROR("%s %s regressed: %.3f ms vs %.3f ms baseline (%+.1f%%, threshold %.1f%%)",
+                    result->name, metrics[m], current[m], baseline, change, threshold);
+                regressed = true;
+            } else {
+                LOG_INFO("%s %s: %.3f ms vs %.3f ms baseline (%+.1f%%)",
+                    result->name, metrics[m], current[m], baseline, change);
+            }
+        }
+    }
+
+    delete[] text;
+    return regressed;
+}
+
+int main(int argc, char **argv) {
+    u32 warmup = BENCH_DEFAULT_WARMUP;
+    u32 frames = BENCH_DEFAULT_FRAMES;
+    f32 threshold = BENCH_DEFAULT_THRESHOLD;
+    const char *out_path = NULL;
+    const char *baseline_path = NULL;
+
+    Vk_Config config{};
+    env_get(DEVICE_SELECTOR_ENV, config.device_selector, sizeof(config.device_selector));
+    config.headless = true;
+    config.headless_extent = {BENCH_DEFAULT_WIDTH, BENCH_DEFAULT_HEIGHT};
+    config.depth_buffer = DEFAULT_DEPTH_BUFFER;
+
+    // Every option takes a value.
+    local_persist const char *options[] = {
+        "--frames", "--warmup", "--size", "--device", "--capture", "--out", "--baseline", "--threshold",
+    };
+
+    for (s32 i = 1; i < argc; ++i) {
+        // Both "--name value" and "--name=value" are accepted, as in the app.
+        char name[64];
+        const char *value = NULL;
+        const char *equals = strchr(argv[i], '=');
+        if (equals) {
+            snprintf(name, sizeof(name), "%.*s", (s32)(equals - argv[i]), argv[i]);
+            value = equals + 1;
+        } else {
+            snprintf(name, sizeof(name), "%s", argv[i]);
+        }
+
+        b8 known = false;
+        for (u32 o = 0; o < ARRAY_COUNT(options); ++o) {
+            if (strcmp(name, options[o]) == 0) known = true;
+        }
+        if (!known) {
+            fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--size WxH] [--device selector] [--capture on|off]\n"
+                "       [--out results.json] [--baseline baseline.json] [--threshold percent]\n", argv[0]);
+            return 1;
+        }
+        if (!equals && i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) value = argv[++i];
+
+        if (value == NULL) {
+            LOG_WARNING("Missing value for %s", name);
+        } else if (strcmp(name, "--frames") == 0) {
+            frames = MAX((u32)atoi(value), 1);
+        } else if (strcmp(name, "--warmup") == 0) {
+            warmup = (u32)atoi(value);
+        } else if (strcmp(name, "--size") == 0) {
+            u32 width, height;
+            if (sscanf(value, "%ux%u", &width, &height) == 2) config.headless_extent = {width, height};
+            else LOG_WARNING("Expected WxH for --size: %s", value);
+        } else if (strcmp(name, "--device") == 0) {
+            snprintf(config.device_selector, sizeof(config.device_selector), "%s", value);
+        } else if (strcmp(name, "--capture") == 0) {
+            if (strcmp(value, "on") == 0) config.capture = true;
+            else if (strcmp(value, "off") == 0) config.capture = false;
+            else LOG_WARNING("Unknown capture mode: %s", value);
+        } else if (strcmp(name, "--out") == 0) {
+            out_path = value;
+        } else if (strcmp(name, "--baseline") == 0) {
+            baseline_path = value;
+        } else if (strcmp(name, "--threshold") == 0) {
+            threshold = (f32)atof(value);
+        }
+    }
+
+    Job_System *jobs = job_system_init(0);
+    Vk_Context *vulkan = vk_init_begin(jobs, &config);
+    vk_init_end(vulkan, NULL);
+
+    Bench bench{};
+    bench.vulkan = vulkan;
+    bench_create_textures(&bench);
+    vulkan->capture_proc = bench_capture_frame;
+    vulkan->capture_data = &bench;
+
+    Bench_Result results[ARRAY_COUNT(bench_scenes)];
+    for (u32 i = 0; i < ARRAY_COUNT(bench_scenes); ++i) {
+        bench_run_scene(&bench, &bench_scenes[i], warmup, frames, &results[i]);
+    }
+
+    FILE *file = stdout;
+    if (out_path != NULL && (file = file_open(out_path, "wb")) == NULL) LOG_FATAL("Failed to open %s", out_path);
+    bench_write_json(file, vulkan, warmup, frames, results, ARRAY_COUNT(results));
+    if (file != stdout) fclose(file);
+
+    b8 regressed = false;
+    if (baseline_path != NULL) regressed = bench_compare_baseline(baseline_path, results, ARRAY_COUNT(results), threshold);
+
+    for (u32 t = 0; t < BENCH_TEXTURE_COUNT; ++t) {
+        vk_cleanup_texture(vulkan, &bench.textures[t]);
+    }
+    vk_cleanup(vulkan);
+    job_system_cleanup(jobs);
+
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+// Converts compiled SPIR-V modules into a header of aligned u32 arrays plus a
+// registry table, so shader modules can be created without touching the disk.
+//
+// Usage: spirv_embed <output.h> <name.spv>...
+// Shaders are registered under their file name without the ".spv" suffix,
+// e.g. "quad.vert.spv" becomes "quad.vert".
+
+#include "base.h"
+#include "base.cpp"
+
+#define SPIRV_MAGIC 0x07230203
+
+struct Spirv_Input {
+    char name[128];
+    char symbol[160];
+    u32 *words;
+    u64 word_count;
+};
+
+internal b8 spirv_load(const char *path, Spirv_Input *input) {
+    FILE *file = file_open(path, "rb");
+    if (file == NULL) {
+        LOG_ERROR("Failed to open %s", path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    u64 size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size == 0 || size % sizeof(u32) != 0) {
+        LOG_ERROR("%s is not a SPIR-V module (size %llu)", path, (unsigned long long)size);
+        fclose(file);
+        return false;
+    }
+
+    input->word_count = size / sizeof(u32);
+    input->words = new u32[input->word_count];
+    fread(input->words, 1, size, file);
+    fclose(file);
+
+    if (input->words[0] != SPIRV_MAGIC) {
+        LOG_ERROR("%s has a bad SPIR-V magic number", path);
+        return false;
+    }
+
+    const char *base_name = path;
+    for (const char *c = path; *c; ++c) {
+        if (*c == '/' || *c == '\\') base_name = c + 1;
+    }
+
+    u64 name_length = strlen(base_name);
+    if (name_length > 4 && strcmp(base_name + name_length - 4, ".spv") == 0) {
+        name_length -= 4;
+    }
+    ASSERT(name_length < sizeof(input->name));
+    memcpy(input->name, base_name, name_length);
+    input->name[name_length] = 0;
+
+    u32 at = snprintf(input->symbol, sizeof(input->symbol), "vk_spirv_");
+    for (u64 i = 0; i < name_length && at + 1 < sizeof(input->symbol); ++i) {
+        char c = input->name[i];
+        b8 is_alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        input->symbol[at++] = is_alnum ? c : '_';
+    }
+    input->symbol[at] = 0;
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <output.h> <name.spv>...\n", argv[0]);
+        return 1;
+    }
+
+    u32 input_count = argc - 2;
+    auto inputs = new Spirv_Input[input_count]{};
+    for (u32 i = 0; i < input_count; ++i) {
+        if (!spirv_load(argv[i + 2], &inputs[i])) return 1;
+    }
+
+    // Keep the registry sorted so the output is stable regardless of argument order.
+    for (u32 i = 1; i < input_count; ++i) {
+        for (u32 j = i; j > 0 && strcmp(inputs[j - 1].name, inputs[j].name) > 0; --j) {
+            Spirv_Input tmp = inputs[j];
+            inputs[j] = inputs[j - 1];
+            inputs[j - 1] = tmp;
+        }
+    }
+
+    FILE *out = file_open(argv[1], "wb");
+    if (out == NULL) {
+        LOG_ERROR("Failed to open %s for writing", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by tools/spirv_embed.cpp from res/shaders. Do not edit.\n\n");
+    fprintf(out, "#pragma once\n\n");
+
+    for (u32 i = 0; i < input_count; ++i) {
+        Spirv_Input *input = &inputs[i];
+        fprintf(out, "alignas(16) global const u32 %s[] = {", input->symbol);
+        for (u64 w = 0; w < input->word_count; ++w) {
+            if (w % 8 == 0) fprintf(out, "\n   ");
+            fprintf(out, " 0x%08x,", input->words[w]);
+        }
+        fprintf(out, "\n};\n\n");
+    }
+
+    fprintf(out, "global const Vk_Embedded_Shader vk_embedded_shaders[] = {\n");
+    for (u32 i = 0; i < input_count; ++i) {
+        fprintf(out, "    {\"%s\", %s, sizeof(%s)},\n", inputs[i].name, inputs[i].symbol, inputs[i].symbol);
+    }
+    fprintf(out, "};\n");
+
+    fclose(out);
+
+    LOG_INFO("Embedded %u shader(s) into %s", input_count, argv[1]);
+
+    for (u32 i = 0; i < input_count; ++i) delete[] inputs[i].words;
+    delete[] inputs;
+
+    return 0;
+}